@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dbench_model.c :
+ */
+
+#include "dbench_model.h"
+
+const gdouble d_bench_geometry[4] = { 30.0, 50.0, 25.0, 10.0 };
+
+DDynamicModel*
+d_bench_model_new (const gdouble   geometry[4],
+                   const gdouble   force[3],
+                   const gdouble   axes[3])
+{
+    DGeometry *g = d_geometry_new(geometry[0], geometry[1],
+                                  geometry[2], geometry[3]);
+    DDynamicSpec *spec = d_dynamic_spec_new();
+    DManipulator *manipulator = d_manipulator_new(g, spec);
+    DDynamicModel *model = d_dynamic_model_new(manipulator);
+    g_object_unref(manipulator);
+    g_object_unref(spec);
+    g_object_unref(g);
+
+    gdouble v[3] = { 0.0, 0.0, 9.806 };
+    gsl_vector_view view = gsl_vector_view_array(v, 3);
+    d_dynamic_model_set_gravity(model, &view.vector);
+    v[0] = 5.0; v[1] = -2.0; v[2] = 0.0;
+    d_dynamic_model_set_torque(model, &view.vector);
+    if (force) {
+        v[0] = force[0]; v[1] = force[1]; v[2] = force[2];
+        d_dynamic_model_set_force(model, &view.vector);
+    }
+    if (axes) {
+        v[0] = axes[0]; v[1] = axes[1]; v[2] = axes[2];
+        d_dynamic_model_set_axes(model, &view.vector);
+    }
+
+    return model;
+}
+
+void
+d_bench_model_set_servo (DDynamicModel     *model,
+                         gdouble           kp,
+                         gdouble           kd,
+                         const gdouble     target[3])
+{
+    gdouble v[3] = { target[0], target[1], target[2] };
+    gsl_vector_view view = gsl_vector_view_array(v, 3);
+    d_dynamic_model_set_servo(model, kp, kd, &view.vector);
+}
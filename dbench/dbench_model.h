@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dbench_model.h : Dynamic model shared by the dynamics benchmarks
+ */
+
+#ifndef  DBENCH_MODEL_INC
+#define  DBENCH_MODEL_INC
+
+#include <glib.h>
+#include <dsim/dsim.h>
+
+/* Geometry of the benchmarks that do not take it from the options */
+extern const gdouble d_bench_geometry[4];
+
+/*
+ * Model of the default dynamic spec on a geometry { a, b, h, r }, under
+ * gravity along +z and a constant torque of (5, -2, 0). force and axes
+ * are set when not NULL. The model keeps the only reference to its
+ * manipulator.
+ */
+DDynamicModel*  d_bench_model_new       (const gdouble  geometry[4],
+                                         const gdouble  force[3],
+                                         const gdouble  axes[3]);
+
+/* Joint space servo of the model towards target */
+void            d_bench_model_set_servo (DDynamicModel  *model,
+                                         gdouble        kp,
+                                         gdouble        kd,
+                                         const gdouble  target[3]);
+
+#endif   /* ----- #ifndef DBENCH_MODEL_INC  ----- */
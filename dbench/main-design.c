@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-design.c : Sweeps the arm lengths of a candidate grid against a box
+ *                 of target poses with d_design_space_evaluate, once in a
+ *                 single thread and once on the whole pool, and reports
+ *                 the best candidates.
+ */
+
+#include <string.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+static gdouble a_min = 20.0;
+static gdouble a_max = 40.0;
+static gdouble b_min = 50.0;
+static gdouble b_max = 80.0;
+static gint n_lengths = 16;
+static gdouble half_width = 25.0;
+static gdouble z_min = 40.0;
+static gdouble z_max = 80.0;
+static gint n_steps = 20;
+static gint n_threads = 0;
+
+static GOptionEntry entries[] =
+{
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "a-min", 0, 0, G_OPTION_ARG_DOUBLE, &a_min, "minimum near arm length", NULL },
+      { "a-max", 0, 0, G_OPTION_ARG_DOUBLE, &a_max, "maximum near arm length", NULL },
+      { "b-min", 0, 0, G_OPTION_ARG_DOUBLE, &b_min, "minimum far arm length", NULL },
+      { "b-max", 0, 0, G_OPTION_ARG_DOUBLE, &b_max, "maximum far arm length", NULL },
+      { "lengths", 'n', 0, G_OPTION_ARG_INT, &n_lengths, "number of values of each arm length", "N" },
+      { "half-width", 'w', 0, G_OPTION_ARG_DOUBLE, &half_width, "half width of the target box in x and y", NULL },
+      { "z-min", 0, 0, G_OPTION_ARG_DOUBLE, &z_min, "lowest z of the target box", NULL },
+      { "z-max", 0, 0, G_OPTION_ARG_DOUBLE, &z_max, "highest z of the target box", NULL },
+      { "steps", 's', 0, G_OPTION_ARG_INT, &n_steps, "number of targets along each side of the box", "S" },
+      { "threads", 't', 0, G_OPTION_ARG_INT, &n_threads, "number of threads, 0 for one per processor", "T" },
+      { NULL  }
+};
+
+static gdouble
+lerp (gdouble   min,
+      gdouble   max,
+      gint      i,
+      gint      n)
+{
+    return n > 1 ? min + (max - min) * i / (n - 1) : min;
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- evaluate a grid of arm lengths against a box of targets");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (n_lengths < 1 || n_steps < 1) {
+        g_print("Invalid grid size\n");
+        exit(1);
+    }
+
+    gsize n_candidates = (gsize) n_lengths * n_lengths;
+    DDesignCandidate *candidates = g_new(DDesignCandidate, n_candidates);
+    for (gint i = 0; i < n_lengths; i++) {
+        for (gint j = 0; j < n_lengths; j++) {
+            DDesignCandidate *c = &candidates[i * n_lengths + j];
+            c->a = lerp(a_min, a_max, i, n_lengths);
+            c->b = lerp(b_min, b_max, j, n_lengths);
+            c->h = h;
+            c->r = r;
+        }
+    }
+
+    gsize n_poses = (gsize) n_steps * n_steps * n_steps;
+    gdouble *x = g_new(gdouble, n_poses);
+    gdouble *y = g_new(gdouble, n_poses);
+    gdouble *z = g_new(gdouble, n_poses);
+    gsize k = 0;
+    for (gint i = 0; i < n_steps; i++) {
+        for (gint j = 0; j < n_steps; j++) {
+            for (gint l = 0; l < n_steps; l++, k++) {
+                x[k] = lerp(-half_width, half_width, l, n_steps);
+                y[k] = lerp(-half_width, half_width, j, n_steps);
+                z[k] = lerp(z_min, z_max, i, n_steps);
+            }
+        }
+    }
+
+    DDesignSummary *serial = g_new(DDesignSummary, n_candidates);
+    DDesignSummary *parallel = g_new(DDesignSummary, n_candidates);
+    GError *error = NULL;
+    GTimer *timer = g_timer_new();
+    if (!d_design_space_evaluate(candidates, n_candidates, n_poses, x, y, z,
+                                 1, serial, &error)) {
+        g_print("Evaluation failed: %s\n", error->message);
+        exit(1);
+    }
+    gdouble serial_time = g_timer_elapsed(timer, NULL);
+    g_timer_start(timer);
+    if (!d_design_space_evaluate(candidates, n_candidates, n_poses, x, y, z,
+                                 n_threads, parallel, &error)) {
+        g_print("Evaluation failed: %s\n", error->message);
+        exit(1);
+    }
+    gdouble parallel_time = g_timer_elapsed(timer, NULL);
+
+    /* Threads only split the candidates, results must not change */
+    gsize mismatches = 0;
+    gsize best = 0;
+    for (gsize i = 0; i < n_candidates; i++) {
+        if (memcmp(&serial[i], &parallel[i], sizeof(DDesignSummary)) != 0) {
+            mismatches++;
+        }
+        if (parallel[i].reach_fraction > parallel[best].reach_fraction
+            || (parallel[i].reach_fraction == parallel[best].reach_fraction
+                && parallel[i].dexterity_mean > parallel[best].dexterity_mean)) {
+            best = i;
+        }
+    }
+
+    gdouble evaluations = (gdouble) n_candidates * n_poses;
+    g_print("%" G_GSIZE_FORMAT " candidates x %" G_GSIZE_FORMAT " targets\n",
+            n_candidates, n_poses);
+    g_print("1 thread:  %f s (%.0f evaluations/s)\n",
+            serial_time, evaluations / serial_time);
+    g_print("%d threads: %f s (%.0f evaluations/s), speedup %.2f\n",
+            n_threads > 0 ? n_threads : (gint) g_get_num_processors(),
+            parallel_time, evaluations / parallel_time,
+            serial_time / parallel_time);
+    g_print("Summaries differing between runs: %" G_GSIZE_FORMAT "\n",
+            mismatches);
+
+    DDesignCandidate *c = &candidates[best];
+    DDesignSummary *s = &parallel[best];
+    g_print("Best candidate [ %f, %f, %f, %f ]\n", c->a, c->b, c->h, c->r);
+    g_print("  reach %.1f %%, %" G_GSIZE_FORMAT " singular, dexterity min %f mean %f\n",
+            100.0 * s->reach_fraction, s->n_singular,
+            s->dexterity_min, s->dexterity_mean);
+    for (int i = 0; i < 3; i++) {
+        g_print("  axis %d in [ %f, %f ] deg\n", i + 1,
+                s->axes_min[i] / G_PI * 180.0, s->axes_max[i] / G_PI * 180.0);
+    }
+
+    g_timer_destroy(timer);
+    g_free(candidates);
+    g_free(serial);
+    g_free(parallel);
+    g_free(x);
+    g_free(y);
+    g_free(z);
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-dexterity.c : Compares the closed form conventional jacobian and
+ *                    dexterity against the LU inversion and SVD they
+ *                    replaced, over random reachable targets, and times
+ *                    both along with the batch variant.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gsl/gsl_linalg.h>
+#include <gsl/gsl_blas.h>
+#include <dsim/dsim.h>
+#include <dsim/dsim_jacobian.h>
+
+static gdouble a = 29.3;
+static gdouble b = 64.5;
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+static gint n_targets = 200000;
+static gint seed = 1;
+
+static GOptionEntry entries[] =
+{
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "targets", 'n', 0, G_OPTION_ARG_INT, &n_targets, "number of random targets", "N" },
+      { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { NULL  }
+};
+
+/* Reference conventional jacobian, LU inversion of the inverse jacobian */
+static void
+reference_conventional (gsl_matrix  *jacobian,
+                        DGeometry   *geometry,
+                        gsl_matrix  *ext_axes)
+{
+    gsl_matrix *inverse = gsl_matrix_calloc(3,3);
+    gsl_matrix *direct = gsl_matrix_calloc(3,3);
+
+    d_jacobian_inverse(inverse, geometry, ext_axes);
+    d_jacobian_direct(direct, geometry, ext_axes);
+
+    gint s = 0;
+    gsl_permutation *p = gsl_permutation_alloc(3);
+    gsl_matrix *inverse_inv = gsl_matrix_calloc (3,3);
+    gsl_linalg_LU_decomp (inverse, p, &s);
+    gsl_linalg_LU_invert (inverse, p, inverse_inv);
+
+    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, inverse_inv, direct, 0.0, jacobian);
+
+    gsl_matrix_free(inverse_inv);
+    gsl_matrix_free(inverse);
+    gsl_matrix_free(direct);
+    gsl_permutation_free(p);
+}
+
+/* Reference dexterity, full SVD of the jacobian */
+static gdouble
+reference_dexterity (DGeometry  *geometry,
+                     gsl_matrix *ext_axes)
+{
+    gsl_matrix *jacobian = gsl_matrix_calloc(3,3);
+
+    reference_conventional (jacobian, geometry, ext_axes);
+
+    gsl_matrix *v_mat = gsl_matrix_calloc (3,3);
+    gsl_vector *w = gsl_vector_calloc (3);
+    gsl_vector *s = gsl_vector_calloc (3);
+    gsl_linalg_SV_decomp (jacobian, v_mat, s, w);
+
+    gdouble ret_val = 0;
+    if (gsl_fcmp (gsl_vector_get(s, 0), 0.0, FLT_EPSILON) == 0) {
+        ret_val = 0.0;
+    } else {
+        ret_val = gsl_vector_get(s, 2) / gsl_vector_get (s, 0);
+    }
+
+    gsl_vector_free(s);
+    gsl_vector_free(w);
+    gsl_matrix_free(jacobian);
+    gsl_matrix_free(v_mat);
+
+    return ret_val;
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- benchmark the closed form jacobian and dexterity");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+
+    /* Random reachable targets, from random axes values */
+    gsize n = n_targets;
+    gdouble *t[3], *p[3];
+    for (int i = 0; i < 3; i++) {
+        t[i] = g_new(gdouble, n);
+        p[i] = g_new(gdouble, n);
+    }
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gsize k = 0; k < n; k++) {
+        for (int i = 0; i < 3; i++) {
+            t[i][k] = g_rand_double_range(rand, -G_PI / 4.0, G_PI / 2.0);
+        }
+    }
+    g_rand_free(rand);
+    guint8 *status = g_new(guint8, n);
+    d_solver_solve_direct_batch(geometry, n, t[0], t[1], t[2],
+                                p[0], p[1], p[2], status);
+    gsize m = 0;
+    for (gsize k = 0; k < n; k++) {
+        if (status[k] == D_SOLVER_STATUS_OK) {
+            for (int i = 0; i < 3; i++) {
+                p[i][m] = p[i][k];
+            }
+            m++;
+        }
+    }
+    gdouble *extaxes = g_new(gdouble, 9 * m);
+    m = d_solver_solve_inverse_batch(geometry, m, p[0], p[1], p[2],
+                                     NULL, NULL, NULL, extaxes, status);
+
+    gdouble *jac_ref = g_new(gdouble, 9 * m);
+    gdouble *jac = g_new(gdouble, 9 * m);
+    gdouble *dex_ref = g_new(gdouble, m);
+    gdouble *dex = g_new(gdouble, m);
+    gdouble *dex_batch = g_new(gdouble, m);
+    GTimer *timer = g_timer_new();
+
+    g_timer_start(timer);
+    for (gsize k = 0; k < m; k++) {
+        gsl_matrix_view e = gsl_matrix_view_array(extaxes + 9 * k, 3, 3);
+        gsl_matrix_view j = gsl_matrix_view_array(jac_ref + 9 * k, 3, 3);
+        reference_conventional(&j.matrix, geometry, &e.matrix);
+    }
+    gdouble jac_ref_time = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (gsize k = 0; k < m; k++) {
+        gsl_matrix_view e = gsl_matrix_view_array(extaxes + 9 * k, 3, 3);
+        gsl_matrix_view j = gsl_matrix_view_array(jac + 9 * k, 3, 3);
+        d_jacobian_conventional(&j.matrix, geometry, &e.matrix);
+    }
+    gdouble jac_time = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (gsize k = 0; k < m; k++) {
+        gsl_matrix_view e = gsl_matrix_view_array(extaxes + 9 * k, 3, 3);
+        dex_ref[k] = reference_dexterity(geometry, &e.matrix);
+    }
+    gdouble dex_ref_time = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    for (gsize k = 0; k < m; k++) {
+        gsl_matrix_view e = gsl_matrix_view_array(extaxes + 9 * k, 3, 3);
+        dex[k] = d_jacobian_dexterity(geometry, &e.matrix);
+    }
+    gdouble dex_time = g_timer_elapsed(timer, NULL);
+
+    g_timer_start(timer);
+    d_jacobian_dexterity_batch(geometry, m, extaxes, dex_batch);
+    gdouble dex_batch_time = g_timer_elapsed(timer, NULL);
+
+    /* Jacobian relative to its largest element, dexterity absolute */
+    gdouble jac_err = 0.0;
+    gdouble dex_err = 0.0;
+    gsize batch_mismatches = 0;
+    for (gsize k = 0; k < m; k++) {
+        gdouble norm = 0.0;
+        gdouble diff = 0.0;
+        for (int l = 0; l < 9; l++) {
+            norm = MAX(norm, fabs(jac_ref[9 * k + l]));
+            diff = MAX(diff, fabs(jac_ref[9 * k + l] - jac[9 * k + l]));
+        }
+        if (isfinite(norm) && norm > 0.0) {
+            jac_err = MAX(jac_err, diff / norm);
+        }
+        dex_err = MAX(dex_err, fabs(dex_ref[k] - dex[k]));
+        if (dex[k] != dex_batch[k]) {
+            batch_mismatches++;
+        }
+    }
+
+    g_print("%" G_GSIZE_FORMAT " reachable targets\n", m);
+    g_print("Conventional jacobian: LU %f s, closed form %f s (%.2fx), "
+            "max deviation %g\n",
+            jac_ref_time, jac_time, jac_ref_time / jac_time, jac_err);
+    g_print("Dexterity: SVD %f s, closed form %f s (%.2fx), batch %f s (%.2fx), "
+            "max deviation %g\n",
+            dex_ref_time, dex_time, dex_ref_time / dex_time,
+            dex_batch_time, dex_ref_time / dex_batch_time, dex_err);
+    g_print("Batch mismatches: %" G_GSIZE_FORMAT "\n", batch_mismatches);
+
+    gboolean ok = jac_err <= 1e-12 && dex_err <= 1e-9 && batch_mismatches == 0;
+
+    g_timer_destroy(timer);
+    g_free(jac_ref);
+    g_free(jac);
+    g_free(dex_ref);
+    g_free(dex);
+    g_free(dex_batch);
+    g_free(extaxes);
+    g_free(status);
+    for (int i = 0; i < 3; i++) {
+        g_free(t[i]);
+        g_free(p[i]);
+    }
+    g_object_unref(geometry);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-direct.c : Compares the warm started direct kinematics solver
+ *                 against d_solver_solve_direct on streams of joint
+ *                 setpoints sampled at several controller tick rates.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+static gdouble duration = 10.0;
+static gdouble speed = 3.0;
+static gdouble a = 29.3;
+static gdouble b = 64.5;
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+
+static GOptionEntry entries[] =
+{
+      { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration, "seconds of motion to stream at each rate", "T" },
+      { "speed", 's', 0, G_OPTION_ARG_DOUBLE, &speed, "peak axis speed in rad/s", "W" },
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { NULL  }
+};
+
+static const gdouble rates[] = { 1000.0, 2000.0, 5000.0, 10000.0 };
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- benchmark warm started direct kinematics");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (duration <= 0.0 || speed <= 0.0) {
+        g_print("Duration and speed must be positive\n");
+        exit(1);
+    }
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+    DDirectSolver *solver = d_direct_solver_new (geometry);
+    gsl_vector *pos = gsl_vector_alloc(3);
+    gboolean ok = TRUE;
+
+    /* Each axis swings 0.4 rad around 0.6 rad at its own frequency */
+    const gdouble amplitude = 0.4;
+    const gdouble freq[] = { 1.0, 1.3, 1.7 };
+    const gdouble phase[] = { 0.0, 2.0, 4.0 };
+
+    g_print("Peak axis speed: %g rad/s\n", speed);
+    g_print("%8s %12s %12s %8s %10s %10s %12s\n",
+            "rate", "closed ns", "newton ns", "speedup",
+            "mean iter", "fallbacks", "max dev");
+    for (guint ri = 0; ri < G_N_ELEMENTS(rates); ri++) {
+        gsize n = (gsize) (duration * rates[ri]);
+        gdouble *t = g_new(gdouble, 3 * n);
+        for (gsize k = 0; k < n; k++) {
+            gdouble tau = k / rates[ri];
+            for (int i = 0; i < 3; i++) {
+                gdouble w = speed / amplitude * freq[i] / freq[2];
+                t[3 * k + i] = 0.6 + amplitude * sin(w * tau + phase[i]);
+            }
+        }
+
+        /* Reference: closed form on every tick */
+        gdouble *p = g_new(gdouble, 3 * n);
+        gboolean *p_ok = g_new(gboolean, n);
+        GTimer *timer = g_timer_new();
+        for (gsize k = 0; k < n; k++) {
+            GError *err = NULL;
+            gsl_vector_view tv = gsl_vector_view_array(t + 3 * k, 3);
+            gsl_vector_view pv = gsl_vector_view_array(p + 3 * k, 3);
+            d_solver_solve_direct(geometry, &tv.vector, &pv.vector, &err);
+            p_ok[k] = err == NULL;
+            g_clear_error(&err);
+        }
+        gdouble closed_time = g_timer_elapsed(timer, NULL);
+
+        /* Warm started solver over the same stream */
+        d_direct_solver_reset(solver);
+        gsize mismatches = 0;
+        gdouble max_dev = 0.0;
+        g_timer_start(timer);
+        for (gsize k = 0; k < n; k++) {
+            GError *err = NULL;
+            gsl_vector_view tv = gsl_vector_view_array(t + 3 * k, 3);
+            d_direct_solver_solve(solver, &tv.vector, pos, &err);
+            if ((err == NULL) != p_ok[k]) {
+                mismatches++;
+            } else if (err == NULL) {
+                for (int i = 0; i < 3; i++) {
+                    max_dev = MAX(max_dev, fabs(gsl_vector_get(pos, i) - p[3 * k + i]));
+                }
+            }
+            g_clear_error(&err);
+        }
+        gdouble newton_time = g_timer_elapsed(timer, NULL);
+        g_timer_destroy(timer);
+
+        DDirectSolverStats stats;
+        d_direct_solver_get_stats(solver, &stats);
+        g_print("%8.0f %12.1f %12.1f %8.2f %10.3f %10" G_GUINT64_FORMAT " %12g\n",
+                rates[ri],
+                closed_time / n * 1e9,
+                newton_time / n * 1e9,
+                closed_time / newton_time,
+                stats.solves ? (gdouble) stats.iterations / stats.solves : 0.0,
+                stats.fallbacks,
+                max_dev);
+        if (mismatches > 0) {
+            g_print("%8.0f: %" G_GSIZE_FORMAT " status mismatches\n",
+                    rates[ri], mismatches);
+        }
+
+        /* Deviation allowed by the residual tolerance, with some slack */
+        ok = ok && mismatches == 0 && max_dev <= 1e3 * D_DIRECT_SOLVER_TOLERANCE * b;
+
+        g_free(t);
+        g_free(p);
+        g_free(p_ok);
+    }
+
+    gsl_vector_free(pos);
+    g_object_unref(solver);
+    g_object_unref(geometry);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-ensemble.c : Monte Carlo over payload and arm masses, every member
+ *                   a PD move to its own target, run as a DDynamicEnsemble
+ *                   on a growing number of threads. Reports simulated
+ *                   seconds per wall second for each thread count.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+static gint n_members = 64;
+static gdouble duration = 0.5;
+static gdouble period = 1e-3;
+static gint max_threads = 0;
+static gint seed = 1;
+
+static GOptionEntry entries[] =
+{
+      { "members", 'n', 0, G_OPTION_ARG_INT, &n_members, "number of members", "N" },
+      { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration, "simulated time in seconds", "T" },
+      { "period", 'p', 0, G_OPTION_ARG_DOUBLE, &period, "torque program period in seconds", "P" },
+      { "threads", 't', 0, G_OPTION_ARG_INT, &max_threads, "largest thread count, 0 for one per processor", "N" },
+      { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { NULL  }
+};
+
+/* PD move of one member */
+typedef struct {
+    gdouble     target[3];
+    gdouble     kp;
+    gdouble     kd;
+} Move;
+
+static void
+move_program (gdouble       time,
+              const gdouble state[6],
+              gdouble       torque[3],
+              gpointer      user_data)
+{
+    Move *move = user_data;
+    for (int i = 0; i < 3; i++) {
+        torque[i] = move->kp * (move->target[i] - state[i])
+                    - move->kd * state[i + 3];
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- scaling of ensemble simulation with threads");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (max_threads <= 0) {
+        max_threads = g_get_num_processors();
+    }
+    if (n_members < 1 || period <= 0.0 || duration < period) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+    gsize n = n_members;
+    gsize n_samples = (gsize) (duration / period + 0.5);
+
+    DGeometry *geometry = d_geometry_new(30.0, 50.0, 25.0, 10.0);
+    DDynamicEnsemble *ensemble = d_dynamic_ensemble_new(geometry, n,
+                                                        n_samples, period);
+    ensemble->gravity[2] = 9.806;
+
+    /* Uncertain payload and arm masses, random start and target */
+    Move *moves = g_new(Move, n);
+    gdouble *initial = g_new(gdouble, 6 * n);
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gsize i = 0; i < n; i++) {
+        DDynamicSpec *spec = d_dynamic_spec_new();
+        spec->platform_mass = g_rand_double_range(rand, 0.5, 2.0);
+        spec->low_arm_mass = g_rand_double_range(rand, 0.9, 1.1);
+        spec->upper_arm_mass = g_rand_double_range(rand, 0.9, 1.1);
+
+        gdouble *state = initial + 6 * i;
+        for (int c = 0; c < 3; c++) {
+            state[c] = g_rand_double_range(rand, 0.75, 0.95);
+            state[c + 3] = 0.0;
+            moves[i].target[c] = g_rand_double_range(rand, 0.7, 1.0);
+        }
+        moves[i].kp = 2e4;
+        moves[i].kd = 2e3;
+        d_dynamic_ensemble_set_member(ensemble, i, spec, state,
+                                      move_program, &moves[i]);
+        g_object_unref(spec);
+    }
+    g_rand_free(rand);
+
+    /* First run on one thread is the reference for the others */
+    gdouble *reference = g_new(gdouble, 6 * n_samples * n);
+    gdouble single = 0.0;
+    GError *err = NULL;
+    GTimer *timer = g_timer_new();
+
+    g_print("%" G_GSIZE_FORMAT " members, %g s each\n", n, n_samples * period);
+    g_print("%8s %12s %14s %10s %12s\n",
+            "threads", "wall s", "sim s/wall s", "speedup", "max diff");
+    for (gint threads = 1; threads <= max_threads;
+            threads = (threads == max_threads) ? threads + 1
+                                               : MIN(2 * threads, max_threads)) {
+        for (gsize i = 0; i < n; i++) {
+            for (int c = 0; c < 6; c++) {
+                ensemble->state[c][i] = initial[6 * i + c];
+            }
+        }
+
+        g_timer_start(timer);
+        if (!d_dynamic_ensemble_run(ensemble, threads, &err)) {
+            g_print("%s\n", err->message);
+            exit(1);
+        }
+        gdouble elapsed = g_timer_elapsed(timer, NULL);
+
+        gdouble diff = 0.0;
+        for (int c = 0; c < 6; c++) {
+            gdouble *samples = ensemble->samples[c];
+            gdouble *ref = reference + c * n_samples * n;
+            for (gsize k = 0; k < n_samples * n; k++) {
+                if (threads == 1) {
+                    ref[k] = samples[k];
+                } else {
+                    diff = MAX(diff, fabs(samples[k] - ref[k]));
+                }
+            }
+        }
+        if (threads == 1) {
+            single = elapsed;
+        }
+        g_print("%8d %12f %14.1f %10.2f %12g\n", threads, elapsed,
+                n * n_samples * period / elapsed, single / elapsed, diff);
+    }
+
+    gsize failed = 0;
+    gulong steps = 0;
+    for (gsize i = 0; i < n; i++) {
+        failed += ensemble->status[i] != D_DYNAMIC_ENSEMBLE_STATUS_OK;
+        steps += ensemble->steps[i];
+    }
+    g_print("Failed members: %" G_GSIZE_FORMAT ", steps per member: %.1f\n",
+            failed, (gdouble) steps / n);
+
+    g_timer_destroy(timer);
+    g_free(reference);
+    g_free(initial);
+    g_free(moves);
+    d_dynamic_ensemble_free(ensemble);
+    g_object_unref(geometry);
+
+    return 0;
+}
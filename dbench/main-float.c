@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-float.c : Validates the single precision solvers and jacobian
+ *                against the double precision ones over a grid of axes
+ *                values, and times both batch inverse solvers.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+#include <dsim/dsim_jacobian.h>
+
+static gdouble a = 29.3;
+static gdouble b = 64.5;
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+static gdouble t_min = 0.0;
+static gdouble t_max = 90.0;
+static gdouble t_increment = 1.0;
+
+static GOptionEntry entries[] =
+{
+      { "t-min", 0, 0, G_OPTION_ARG_DOUBLE, &t_min, "minimum value of arm angle to test", NULL },
+      { "t-max", 0, 0, G_OPTION_ARG_DOUBLE, &t_max, "maximum value of arm angle to test", NULL },
+      { "t-increment", 0, 0, G_OPTION_ARG_DOUBLE, &t_increment, "increment value to test", NULL },
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { NULL  }
+};
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- validate single precision kinematics against double precision");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (t_increment <= 0.0 || t_max < t_min) {
+        g_print("Invalid axes interval\n");
+        exit(1);
+    }
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+    gdouble scale = MAX(a, b);
+
+    /* Axes grid, the same one dworkspace walks */
+    gsize steps = (gsize) floor((t_max - t_min) / t_increment) + 1;
+    gsize n = steps * steps * steps;
+    gdouble *td[3];
+    gfloat *tf[3];
+    gdouble *pd[3];
+    gfloat *pf[3];
+    for (int i = 0; i < 3; i++) {
+        td[i] = g_new(gdouble, n);
+        tf[i] = g_new(gfloat, n);
+        pd[i] = g_new(gdouble, n);
+        pf[i] = g_new(gfloat, n);
+    }
+    gsize k = 0;
+    for (gsize i = 0; i < steps; i++) {
+        for (gsize j = 0; j < steps; j++) {
+            for (gsize l = 0; l < steps; l++, k++) {
+                td[0][k] = (t_min + i * t_increment) * G_PI / 180.0;
+                td[1][k] = (t_min + j * t_increment) * G_PI / 180.0;
+                td[2][k] = (t_min + l * t_increment) * G_PI / 180.0;
+                for (int m = 0; m < 3; m++) {
+                    tf[m][k] = (gfloat) td[m][k];
+                }
+            }
+        }
+    }
+    guint8 *sd = g_new(guint8, n);
+    guint8 *sf = g_new(guint8, n);
+
+    /* Direct kinematics */
+    d_solver_solve_direct_batch(geometry, n, td[0], td[1], td[2],
+                                pd[0], pd[1], pd[2], sd);
+    d_solver_solve_direct_batch_float(geometry, n, tf[0], tf[1], tf[2],
+                                      pf[0], pf[1], pf[2], sf);
+    gsize direct_mismatches = 0;
+    gsize direct_solved = 0;
+    gdouble direct_err = 0.0;
+    for (k = 0; k < n; k++) {
+        if (sd[k] != sf[k]) {
+            direct_mismatches++;
+            continue;
+        }
+        if (sd[k] != D_SOLVER_STATUS_OK) {
+            continue;
+        }
+        direct_solved++;
+        for (int i = 0; i < 3; i++) {
+            direct_err = MAX(direct_err, fabs(pd[i][k] - pf[i][k]) / scale);
+        }
+    }
+
+    /* Inverse kinematics of the double precision positions */
+    gsize m = 0;
+    for (k = 0; k < n; k++) {
+        if (sd[k] == D_SOLVER_STATUS_OK) {
+            for (int i = 0; i < 3; i++) {
+                pd[i][m] = pd[i][k];
+                pf[i][m] = (gfloat) pd[i][k];
+            }
+            m++;
+        }
+    }
+    gdouble *extd = g_new(gdouble, 9 * m);
+    gfloat *extf = g_new(gfloat, 9 * m);
+
+    GTimer *timer = g_timer_new();
+    d_solver_solve_inverse_batch(geometry, m, pd[0], pd[1], pd[2],
+                                 NULL, NULL, NULL, extd, sd);
+    gdouble double_time = g_timer_elapsed(timer, NULL);
+    g_timer_start(timer);
+    d_solver_solve_inverse_batch_float(geometry, m, pf[0], pf[1], pf[2],
+                                       NULL, NULL, NULL, extf, sf);
+    gdouble float_time = g_timer_elapsed(timer, NULL);
+
+    gsize inverse_mismatches = 0;
+    gsize inverse_solved = 0;
+    gdouble inverse_err = 0.0;
+    gdouble jacobian_err = 0.0;
+    for (k = 0; k < m; k++) {
+        if (sd[k] != sf[k]) {
+            inverse_mismatches++;
+            continue;
+        }
+        if (sd[k] != D_SOLVER_STATUS_OK) {
+            continue;
+        }
+        inverse_solved++;
+        for (int j = 0; j < 9; j++) {
+            inverse_err = MAX(inverse_err, fabs(extd[9 * k + j] - extf[9 * k + j]));
+        }
+
+        /* Jacobian of each solved pose, relative to its largest element */
+        gdouble jd[9];
+        gfloat jf[9];
+        gsl_matrix_view ext_view = gsl_matrix_view_array(extd + 9 * k, 3, 3);
+        gsl_matrix_float_view extf_view = gsl_matrix_float_view_array(extf + 9 * k, 3, 3);
+        gsl_matrix_view jd_view = gsl_matrix_view_array(jd, 3, 3);
+        gsl_matrix_float_view jf_view = gsl_matrix_float_view_array(jf, 3, 3);
+        d_jacobian_conventional(&jd_view.matrix, geometry, &ext_view.matrix);
+        d_jacobian_conventional_float(&jf_view.matrix, geometry, &extf_view.matrix);
+        gdouble norm = 0.0;
+        gdouble diff = 0.0;
+        for (int j = 0; j < 9; j++) {
+            norm = MAX(norm, fabs(jd[j]));
+            diff = MAX(diff, fabs(jd[j] - jf[j]));
+        }
+        if (isfinite(norm) && norm > 0.0) {
+            jacobian_err = MAX(jacobian_err, diff / norm);
+        }
+    }
+
+    g_print("Instruction set: %s\n", d_solver_batch_isa());
+    g_print("Grid: %" G_GSIZE_FORMAT " axes values\n", n);
+    g_print("Direct:   %" G_GSIZE_FORMAT " solved, %" G_GSIZE_FORMAT
+            " status mismatches, max deviation %g (relative to arm length, tolerance %g)\n",
+            direct_solved, direct_mismatches, direct_err,
+            D_SOLVER_FLOAT_POS_TOLERANCE);
+    g_print("Inverse:  %" G_GSIZE_FORMAT " solved, %" G_GSIZE_FORMAT
+            " status mismatches, max deviation %g rad (tolerance %g)\n",
+            inverse_solved, inverse_mismatches, inverse_err,
+            D_SOLVER_FLOAT_AXES_TOLERANCE);
+    g_print("Jacobian: max deviation %g (relative to largest element)\n",
+            jacobian_err);
+    g_print("d_solver_solve_inverse_batch:       %f s (%.0f targets/s)\n",
+            double_time, m / double_time);
+    g_print("d_solver_solve_inverse_batch_float: %f s (%.0f targets/s)\n",
+            float_time, m / float_time);
+
+    gboolean ok = direct_err <= D_SOLVER_FLOAT_POS_TOLERANCE
+                  && inverse_err <= D_SOLVER_FLOAT_AXES_TOLERANCE;
+
+    g_timer_destroy(timer);
+    g_free(extd);
+    g_free(extf);
+    g_free(sd);
+    g_free(sf);
+    for (int i = 0; i < 3; i++) {
+        g_free(td[i]);
+        g_free(tf[i]);
+        g_free(pd[i]);
+        g_free(pf[i]);
+    }
+    g_object_unref(geometry);
+
+    return ok ? 0 : 1;
+}
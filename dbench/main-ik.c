@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-ik.c : Compares the batch inverse kinematics solver against
+ *             d_solver_solve_inverse over random reachable targets.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+static gint n_points = 1000000;
+static gint seed = 1;
+static gdouble a = 29.3;
+static gdouble b = 64.5;
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+
+static GOptionEntry entries[] =
+{
+      { "points", 'n', 0, G_OPTION_ARG_INT, &n_points, "number of targets to solve", "N" },
+      { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { NULL  }
+};
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- benchmark batch inverse kinematics");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+    gsize n = n_points;
+
+    /* Random targets inside the working space, built from random axes */
+    gdouble *x = g_new(gdouble, n);
+    gdouble *y = g_new(gdouble, n);
+    gdouble *z = g_new(gdouble, n);
+    gdouble *t[3] = { g_new(gdouble, n), g_new(gdouble, n), g_new(gdouble, n) };
+    guint8 *status = g_new(guint8, n);
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gsize k = 0; k < n; k++) {
+        for (int i = 0; i < 3; i++) {
+            t[i][k] = g_rand_double_range(rand, 0.0, G_PI / 2.0);
+        }
+    }
+    g_rand_free(rand);
+    d_solver_solve_direct_batch(geometry, n, t[0], t[1], t[2], x, y, z, status);
+    for (gsize k = 0; k < n; k++) {
+        if (status[k] != D_SOLVER_STATUS_OK) {
+            x[k] = y[k] = z[k] = 0.0;
+        }
+    }
+
+    /* Reference: one call per target through the gsl API */
+    gdouble *ref_ext = g_new0(gdouble, 9 * n);
+    gboolean *ref_ok = g_new(gboolean, n);
+    gsl_vector *pos = gsl_vector_alloc(3);
+    GTimer *timer = g_timer_new();
+    for (gsize k = 0; k < n; k++) {
+        GError *err = NULL;
+        gsl_matrix_view ext = gsl_matrix_view_array(ref_ext + 9 * k, 3, 3);
+        gsl_vector_set(pos, 0, x[k]);
+        gsl_vector_set(pos, 1, y[k]);
+        gsl_vector_set(pos, 2, z[k]);
+        d_solver_solve_inverse(geometry, pos, NULL, &ext.matrix, &err);
+        ref_ok[k] = err == NULL;
+        g_clear_error(&err);
+    }
+    gdouble scalar_time = g_timer_elapsed(timer, NULL);
+
+    /* Batch solver, both output layouts */
+    gdouble *ext = g_new0(gdouble, 9 * n);
+    g_timer_start(timer);
+    gsize solved = d_solver_solve_inverse_batch(geometry, n, x, y, z,
+                                                t[0], t[1], t[2], ext,
+                                                status);
+    gdouble batch_time = g_timer_elapsed(timer, NULL);
+
+    gsize mismatches = 0;
+    gdouble max_err = 0.0;
+    for (gsize k = 0; k < n; k++) {
+        if (ref_ok[k] != (status[k] == D_SOLVER_STATUS_OK)) {
+            mismatches++;
+            continue;
+        }
+        if (!ref_ok[k]) {
+            continue;
+        }
+        for (int j = 0; j < 9; j++) {
+            max_err = MAX(max_err, fabs(ext[9 * k + j] - ref_ext[9 * k + j]));
+        }
+        for (int i = 0; i < 3; i++) {
+            max_err = MAX(max_err, fabs(t[i][k] - ref_ext[9 * k + 3 * i]));
+        }
+    }
+
+    g_print("Instruction set: %s\n", d_solver_batch_isa());
+    g_print("Targets: %" G_GSIZE_FORMAT ", solved: %" G_GSIZE_FORMAT "\n", n, solved);
+    g_print("d_solver_solve_inverse:       %f s (%.0f targets/s)\n",
+            scalar_time, n / scalar_time);
+    g_print("d_solver_solve_inverse_batch: %f s (%.0f targets/s)\n",
+            batch_time, n / batch_time);
+    g_print("Speedup: %.2f\n", scalar_time / batch_time);
+    g_print("Status mismatches: %" G_GSIZE_FORMAT ", max deviation: %g rad (tolerance %g)\n",
+            mismatches, max_err, D_SOLVER_BATCH_TOLERANCE);
+
+    gboolean ok = mismatches == 0 && max_err <= D_SOLVER_BATCH_TOLERANCE;
+
+    g_timer_destroy(timer);
+    gsl_vector_free(pos);
+    g_free(ext);
+    g_free(ref_ext);
+    g_free(ref_ok);
+    g_free(status);
+    for (int i = 0; i < 3; i++) {
+        g_free(t[i]);
+    }
+    g_free(x);
+    g_free(y);
+    g_free(z);
+    g_object_unref(geometry);
+
+    return ok ? 0 : 1;
+}
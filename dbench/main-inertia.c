@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-inertia.c : Solves the accelerations of the dynamic model from its
+ *                  inertia matrix over random reachable poses, by the
+ *                  LDLᵀ factor the model uses, by Cramer's rule and by
+ *                  the explicit inverse it replaced. Times the three,
+ *                  also with the factor or inverse reused as the model
+ *                  does for every speed at the same axes, and compares
+ *                  them against a long double elimination.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+#include <dsim/dsim_jacobian.h>
+
+static gdouble a = 30.0;
+static gdouble b = 50.0;
+static gdouble h = 25.0;
+static gdouble r = 10.0;
+static gint n_targets = 100000;
+static gint repeat = 20;
+static gint seed = 1;
+
+static GOptionEntry entries[] =
+{
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "targets", 'n', 0, G_OPTION_ARG_INT, &n_targets, "number of random targets", "N" },
+      { "repeat", 0, 0, G_OPTION_ARG_INT, &repeat, "times every system is solved", "N" },
+      { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { NULL  }
+};
+
+typedef enum {
+    SOLVE_LDLT = 0,
+    SOLVE_CRAMER,
+    SOLVE_INVERSE,
+    N_SOLVES
+} SolveMethod;
+
+static const gchar *solve_names[N_SOLVES] = { "ldlt", "cramer", "inverse" };
+
+static gboolean
+solve (SolveMethod  method,
+       const DMat3  *inertia,
+       DVec3        rhs,
+       DVec3        *x)
+{
+    DMat3 m;
+    switch (method) {
+        case SOLVE_LDLT:
+            if (!d_mat3_ldlt(inertia, &m)) {
+                return FALSE;
+            }
+            *x = d_mat3_ldlt_solve(&m, rhs);
+            return TRUE;
+        case SOLVE_CRAMER:
+            return d_mat3_solve(inertia, rhs, x);
+        default:
+            if (!d_mat3_inverse(inertia, &m)) {
+                return FALSE;
+            }
+            *x = d_mat3_mul_vec(&m, rhs);
+            return TRUE;
+    }
+}
+
+/* Reference solution, Gaussian elimination with partial pivoting */
+static DVec3
+solve_reference (const DMat3    *inertia,
+                 DVec3          rhs)
+{
+    long double m[3][4];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            m[i][j] = inertia->m[i][j];
+        }
+        m[i][3] = rhs.v[i];
+    }
+    for (int c = 0; c < 3; c++) {
+        int pivot = c;
+        for (int i = c + 1; i < 3; i++) {
+            if (fabsl(m[i][c]) > fabsl(m[pivot][c])) {
+                pivot = i;
+            }
+        }
+        for (int j = 0; j < 4; j++) {
+            long double swap = m[c][j];
+            m[c][j] = m[pivot][j];
+            m[pivot][j] = swap;
+        }
+        for (int i = c + 1; i < 3; i++) {
+            long double f = m[i][c] / m[c][c];
+            for (int j = c; j < 4; j++) {
+                m[i][j] -= f * m[c][j];
+            }
+        }
+    }
+    DVec3 x;
+    for (int i = 2; i >= 0; i--) {
+        long double v = m[i][3];
+        for (int j = i + 1; j < 3; j++) {
+            v -= m[i][j] * x.v[j];
+        }
+        x.v[i] = v / m[i][i];
+    }
+    return x;
+}
+
+static gdouble
+norm_inf (DVec3 v)
+{
+    return MAX(fabs(v.v[0]), MAX(fabs(v.v[1]), fabs(v.v[2])));
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- benchmark the inertia solve of the dynamic model");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (n_targets < 1 || repeat < 1) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+    DDynamicSpec *spec = d_dynamic_spec_new();
+
+    /* Random reachable targets, from random axes values */
+    gsize n = n_targets;
+    gdouble *t[3], *p[3];
+    for (int i = 0; i < 3; i++) {
+        t[i] = g_new(gdouble, n);
+        p[i] = g_new(gdouble, n);
+    }
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gsize k = 0; k < n; k++) {
+        for (int i = 0; i < 3; i++) {
+            t[i][k] = g_rand_double_range(rand, 0.2, 1.4);
+        }
+    }
+    guint8 *status = g_new(guint8, n);
+    d_solver_solve_direct_batch(geometry, n, t[0], t[1], t[2],
+                                p[0], p[1], p[2], status);
+    gsize m = 0;
+    for (gsize k = 0; k < n; k++) {
+        if (status[k] == D_SOLVER_STATUS_OK) {
+            for (int i = 0; i < 3; i++) {
+                p[i][m] = p[i][k];
+            }
+            m++;
+        }
+    }
+    gdouble *extaxes = g_new(gdouble, 9 * m);
+    m = d_solver_solve_inverse_batch(geometry, m, p[0], p[1], p[2],
+                                     NULL, NULL, NULL, extaxes, status);
+    gdouble *jacobians = g_new(gdouble, 9 * m);
+    d_jacobian_conventional_batch(geometry, m, extaxes, jacobians);
+
+    /*
+     * Model inertia I = K * Mp * Kᵀ + Iq. The conventional jacobian maps
+     * the platform speed to the axes speed, so K = Jq * Jp⁻ᵀ = -J⁻ᵀ.
+     */
+    gdouble mass_pos = spec->platform_mass + 3.0 * spec->upper_arm_mass;
+    gdouble inertia_axes = spec->upper_arm_mass * a * a + spec->low_arm_moi;
+    DMat3 *inertia = g_new(DMat3, m);
+    DVec3 *rhs = g_new(DVec3, m);
+    gsize l = 0;
+    for (gsize k = 0; k < m; k++) {
+        DMat3 j, j_inv;
+        for (int i = 0; i < 9; i++) {
+            j.m[i / 3][i % 3] = jacobians[9 * k + i];
+        }
+        if (!d_mat3_inverse(&j, &j_inv)) {
+            continue;
+        }
+        DMat3 k_mat = d_mat3_transpose(&j_inv);
+        DMat3 ii = d_mat3_mul_t(&k_mat, &k_mat);
+        for (int i = 0; i < 3; i++) {
+            for (int c = 0; c < 3; c++) {
+                ii.m[i][c] = mass_pos * ii.m[i][c]
+                             + (i == c ? inertia_axes : 0.0);
+            }
+        }
+        inertia[l] = ii;
+        rhs[l] = d_vec3(g_rand_double_range(rand, -1.0, 1.0),
+                        g_rand_double_range(rand, -1.0, 1.0),
+                        g_rand_double_range(rand, -1.0, 1.0));
+        l++;
+    }
+    m = l;
+    g_rand_free(rand);
+    if (m == 0) {
+        g_print("No reachable pose for this geometry\n");
+        exit(1);
+    }
+
+    /* Solutions of every method, forward error relative to |x| */
+    DVec3 *x = g_new(DVec3, m);
+    DVec3 *ref = g_new(DVec3, m);
+    for (gsize k = 0; k < m; k++) {
+        ref[k] = solve_reference(&inertia[k], rhs[k]);
+    }
+    gdouble elapsed[N_SOLVES];
+    gdouble error[N_SOLVES];
+    gsize failed[N_SOLVES];
+    GTimer *timer = g_timer_new();
+    for (int s = 0; s < N_SOLVES; s++) {
+        g_timer_start(timer);
+        for (gint i = 0; i < repeat; i++) {
+            for (gsize k = 0; k < m; k++) {
+                if (!solve(s, &inertia[k], rhs[k], &x[k])) {
+                    x[k] = d_vec3(GSL_NAN, GSL_NAN, GSL_NAN);
+                }
+            }
+        }
+        elapsed[s] = g_timer_elapsed(timer, NULL);
+
+        failed[s] = 0;
+        error[s] = 0.0;
+        for (gsize k = 0; k < m; k++) {
+            if (!isfinite(x[k].v[0])) {
+                failed[s]++;
+                continue;
+            }
+            error[s] = MAX(error[s], norm_inf(d_vec3_sub(x[k], ref[k]))
+                                     / norm_inf(ref[k]));
+        }
+    }
+
+    /* Reused factor and inverse, only their application is timed */
+    DMat3 *factor = g_new(DMat3, m);
+    DMat3 *inverse = g_new(DMat3, m);
+    for (gsize k = 0; k < m; k++) {
+        if (!d_mat3_ldlt(&inertia[k], &factor[k])
+            || !d_mat3_inverse(&inertia[k], &inverse[k])) {
+            factor[k] = inverse[k] = d_mat3_zero();
+        }
+    }
+    gdouble checksum = 0.0;
+    g_timer_start(timer);
+    for (gint i = 0; i < repeat; i++) {
+        for (gsize k = 0; k < m; k++) {
+            checksum += d_mat3_ldlt_solve(&factor[k], rhs[k]).v[0];
+        }
+    }
+    gdouble factor_time = g_timer_elapsed(timer, NULL);
+    g_timer_start(timer);
+    for (gint i = 0; i < repeat; i++) {
+        for (gsize k = 0; k < m; k++) {
+            checksum += d_mat3_mul_vec(&inverse[k], rhs[k]).v[0];
+        }
+    }
+    gdouble inverse_time = g_timer_elapsed(timer, NULL);
+
+    gdouble solves = (gdouble) m * repeat;
+    g_print("%" G_GSIZE_FORMAT " poses, %d solves each\n", m, repeat);
+    for (int s = 0; s < N_SOLVES; s++) {
+        g_print("%-9s %6.1f ns per solve (x%.2f)  max error %.2e"
+                "  (%" G_GSIZE_FORMAT " failed)\n",
+                solve_names[s], 1e9 * elapsed[s] / solves,
+                elapsed[SOLVE_INVERSE] / elapsed[s], error[s], failed[s]);
+    }
+    g_print("reused: factor %.1f ns, inverse %.1f ns per solve (checksum %.6e)\n",
+            1e9 * factor_time / solves, 1e9 * inverse_time / solves,
+            checksum / repeat);
+
+    g_timer_destroy(timer);
+    g_free(x);
+    g_free(ref);
+    g_free(factor);
+    g_free(inverse);
+    g_free(inertia);
+    g_free(rhs);
+    g_free(jacobians);
+    g_free(extaxes);
+    g_free(status);
+    for (int i = 0; i < 3; i++) {
+        g_free(t[i]);
+        g_free(p[i]);
+    }
+    g_object_unref(spec);
+    g_object_unref(geometry);
+
+    return 0;
+}
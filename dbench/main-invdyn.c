@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-invdyn.c : Torques along a sinusoidal trajectory of the axes, from
+ *                 d_dynamic_model_inverse_dynamics_batch on a growing
+ *                 number of threads, timed against torques solved point
+ *                 by point from forward evaluations of the model and
+ *                 checked by feeding them back to it.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gint n_samples = 200000;
+static gint max_threads = 0;
+
+static GOptionEntry entries[] =
+{
+      { "samples", 'n', 0, G_OPTION_ARG_INT, &n_samples, "samples of the trajectory", "N" },
+      { "threads", 't', 0, G_OPTION_ARG_INT, &max_threads, "largest thread count, 0 for one per processor", "N" },
+      { NULL  }
+};
+
+/*
+ * Forward accelerations are affine in the torque, d²q/dt² = I⁻¹ (r + τ),
+ * so four evaluations give I⁻¹ and r, and τ = I * d²q/dt² - r. Unit steps
+ * of torque make I⁻¹ coarse for this model, this is only timed.
+ */
+static gboolean
+reference_torque (DDynamicModel    *model,
+                  const gdouble    q[3],
+                  const gdouble    q_dot[3],
+                  const gdouble    q_dot_dot[3],
+                  gdouble          tau[3])
+{
+    gdouble y[6] = { q[0], q[1], q[2], q_dot[0], q_dot[1], q_dot[2] };
+    gdouble dydt[6];
+    gdouble t[3] = { 0.0, 0.0, 0.0 };
+    gsl_vector_view view = gsl_vector_view_array(t, 3);
+
+    DVec3 base;
+    DMat3 inertia_inv;
+    for (int j = -1; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+            t[i] = (i == j) ? 1.0 : 0.0;
+        }
+        d_dynamic_model_set_torque(model, &view.vector);
+        if (d_dynamic_model_evaluate(model, y, dydt) != GSL_SUCCESS) {
+            return FALSE;
+        }
+        DVec3 acc = d_vec3(dydt[3], dydt[4], dydt[5]);
+        if (j < 0) {
+            base = acc;
+        } else {
+            for (int i = 0; i < 3; i++) {
+                inertia_inv.m[i][j] = acc.v[i] - base.v[i];
+            }
+        }
+    }
+
+    DMat3 inertia;
+    if (!d_mat3_inverse(&inertia_inv, &inertia)) {
+        return FALSE;
+    }
+    DVec3 qdd = d_vec3(q_dot_dot[0], q_dot_dot[1], q_dot_dot[2]);
+    DVec3 r = d_mat3_mul_vec(&inertia, base);
+    DVec3 result = d_vec3_sub(d_mat3_mul_vec(&inertia, qdd), r);
+    for (int i = 0; i < 3; i++) {
+        tau[i] = result.v[i];
+    }
+    return TRUE;
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- inverse dynamics along a trajectory");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (max_threads <= 0) {
+        max_threads = g_get_num_processors();
+    }
+    if (n_samples < 1) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+    gsize n = n_samples;
+
+    const gdouble force[3] = { 0.5, 0.0, -1.0 };
+    DDynamicModel *model = d_bench_model_new(d_bench_geometry, force, NULL);
+
+    /* q = q0 + A sin(w t + phase) over one second */
+    gdouble *axes = g_new(gdouble, 3 * n);
+    gdouble *speed = g_new(gdouble, 3 * n);
+    gdouble *accel = g_new(gdouble, 3 * n);
+    gdouble *torque = g_new(gdouble, 3 * n);
+    for (gsize k = 0; k < n; k++) {
+        gdouble t = (gdouble) k / n;
+        for (int i = 0; i < 3; i++) {
+            gdouble w = 2.0 * G_PI * (1.0 + i);
+            gdouble phase = w * t + i;
+            axes[3 * k + i] = 0.85 + 0.1 * sin(phase);
+            speed[3 * k + i] = 0.1 * w * cos(phase);
+            accel[3 * k + i] = - 0.1 * w * w * sin(phase);
+        }
+    }
+
+    /* Point by point through the public forward model */
+    GTimer *timer = g_timer_new();
+    gdouble tau[3];
+    gsize solved = 0;
+    for (gsize k = 0; k < n; k++) {
+        if (reference_torque(model, axes + 3 * k, speed + 3 * k,
+                             accel + 3 * k, tau)) {
+            solved++;
+        }
+    }
+    gdouble reference_time = g_timer_elapsed(timer, NULL);
+    g_print("%" G_GSIZE_FORMAT " samples, %" G_GSIZE_FORMAT " solved\n", n, solved);
+    g_print("%-12s %12s %14s %12s\n", "", "wall s", "ns per sample", "accel error");
+    g_print("%-12s %12f %14.1f %12s\n", "evaluations", reference_time,
+            1e9 * reference_time / n, "-");
+
+    for (gint threads = 1; threads <= max_threads;
+            threads = (threads == max_threads) ? threads + 1
+                                               : MIN(2 * threads, max_threads)) {
+        g_timer_start(timer);
+        gsize batch_solved = d_dynamic_model_inverse_dynamics_batch(model, n,
+                                        axes, speed, accel, torque, threads);
+        gdouble elapsed = g_timer_elapsed(timer, NULL);
+
+        /* Accelerations of the forward model under the torques found */
+        gdouble diff = 0.0;
+        for (gsize k = 0; k < n; k += 97) {
+            gdouble y[6], dydt[6];
+            for (int i = 0; i < 3; i++) {
+                y[i] = axes[3 * k + i];
+                y[i + 3] = speed[3 * k + i];
+            }
+            gsl_vector_view view = gsl_vector_view_array(torque + 3 * k, 3);
+            d_dynamic_model_set_torque(model, &view.vector);
+            if (d_dynamic_model_evaluate(model, y, dydt) != GSL_SUCCESS) {
+                continue;
+            }
+            for (int i = 0; i < 3; i++) {
+                gdouble scale = MAX(1.0, fabs(accel[3 * k + i]));
+                diff = MAX(diff, fabs(dydt[i + 3] - accel[3 * k + i]) / scale);
+            }
+        }
+        gchar *label = g_strdup_printf("batch x%d", threads);
+        g_print("%-12s %12f %14.1f %12g%s\n", label, elapsed, 1e9 * elapsed / n,
+                diff, batch_solved == solved ? "" : " (solved count differs)");
+        g_free(label);
+    }
+
+    g_timer_destroy(timer);
+    g_free(axes);
+    g_free(speed);
+    g_free(accel);
+    g_free(torque);
+    g_object_unref(model);
+
+    return 0;
+}
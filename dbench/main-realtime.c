@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-realtime.c : Execution time of every fixed step of the dynamic
+ *                   model over random states, as a real-time loop would
+ *                   take them. The worst case, not the mean, is what sets
+ *                   the control period.
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gdouble a = 30.0;
+static gdouble b = 50.0;
+static gdouble h = 25.0;
+static gdouble r = 10.0;
+static gdouble step = 1e-3;
+static gint n_states = 4096;
+static gint repeat = 25;
+static gint seed = 1;
+
+static GOptionEntry entries[] =
+{
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "step", 't', 0, G_OPTION_ARG_DOUBLE, &step, "length of the fixed step", "T" },
+      { "states", 'n', 0, G_OPTION_ARG_INT, &n_states, "number of random states", "N" },
+      { "repeat", 0, 0, G_OPTION_ARG_INT, &repeat, "times every state is stepped", "N" },
+      { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { NULL  }
+};
+
+static gint
+compare_times (gconstpointer  pa,
+               gconstpointer  pb)
+{
+    gdouble ta = *(const gdouble *) pa;
+    gdouble tb = *(const gdouble *) pb;
+
+    return (ta > tb) - (ta < tb);
+}
+
+static gdouble
+elapsed_ns (const struct timespec   *start,
+            const struct timespec   *end)
+{
+    return 1e9 * (end->tv_sec - start->tv_sec)
+           + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+ * Steps every state repeat times from the same start, timing each step on
+ * its own, and prints the distribution of the times.
+ */
+static void
+time_method (DDynamicModel          *model,
+             DDynamicFixedMethod    method,
+             const gchar            *name,
+             const gdouble          *y,
+             gsize                  n,
+             gdouble                *times)
+{
+    struct timespec start, end;
+    gdouble ys[6];
+    gdouble checksum = 0.0;
+    gsize failed = 0;
+    gsize n_times = 0;
+
+    for (gint i = 0; i < repeat; i++) {
+        for (gsize k = 0; k < n; k++) {
+            for (int m = 0; m < 6; m++) {
+                ys[m] = y[6 * k + m];
+            }
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            int status = d_dynamic_model_step_fixed(model, method, step, ys);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            times[n_times++] = elapsed_ns(&start, &end);
+            if (status != GSL_SUCCESS) {
+                failed++;
+            }
+            checksum += ys[3] + ys[4] + ys[5];
+        }
+    }
+
+    gdouble mean = 0.0;
+    for (gsize k = 0; k < n_times; k++) {
+        mean += times[k];
+    }
+    mean /= n_times;
+    qsort(times, n_times, sizeof(gdouble), compare_times);
+
+    g_print("%-20s min %7.0f  mean %7.1f  p99 %7.0f  p99.9 %7.0f  max %8.0f ns"
+            "  (%" G_GSIZE_FORMAT " failed, checksum %.12e)\n",
+            name, times[0], mean, times[(gsize) (0.99 * (n_times - 1))],
+            times[(gsize) (0.999 * (n_times - 1))], times[n_times - 1],
+            failed, checksum / repeat);
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- worst case time of fixed dynamic steps");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (n_states < 1 || repeat < 1 || step <= 0.0) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    const gdouble geometry[4] = { a, b, h, r };
+    const gdouble force[3] = { 0.5, 0.0, -1.0 };
+    DDynamicModel *model = d_bench_model_new(geometry, force, NULL);
+
+    /* Random states around the middle of the axes range, kept if a step
+     * from them succeeds */
+    gdouble *y = g_new(gdouble, 6 * n_states);
+    gdouble ys[6];
+    gsize n = 0;
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gint k = 0; k < n_states; k++) {
+        for (int i = 0; i < 3; i++) {
+            y[6 * n + i] = g_rand_double_range(rand, 0.6, 1.4);
+            y[6 * n + i + 3] = g_rand_double_range(rand, -1.0, 1.0);
+        }
+        for (int m = 0; m < 6; m++) {
+            ys[m] = y[6 * n + m];
+        }
+        if (d_dynamic_model_step_fixed(model, D_DYNAMIC_FIXED_RK4,
+                                       step, ys) == GSL_SUCCESS) {
+            n++;
+        }
+    }
+    g_rand_free(rand);
+    if (n == 0) {
+        g_print("No solvable state for this geometry\n");
+        exit(1);
+    }
+
+    g_print("%" G_GSIZE_FORMAT " states, %d steps of %g s each\n",
+            n, repeat, step);
+
+    gdouble *times = g_new(gdouble, n * repeat);
+    time_method(model, D_DYNAMIC_FIXED_RK4, "rk4", y, n, times);
+    time_method(model, D_DYNAMIC_FIXED_SEMI_IMPLICIT_EULER,
+                "semi-implicit euler", y, n, times);
+
+    g_free(times);
+    g_free(y);
+    g_object_unref(model);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-recorder.c : Samples a free motion of the manipulator at several
+ *                   output rates, landing the session on every sample with
+ *                   d_dynamic_session_advance_to and interpolating them
+ *                   with a DDynamicRecorder.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gdouble duration = 1.0;
+
+static GOptionEntry entries[] =
+{
+      { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration, "simulated time in seconds", "T" },
+      { NULL  }
+};
+
+static DDynamicModel*
+create_model (void)
+{
+    const gdouble axes[3] = { 1.0, 0.8, 1.2 };
+    return d_bench_model_new(d_bench_geometry, NULL, axes);
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- compare landed and interpolated sampling");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (duration <= 0.0) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    GError *err = NULL;
+    GTimer *timer = g_timer_new();
+    gdouble periods[] = { 1e-2, 1e-3, 1e-4, 1e-5 };
+
+    g_print("%-10s %10s %10s %12s %10s %12s %12s\n", "period", "samples",
+            "steps", "landed s", "steps", "recorder s", "max diff");
+    for (guint p = 0; p < G_N_ELEMENTS(periods); p++) {
+        gdouble period = periods[p];
+        gsize n = (gsize) (duration / period + 0.5);
+
+        /* Landing on every sample, kept to compare */
+        DDynamicModel *model = create_model();
+        DDynamicSession *session = d_dynamic_session_new(model);
+        gdouble *landed = g_new(gdouble, 6 * n);
+        g_timer_start(timer);
+        for (gsize k = 0; k < n; k++) {
+            if (!d_dynamic_session_advance_to(session, (k + 1) * period, &err)) {
+                g_print("%s\n", err->message);
+                exit(1);
+            }
+            d_dynamic_session_get_state(session, landed + 6 * k);
+        }
+        gdouble landed_time = g_timer_elapsed(timer, NULL);
+        gulong landed_steps = d_dynamic_session_get_steps(session);
+        g_object_unref(session);
+        g_object_unref(model);
+
+        /* Free steps, samples interpolated into the ring buffer */
+        model = create_model();
+        session = d_dynamic_session_new(model);
+        DDynamicRecorder *recorder = d_dynamic_recorder_new(n + 1, period);
+        g_timer_start(timer);
+        if (!d_dynamic_recorder_run(recorder, session, n * period, &err)) {
+            g_print("%s\n", err->message);
+            exit(1);
+        }
+        gdouble recorder_time = g_timer_elapsed(timer, NULL);
+
+        /* Record 0 is the initial state */
+        gdouble diff = 0.0;
+        for (gsize k = 0; k < n && k + 1 < recorder->length; k++) {
+            const DDynamicRecord *record = d_dynamic_recorder_get(recorder, k + 1);
+            for (int i = 0; i < 3; i++) {
+                diff = MAX(diff, fabs(record->axes[i] - landed[6 * k + i]));
+                diff = MAX(diff, fabs(record->speed[i] - landed[6 * k + i + 3]));
+            }
+        }
+
+        g_print("%-10g %10" G_GSIZE_FORMAT " %10lu %12f %10lu %12f %12g\n",
+                period, recorder->length, landed_steps, landed_time,
+                d_dynamic_session_get_steps(session), recorder_time, diff);
+
+        d_dynamic_recorder_free(recorder);
+        g_free(landed);
+        g_object_unref(session);
+        g_object_unref(model);
+    }
+
+    g_timer_destroy(timer);
+
+    return 0;
+}
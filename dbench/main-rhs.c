@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-rhs.c : Times the right hand side of the dynamic model equations,
+ *              the cost every integrator step pays several times, over
+ *              random states. A second pass keeps the axes of each state
+ *              for a few speeds, where the position terms are reused.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gdouble a = 30.0;
+static gdouble b = 50.0;
+static gdouble h = 25.0;
+static gdouble r = 10.0;
+static gint n_states = 4096;
+static gint repeat = 100;
+static gint seed = 1;
+static gint speeds = 4;
+
+static GOptionEntry entries[] =
+{
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "states", 'n', 0, G_OPTION_ARG_INT, &n_states, "number of random states", "N" },
+      { "repeat", 0, 0, G_OPTION_ARG_INT, &repeat, "times every state is evaluated", "N" },
+      { "seed", 0, 0, G_OPTION_ARG_INT, &seed, "random seed", "S" },
+      { "speeds", 's', 0, G_OPTION_ARG_INT, &speeds, "speeds per axes in the second pass", "N" },
+      { NULL  }
+};
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- time the dynamic model right hand side");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (n_states < 1 || repeat < 1 || speeds < 1) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    const gdouble geometry[4] = { a, b, h, r };
+    const gdouble force[3] = { 0.5, 0.0, -1.0 };
+    DDynamicModel *model = d_bench_model_new(geometry, force, NULL);
+
+    /* Random states around the middle of the axes range, kept if solvable */
+    gdouble *y = g_new(gdouble, 6 * n_states);
+    gdouble dydt[6];
+    gsize n = 0;
+    GRand *rand = g_rand_new_with_seed(seed);
+    for (gint k = 0; k < n_states; k++) {
+        for (int i = 0; i < 3; i++) {
+            y[6 * n + i] = g_rand_double_range(rand, 0.6, 1.4);
+            y[6 * n + i + 3] = g_rand_double_range(rand, -1.0, 1.0);
+        }
+        if (d_dynamic_model_evaluate(model, y + 6 * n, dydt) == GSL_SUCCESS) {
+            n++;
+        }
+    }
+    g_rand_free(rand);
+    if (n == 0) {
+        g_print("No solvable state for this geometry\n");
+        exit(1);
+    }
+
+    gdouble checksum = 0.0;
+    GTimer *timer = g_timer_new();
+    for (gint i = 0; i < repeat; i++) {
+        for (gsize k = 0; k < n; k++) {
+            d_dynamic_model_evaluate(model, y + 6 * k, dydt);
+            checksum += dydt[3] + dydt[4] + dydt[5];
+        }
+    }
+    gdouble elapsed = g_timer_elapsed(timer, NULL);
+    gdouble evaluations = (gdouble) n * repeat;
+
+    g_print("%" G_GSIZE_FORMAT " states, %g evaluations in %f s\n",
+            n, evaluations, elapsed);
+    g_print("%.0f evaluations/s, %.1f ns per evaluation (checksum %.12e)\n",
+            evaluations / elapsed, 1e9 * elapsed / evaluations,
+            checksum / repeat);
+
+    /* Same axes, speeds of the following states */
+    gdouble ys[6];
+    checksum = 0.0;
+    g_timer_start(timer);
+    for (gint i = 0; i < repeat; i++) {
+        for (gsize k = 0; k < n; k++) {
+            for (gint j = 0; j < speeds; j++) {
+                gsize l = (k + j) % n;
+                for (int m = 0; m < 3; m++) {
+                    ys[m] = y[6 * k + m];
+                    ys[m + 3] = y[6 * l + m + 3];
+                }
+                d_dynamic_model_evaluate(model, ys, dydt);
+                checksum += dydt[3] + dydt[4] + dydt[5];
+            }
+        }
+    }
+    elapsed = g_timer_elapsed(timer, NULL);
+    evaluations *= speeds;
+
+    g_print("%d speeds per axes: %.1f ns per evaluation (checksum %.12e)\n",
+            speeds, 1e9 * elapsed / evaluations, checksum / repeat);
+
+    g_timer_destroy(timer);
+    g_free(y);
+    g_object_unref(model);
+
+    return 0;
+}
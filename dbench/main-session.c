@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-session.c : Samples a free motion of the manipulator at a fixed
+ *                  output rate, restarting the integrator for every sample
+ *                  with d_dynamic_model_solve_inverse and keeping it in a
+ *                  DDynamicSession.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gdouble duration = 1.0;
+static gdouble period = 1e-3;
+
+static GOptionEntry entries[] =
+{
+      { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration, "simulated time in seconds", "T" },
+      { "period", 'p', 0, G_OPTION_ARG_DOUBLE, &period, "output period in seconds", "P" },
+      { NULL  }
+};
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- compare per sample and persistent integration");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (period <= 0.0 || duration < period) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+    gsize n = (gsize) (duration / period + 0.5);
+
+    /* A new driver for every sample */
+    const gdouble axes[3] = { 1.0, 1.0, 1.0 };
+    DDynamicModel *model = d_bench_model_new(d_bench_geometry, NULL, axes);
+    GTimer *timer = g_timer_new();
+    for (gsize k = 0; k < n; k++) {
+        d_dynamic_model_solve_inverse(model, period);
+    }
+    gdouble restart_time = g_timer_elapsed(timer, NULL);
+    gdouble restart_state[6];
+    for (int i = 0; i < 3; i++) {
+        restart_state[i] = gsl_vector_get(d_dynamic_model_get_axes(model), i);
+        restart_state[i + 3] = gsl_vector_get(d_dynamic_model_get_speed(model), i);
+    }
+    g_object_unref(model);
+
+    /* One session for the whole run */
+    model = d_bench_model_new(d_bench_geometry, NULL, axes);
+    DDynamicSession *session = d_dynamic_session_new(model);
+    GError *err = NULL;
+    g_timer_start(timer);
+    for (gsize k = 1; k <= n; k++) {
+        if (!d_dynamic_session_advance_to(session, k * period, &err)) {
+            g_print("%s\n", err->message);
+            exit(1);
+        }
+    }
+    gdouble session_time = g_timer_elapsed(timer, NULL);
+    gdouble session_state[6];
+    d_dynamic_session_get_state(session, session_state);
+
+    gdouble diff = 0.0;
+    for (int i = 0; i < 6; i++) {
+        diff = MAX(diff, fabs(session_state[i] - restart_state[i]));
+    }
+
+    g_print("%" G_GSIZE_FORMAT " samples of %g s\n", n, period);
+    g_print("%-10s %12s %12s\n", "", "wall s", "sim s/wall s");
+    g_print("%-10s %12f %12.1f\n", "restart", restart_time, duration / restart_time);
+    g_print("%-10s %12f %12.1f\n", "session", session_time, duration / session_time);
+    g_print("Session steps: %lu, speedup %.2f, max state diff %g\n",
+            d_dynamic_session_get_steps(session),
+            restart_time / session_time, diff);
+
+    g_timer_destroy(timer);
+    g_object_unref(session);
+    g_object_unref(model);
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-singularity.c : Drives a straight path from the center of the
+ *                      working space out to its boundary, as the controller
+ *                      would, and reports where the singularity monitor
+ *                      calls back and what it costs per tick.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+static gdouble a = 29.3;
+static gdouble b = 64.5;
+static gdouble h = 3.8;
+static gdouble r = 10.0;
+static gdouble margin = D_SINGULARITY_MONITOR_MARGIN;
+static gint lookahead = D_SINGULARITY_MONITOR_LOOKAHEAD;
+static gdouble step = 0.01;
+static gint repeat = 200;
+
+static GOptionEntry entries[] =
+{
+      { "near-arm", 'a', 0, G_OPTION_ARG_DOUBLE, &a, "value of 'a' length in robot", "A" },
+      { "far-arm", 'b', 0, G_OPTION_ARG_DOUBLE, &b, "value of 'b' length in robot", "B" },
+      { "moving-plt", 'h', 0, G_OPTION_ARG_DOUBLE, &h, "value of 'h' length in robot", "H" },
+      { "fix-plt", 'r', 0, G_OPTION_ARG_DOUBLE, &r, "value of 'r' length in robot", "R" },
+      { "margin", 'm', 0, G_OPTION_ARG_DOUBLE, &margin, "proximity margin", NULL },
+      { "lookahead", 'l', 0, G_OPTION_ARG_INT, &lookahead, "lookahead in ticks", NULL },
+      { "step", 's', 0, G_OPTION_ARG_DOUBLE, &step, "path length per tick", NULL },
+      { "repeat", 0, 0, G_OPTION_ARG_INT, &repeat, "times the path is timed", "N" },
+      { NULL  }
+};
+
+typedef struct {
+    gsize   tick;
+    gsize   approaching;
+    gsize   within;
+} Events;
+
+static void
+on_state (DSingularityMonitor           *monitor,
+          DSingularityState             state,
+          gboolean                      direct,
+          const DSingularityProximity   *proximity,
+          gpointer                      data)
+{
+    Events *events = data;
+
+    if (state == D_SINGULARITY_STATE_APPROACHING && events->approaching == 0) {
+        events->approaching = events->tick;
+        g_print("Tick %" G_GSIZE_FORMAT ": approaching %s singularity "
+                "(direct %f, inverse %f)\n", events->tick,
+                direct ? "direct" : "inverse",
+                proximity->direct, proximity->inverse);
+    }
+    if (state == D_SINGULARITY_STATE_WITHIN_MARGIN && events->within == 0) {
+        events->within = events->tick;
+        g_print("Tick %" G_GSIZE_FORMAT ": within margin of %s singularity "
+                "(direct %f, inverse %f)\n", events->tick,
+                direct ? "direct" : "inverse",
+                proximity->direct, proximity->inverse);
+    }
+}
+
+/*
+ * Solves every tick of the path and feeds the monitor when given one.
+ * Returns the number of ticks solved before the first failure.
+ */
+static gsize
+run_path (DGeometry             *geometry,
+          DSingularityMonitor   *monitor,
+          Events                *events,
+          gsize                 n,
+          const gdouble         start[3])
+{
+    gdouble ext[3][3];
+    gdouble p[3];
+    gsl_vector_view p_view = gsl_vector_view_array(p, 3);
+    gsl_matrix_view ext_view = gsl_matrix_view_array(&ext[0][0], 3, 3);
+
+    for (gsize k = 0; k < n; k++) {
+        p[0] = start[0] + k * step;
+        p[1] = start[1];
+        p[2] = start[2];
+        if (d_solver_solve_inverse_status(geometry, &p_view.vector, NULL,
+                                          &ext_view.matrix) != D_SOLVER_STATUS_OK) {
+            return k;
+        }
+        if (monitor) {
+            events->tick = k;
+            d_singularity_monitor_update(monitor, (const gdouble (*)[3]) ext);
+        }
+    }
+    return n;
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- measure the singularity monitor along a path to the boundary");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (step <= 0.0 || lookahead < 0 || repeat < 1) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    DGeometry *geometry = d_geometry_new (a, b, h, r);
+
+    /* Start below the base, where the arms are half way */
+    gdouble start[3] = { 0.0, 0.0, 0.0 };
+    gdouble axes[] = { G_PI / 4.0, G_PI / 4.0, G_PI / 4.0 };
+    gsl_vector_view axes_view = gsl_vector_view_array(axes, 3);
+    gsl_vector_view start_view = gsl_vector_view_array(start, 3);
+    if (d_solver_solve_direct_status(geometry, &axes_view.vector,
+                                     &start_view.vector) != D_SOLVER_STATUS_OK) {
+        g_print("No starting point for this geometry\n");
+        exit(1);
+    }
+    gsize n = (gsize) ((a + b + fabs(h - r)) / step);
+
+    /* Events along the path */
+    Events events = { 0, 0, 0 };
+    DSingularityMonitor *monitor = d_singularity_monitor_new(geometry);
+    d_singularity_monitor_set_margin(monitor, margin);
+    d_singularity_monitor_set_lookahead(monitor, lookahead);
+    d_singularity_monitor_set_func(monitor, on_state, &events);
+    gsize solved = run_path(geometry, monitor, &events, n, start);
+    g_print("Tick %" G_GSIZE_FORMAT ": target out of working space\n", solved);
+
+    /* Cost per tick, with and without the monitor */
+    d_singularity_monitor_set_func(monitor, NULL, NULL);
+    GTimer *timer = g_timer_new();
+    for (gint i = 0; i < repeat; i++) {
+        run_path(geometry, NULL, &events, solved, start);
+    }
+    gdouble plain_time = g_timer_elapsed(timer, NULL);
+    g_timer_start(timer);
+    for (gint i = 0; i < repeat; i++) {
+        d_singularity_monitor_reset(monitor);
+        run_path(geometry, monitor, &events, solved, start);
+    }
+    gdouble monitor_time = g_timer_elapsed(timer, NULL);
+    gdouble ticks = (gdouble) solved * repeat;
+    g_print("Inverse solve per tick: %.1f ns, with monitor: %.1f ns "
+            "(monitor %.1f ns, %.1f %%)\n",
+            1e9 * plain_time / ticks, 1e9 * monitor_time / ticks,
+            1e9 * (monitor_time - plain_time) / ticks,
+            100.0 * (monitor_time - plain_time) / plain_time);
+
+    gboolean ok = events.within > 0 && events.within < solved
+                  && (events.approaching == 0 || events.approaching <= events.within);
+
+    g_timer_destroy(timer);
+    g_object_unref(monitor);
+    g_object_unref(geometry);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * main-steppers.c : Integrates a free motion and a stiff servoed one with
+ *                   every stepper of DDynamicStepper, reporting steps, wall
+ *                   time and error against a tight rk8pd reference.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <dsim/dsim.h>
+
+#include "dbench_model.h"
+
+static gdouble duration = 1.0;
+static gdouble tolerance = D_DYNAMIC_MODEL_TOLERANCE;
+static gdouble kp = 1e8;
+static gdouble kd = 1e8;
+
+static GOptionEntry entries[] =
+{
+      { "duration", 'd', 0, G_OPTION_ARG_DOUBLE, &duration, "simulated time in seconds", "T" },
+      { "tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance, "absolute tolerance", "E" },
+      { "kp", 'p', 0, G_OPTION_ARG_DOUBLE, &kp, "servo stiffness of the stiff case", "KP" },
+      { "kd", 'k', 0, G_OPTION_ARG_DOUBLE, &kd, "servo damping of the stiff case", "KD" },
+      { NULL  }
+};
+
+static DDynamicModel*
+create_model (gboolean servo)
+{
+    const gdouble axes[3] = { 1.0, 0.8, 1.2 };
+    const gdouble target[3] = { 1.1, 0.9, 1.1 };
+    DDynamicModel *model = d_bench_model_new(d_bench_geometry, NULL, axes);
+    if (servo) {
+        d_bench_model_set_servo(model, kp, kd, target);
+    }
+
+    return model;
+}
+
+/* Runs one stepper to duration, FALSE when the integration failed */
+static gboolean
+simulate (gboolean          servo,
+          DDynamicStepper   stepper,
+          gdouble           abs_tolerance,
+          gdouble           state[6],
+          gulong            *steps,
+          gdouble           *elapsed)
+{
+    DDynamicModel *model = create_model(servo);
+    d_dynamic_model_set_stepper(model, stepper);
+    d_dynamic_model_set_tolerance(model, abs_tolerance, 0.0);
+    DDynamicSession *session = d_dynamic_session_new(model);
+
+    GError *err = NULL;
+    GTimer *timer = g_timer_new();
+    gboolean ok = d_dynamic_session_advance_to(session, duration, &err);
+    *elapsed = g_timer_elapsed(timer, NULL);
+    if (!ok) {
+        g_print("%-8s %s\n", d_dynamic_stepper_to_string(stepper), err->message);
+        g_error_free(err);
+    }
+    d_dynamic_session_get_state(session, state);
+    *steps = d_dynamic_session_get_steps(session);
+
+    g_timer_destroy(timer);
+    g_object_unref(session);
+    g_object_unref(model);
+
+    return ok;
+}
+
+static void
+compare (gboolean servo)
+{
+    gdouble reference[6];
+    gulong steps;
+    gdouble elapsed;
+    if (!simulate(servo, D_DYNAMIC_STEPPER_RK8PD, tolerance * 1e-4,
+                  reference, &steps, &elapsed)) {
+        return;
+    }
+
+    g_print("%s, %g s\n", servo ? "Stiff servo" : "Free motion", duration);
+    g_print("%-8s %10s %12s %12s\n", "stepper", "steps", "wall s", "error");
+    for (DDynamicStepper s = 0; s < D_DYNAMIC_N_STEPPERS; s++) {
+        gdouble state[6];
+        if (!simulate(servo, s, tolerance, state, &steps, &elapsed)) {
+            continue;
+        }
+        gdouble error = 0.0;
+        for (int i = 0; i < 6; i++) {
+            error = MAX(error, fabs(state[i] - reference[i]));
+        }
+        g_print("%-8s %10lu %12f %12g\n",
+                d_dynamic_stepper_to_string(s), steps, elapsed, error);
+    }
+    g_print("\n");
+}
+
+int
+main(int argc, char* argv[])
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("- compare integrators of the dynamic model");
+    g_option_context_add_main_entries (context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error))
+    {
+        g_print("Options parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        exit(1);
+    }
+    g_option_context_free(context);
+    if (duration <= 0.0 || tolerance <= 0.0) {
+        g_print("Invalid options\n");
+        exit(1);
+    }
+
+    compare(FALSE);
+    compare(TRUE);
+
+    return 0;
+}
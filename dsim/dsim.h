@@ -25,9 +25,17 @@
 #ifndef  DSIM_INC
 #define  DSIM_INC
 
+#include <dsim/dsim_vec3.h>
 #include <dsim/dsim_geometry.h>
 #include <dsim/dsim_solver.h>
+#include <dsim/dsim_direct_solver.h>
+#include <dsim/dsim_singularity_monitor.h>
+#include <dsim/dsim_design_space.h>
+#include <dsim/dsim_workspace_field.h>
 #include <dsim/dsim_trajectory.h>
 #include <dsim/dsim_dynamics.h>
+#include <dsim/dsim_dynamic_session.h>
+#include <dsim/dsim_dynamic_ensemble.h>
+#include <dsim/dsim_dynamic_recorder.h>
 
 #endif   /* ----- #ifndef DSIM_INC  ----- */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dsim_design_space.h"
+#include "dsim_geometry.h"
+#include "dsim_solver.h"
+#include "dsim_jacobian.h"
+
+/* Number of poses handed to the batch solver at once */
+#define D_DESIGN_SPACE_CHUNK    1024
+
+/* Work item of the thread pool */
+typedef struct {
+    const DDesignCandidate  *candidate;
+    DDesignSummary          *summary;
+} DDesignTask;
+
+/* Poses shared by all the tasks */
+typedef struct {
+    gsize                   n_poses;
+    const gdouble           *x;
+    const gdouble           *y;
+    const gdouble           *z;
+} DDesignPoses;
+
+/* Private Methods */
+static void
+d_design_space_task (gpointer   data,
+                     gpointer   user_data)
+{
+    DDesignTask *task = data;
+    DDesignPoses *poses = user_data;
+
+    d_design_space_evaluate_one(task->candidate, poses->n_poses,
+                                poses->x, poses->y, poses->z,
+                                task->summary);
+}
+
+/* Public API */
+void
+d_design_space_evaluate_one (const DDesignCandidate *candidate,
+                             gsize                  n_poses,
+                             const gdouble          *x,
+                             const gdouble          *y,
+                             const gdouble          *z,
+                             DDesignSummary         *summary)
+{
+    DGeometry *geometry = d_geometry_new(candidate->a, candidate->b,
+                                         candidate->h, candidate->r);
+    gdouble *extaxes = g_new(gdouble, 9 * D_DESIGN_SPACE_CHUNK);
+    guint8 *status = g_new(guint8, D_DESIGN_SPACE_CHUNK);
+    gdouble dexterity_sum = 0.0;
+
+    *summary = (DDesignSummary) { 0 };
+    summary->dexterity_min = G_MAXDOUBLE;
+    for (int i = 0; i < 3; i++) {
+        summary->axes_min[i] = G_MAXDOUBLE;
+        summary->axes_max[i] = -G_MAXDOUBLE;
+    }
+
+    for (gsize first = 0; first < n_poses; first += D_DESIGN_SPACE_CHUNK) {
+        gsize n = MIN(D_DESIGN_SPACE_CHUNK, n_poses - first);
+        d_solver_solve_inverse_batch(geometry, n,
+                                     x + first, y + first, z + first,
+                                     NULL, NULL, NULL,
+                                     extaxes, status);
+
+        for (gsize k = 0; k < n; k++) {
+            if (status[k] != D_SOLVER_STATUS_OK) {
+                continue;
+            }
+            summary->n_reachable++;
+
+            /* Motor angle of arm i is the first column of row i */
+            gdouble *ext = extaxes + 9 * k;
+            for (int i = 0; i < 3; i++) {
+                summary->axes_min[i] = MIN(summary->axes_min[i], ext[3 * i]);
+                summary->axes_max[i] = MAX(summary->axes_max[i], ext[3 * i]);
+            }
+
+            gsl_matrix_view ext_view = gsl_matrix_view_array(ext, 3, 3);
+            gdouble dexterity = d_jacobian_dexterity(geometry,
+                                                     &ext_view.matrix);
+            if (dexterity == 0.0) {
+                summary->n_singular++;
+            }
+            summary->dexterity_min = MIN(summary->dexterity_min, dexterity);
+            dexterity_sum += dexterity;
+        }
+    }
+
+    if (summary->n_reachable > 0) {
+        summary->reach_fraction = (gdouble) summary->n_reachable / n_poses;
+        summary->dexterity_mean = dexterity_sum / summary->n_reachable;
+    } else {
+        summary->dexterity_min = 0.0;
+        for (int i = 0; i < 3; i++) {
+            summary->axes_min[i] = 0.0;
+            summary->axes_max[i] = 0.0;
+        }
+    }
+
+    g_free(extaxes);
+    g_free(status);
+    g_object_unref(geometry);
+}
+
+gboolean
+d_design_space_evaluate (const DDesignCandidate *candidates,
+                         gsize                  n_candidates,
+                         gsize                  n_poses,
+                         const gdouble          *x,
+                         const gdouble          *y,
+                         const gdouble          *z,
+                         gint                   n_threads,
+                         DDesignSummary         *summaries,
+                         GError                 **err)
+{
+    g_return_val_if_fail(n_candidates == 0 || (candidates && summaries), FALSE);
+    g_return_val_if_fail(n_poses == 0 || (x && y && z), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    if (n_threads <= 0) {
+        n_threads = g_get_num_processors();
+    }
+
+    DDesignPoses poses = { n_poses, x, y, z };
+    GThreadPool *pool = g_thread_pool_new(d_design_space_task, &poses,
+                                          n_threads, TRUE, err);
+    if (!pool) {
+        return FALSE;
+    }
+
+    DDesignTask *tasks = g_new(DDesignTask, n_candidates);
+    for (gsize i = 0; i < n_candidates; i++) {
+        tasks[i].candidate = &candidates[i];
+        tasks[i].summary = &summaries[i];
+        g_thread_pool_push(pool, &tasks[i], NULL);
+    }
+
+    /* Waits for every task to finish */
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_free(tasks);
+
+    return TRUE;
+}
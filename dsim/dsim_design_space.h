@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_design_space.h : Evaluation of many candidate geometries against a
+ *                       common set of target poses. A group of static
+ *                       methods that run on a thread pool and return one
+ *                       summary per candidate.
+ */
+
+#ifndef  DSIM_DESIGN_SPACE_INC
+#define  DSIM_DESIGN_SPACE_INC
+
+#include <glib.h>
+
+/* Geometry parameters of a candidate, as in d_geometry_new */
+typedef struct _DDesignCandidate DDesignCandidate;
+struct _DDesignCandidate {
+    gdouble         a;
+    gdouble         b;
+    gdouble         h;
+    gdouble         r;
+};
+
+/*
+ * Statistics of a candidate over the pose set. Dexterity and axes ranges
+ * are taken over the reachable poses only and are zero when none is.
+ */
+typedef struct _DDesignSummary DDesignSummary;
+struct _DDesignSummary {
+    gsize           n_reachable;        /* Poses solved */
+    gsize           n_singular;         /* Reachable poses with null
+                                           dexterity */
+    gdouble         reach_fraction;     /* n_reachable over the pose count */
+    gdouble         dexterity_min;      /* See d_jacobian_dexterity */
+    gdouble         dexterity_mean;
+    gdouble         axes_min[3];        /* Range of each motor angle */
+    gdouble         axes_max[3];
+};
+
+/*
+ * Evaluates every candidate against every pose (x[k], y[k], z[k]) and fills
+ * summaries[i] for candidates[i]. Each candidate is a task for a pool of
+ * n_threads threads, or one per processor when n_threads is 0 or less, and
+ * solves the poses in chunks with d_solver_solve_inverse_batch. Nothing is
+ * kept per pose. Returns FALSE and sets err when the pool can't be
+ * created, summaries are undefined then.
+ */
+gboolean    d_design_space_evaluate (const DDesignCandidate *candidates,
+                                     gsize                  n_candidates,
+                                     gsize                  n_poses,
+                                     const gdouble          *x,
+                                     const gdouble          *y,
+                                     const gdouble          *z,
+                                     gint                   n_threads,
+                                     DDesignSummary         *summaries,
+                                     GError                 **err);
+
+/* Summary of a single candidate, evaluated in the calling thread */
+void        d_design_space_evaluate_one
+                                    (const DDesignCandidate *candidate,
+                                     gsize                  n_poses,
+                                     const gdouble          *x,
+                                     const gdouble          *y,
+                                     const gdouble          *z,
+                                     DDesignSummary         *summary);
+
+#endif   /* ----- #ifndef DSIM_DESIGN_SPACE_INC  ----- */
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_direct_solver.c :
+ */
+
+#include "dsim_direct_solver.h"
+#include "dsim_vec3.h"
+#include "dsim_solver_kernel.h"
+
+/* GType Register */
+G_DEFINE_TYPE(DDirectSolver, d_direct_solver, G_TYPE_OBJECT);
+
+/* DDirectSolver implementation */
+static void
+d_direct_solver_init (DDirectSolver *self)
+{
+    self->geometry = NULL;
+    self->tolerance = D_DIRECT_SOLVER_TOLERANCE;
+    self->max_iterations = D_DIRECT_SOLVER_MAX_ITERATIONS;
+    d_direct_solver_reset(self);
+}
+
+static void
+d_direct_solver_dispose (GObject *gobject)
+{
+    DDirectSolver *self = D_DIRECT_SOLVER(gobject);
+
+    if (self->geometry) {
+        g_object_unref(self->geometry);
+        self->geometry = NULL;
+    }
+
+    /* Chain Up */
+    G_OBJECT_CLASS(d_direct_solver_parent_class)->dispose(gobject);
+}
+
+static void
+d_direct_solver_finalize (GObject *gobject)
+{
+    /* Chain Up */
+    G_OBJECT_CLASS(d_direct_solver_parent_class)->finalize(gobject);
+}
+
+static void
+d_direct_solver_class_init (DDirectSolverClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    gobject_class->dispose = d_direct_solver_dispose;
+    gobject_class->finalize = d_direct_solver_finalize;
+}
+
+/*
+ * Newton iteration from the stored position. Returns FALSE if it did not
+ * converge to the branch of the closed form, otherwise the solution is in
+ * pos and the number of steps taken in iterations.
+ */
+static gboolean
+d_direct_solver_newton (DDirectSolver   *self,
+                        gdouble         pb[3][3],
+                        DVec3           *pos,
+                        guint           *iterations)
+{
+    const gdouble b2 = self->geometry->derived.b2;
+    const gdouble tol = self->tolerance * b2;
+    DVec3 p = d_vec3(self->pos[0], self->pos[1], self->pos[2]);
+    DVec3 elbow[3];
+    for (int i = 0; i < 3; i++) {
+        elbow[i] = d_vec3(pb[i][0], pb[i][1], pb[i][2]);
+    }
+
+    for (guint it = 0; ; it++) {
+        DMat3 jac;
+        DVec3 f;
+        gboolean converged = TRUE;
+        for (int i = 0; i < 3; i++) {
+            DVec3 r = d_vec3_sub(p, elbow[i]);
+            f.v[i] = b2 - d_vec3_dot(r, r);
+            converged = converged && fabs(f.v[i]) <= tol;
+            for (int j = 0; j < 3; j++) {
+                jac.m[i][j] = 2.0 * r.v[j];
+            }
+        }
+        if (converged) {
+            *iterations = it;
+            break;
+        }
+
+        DVec3 step;
+        if (it == self->max_iterations || !d_mat3_solve(&jac, f, &step)) {
+            return FALSE;
+        }
+        p = d_vec3_add(p, step);
+    }
+
+    /*
+     * Both assembly branches satisfy the constraints. The closed form takes
+     * the one on the +z side of the plane through the elbows.
+     */
+    DVec3 e1 = d_vec3_sub(elbow[1], elbow[0]);
+    DVec3 e2 = d_vec3_sub(elbow[2], elbow[0]);
+    DVec3 n = d_vec3(e1.v[1] * e2.v[2] - e1.v[2] * e2.v[1],
+                     e1.v[2] * e2.v[0] - e1.v[0] * e2.v[2],
+                     e1.v[0] * e2.v[1] - e1.v[1] * e2.v[0]);
+    gdouble side = d_vec3_dot(d_vec3_sub(p, elbow[0]), n);
+    if (!(side * n.v[2] > 0.0)) {
+        return FALSE;
+    }
+    *pos = p;
+    return TRUE;
+}
+
+/* Public API */
+DDirectSolver*
+d_direct_solver_new (DGeometry  *geometry)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), NULL);
+
+    DDirectSolver *ds = g_object_new(D_TYPE_DIRECT_SOLVER, NULL);
+    ds->geometry = g_object_ref(geometry);
+
+    return ds;
+}
+
+void
+d_direct_solver_reset (DDirectSolver    *self)
+{
+    g_return_if_fail(D_IS_DIRECT_SOLVER(self));
+
+    self->warm = FALSE;
+    self->last_iterations = 0;
+    self->last_fallback = FALSE;
+    self->stats.solves = 0;
+    self->stats.iterations = 0;
+    self->stats.fallbacks = 0;
+}
+
+void
+d_direct_solver_set_tolerance (DDirectSolver    *self,
+                               gdouble          tolerance)
+{
+    g_return_if_fail(D_IS_DIRECT_SOLVER(self));
+    g_return_if_fail(tolerance > 0.0);
+
+    self->tolerance = tolerance;
+}
+
+void
+d_direct_solver_set_max_iterations (DDirectSolver   *self,
+                                    guint           max_iterations)
+{
+    g_return_if_fail(D_IS_DIRECT_SOLVER(self));
+
+    self->max_iterations = max_iterations;
+}
+
+DSolverStatus
+d_direct_solver_solve_array (DDirectSolver  *self,
+                             const gdouble  axes[3],
+                             gdouble        pos[3])
+{
+    g_return_val_if_fail(D_IS_DIRECT_SOLVER(self), D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+
+    gdouble pb[3][3];
+    d_solver_elbows(self->geometry, axes, pb);
+
+    DVec3 p;
+    guint iterations = 0;
+    if (self->warm && d_direct_solver_newton(self, pb, &p, &iterations)) {
+        self->last_iterations = iterations;
+        self->last_fallback = FALSE;
+        self->stats.solves++;
+        self->stats.iterations += iterations;
+        for (int i = 0; i < 3; i++) {
+            self->pos[i] = pos[i] = p.v[i];
+        }
+        return D_SOLVER_STATUS_OK;
+    }
+
+    /* Cold start or no convergence */
+    self->last_iterations = 0;
+    self->last_fallback = TRUE;
+    DSolverStatus status = d_solver_direct_kernel(self->geometry, axes, self->pos);
+    if (status != D_SOLVER_STATUS_OK) {
+        self->warm = FALSE;
+        return status;
+    }
+    self->warm = TRUE;
+    self->stats.solves++;
+    self->stats.fallbacks++;
+    for (int i = 0; i < 3; i++) {
+        pos[i] = self->pos[i];
+    }
+    return D_SOLVER_STATUS_OK;
+}
+
+void
+d_direct_solver_solve (DDirectSolver    *self,
+                       gsl_vector       *axes,
+                       gsl_vector       *pos,
+                       GError           **err)
+{
+    g_return_if_fail(D_IS_DIRECT_SOLVER(self));
+    g_return_if_fail(axes != NULL);
+    g_return_if_fail(pos != NULL);
+    g_return_if_fail(err == NULL || *err == NULL);
+
+    gdouble t[] = {
+        gsl_vector_get(axes, 0),
+        gsl_vector_get(axes, 1),
+        gsl_vector_get(axes, 2)
+    };
+    gdouble p[3];
+    DSolverStatus status = d_direct_solver_solve_array(self, t, p);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Could not reach point in cartesian space: %s",
+                d_solver_status_to_string(status));
+        return;
+    }
+    gsl_vector_set(pos, 0, p[0]);
+    gsl_vector_set(pos, 1, p[1]);
+    gsl_vector_set(pos, 2, p[2]);
+}
+
+guint
+d_direct_solver_get_last_iterations (DDirectSolver  *self)
+{
+    g_return_val_if_fail(D_IS_DIRECT_SOLVER(self), 0);
+
+    return self->last_iterations;
+}
+
+gboolean
+d_direct_solver_get_last_fallback (DDirectSolver    *self)
+{
+    g_return_val_if_fail(D_IS_DIRECT_SOLVER(self), FALSE);
+
+    return self->last_fallback;
+}
+
+void
+d_direct_solver_get_stats (DDirectSolver        *self,
+                           DDirectSolverStats   *stats)
+{
+    g_return_if_fail(D_IS_DIRECT_SOLVER(self));
+    g_return_if_fail(stats != NULL);
+
+    *stats = self->stats;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_ensemble.c :
+ */
+
+#include "dsim_dynamic_ensemble.h"
+#include "dsim_dynamic_session.h"
+#include <math.h>
+
+/* Private Methods */
+static void
+d_dynamic_ensemble_member (gpointer data,
+                           gpointer user_data)
+{
+    gsize i = GPOINTER_TO_SIZE(data) - 1;
+    DDynamicEnsemble *ensemble = user_data;
+    gsize n = ensemble->n;
+
+    /* Objects of this member only, the geometry and spec are read */
+    DManipulator *manipulator = d_manipulator_new(ensemble->geometry,
+                                                  ensemble->specs[i]);
+    DDynamicModel *model = d_dynamic_model_new(manipulator);
+    d_dynamic_model_set_stepper(model, ensemble->stepper);
+    d_dynamic_model_set_tolerance(model, ensemble->abs_tolerance,
+                                  ensemble->rel_tolerance);
+
+    gdouble state[6];
+    for (int c = 0; c < 6; c++) {
+        state[c] = ensemble->state[c][i];
+    }
+    gdouble torque[3] = { 0.0, 0.0, 0.0 };
+    gdouble gravity[3] = {
+        ensemble->gravity[0], ensemble->gravity[1], ensemble->gravity[2]
+    };
+    gsl_vector_view torque_view = gsl_vector_view_array(torque, 3);
+    gsl_vector_view view = gsl_vector_view_array(gravity, 3);
+    d_dynamic_model_set_gravity(model, &view.vector);
+    view = gsl_vector_view_array(&state[0], 3);
+    d_dynamic_model_set_axes(model, &view.vector);
+    view = gsl_vector_view_array(&state[3], 3);
+    d_dynamic_model_set_speed(model, &view.vector);
+    d_dynamic_model_set_torque(model, &torque_view.vector);
+
+    DDynamicSession *session = d_dynamic_session_new(model);
+    ensemble->status[i] = D_DYNAMIC_ENSEMBLE_STATUS_OK;
+
+    gsize s = 0;
+    for (; s < ensemble->n_samples; s++) {
+        gdouble time = s * ensemble->period;
+        if (ensemble->programs[i]) {
+            ensemble->programs[i](time, state, torque, ensemble->program_data[i]);
+            d_dynamic_model_set_torque(model, &torque_view.vector);
+        }
+        if (!d_dynamic_session_advance_to(session, time + ensemble->period, NULL)) {
+            ensemble->status[i] = D_DYNAMIC_ENSEMBLE_STATUS_FAILED;
+            break;
+        }
+        d_dynamic_session_get_state(session, state);
+        for (int c = 0; c < 6; c++) {
+            ensemble->samples[c][s * n + i] = state[c];
+        }
+    }
+    for (; s < ensemble->n_samples; s++) {
+        for (int c = 0; c < 6; c++) {
+            ensemble->samples[c][s * n + i] = NAN;
+        }
+    }
+
+    for (int c = 0; c < 6; c++) {
+        ensemble->state[c][i] = state[c];
+    }
+    ensemble->steps[i] = d_dynamic_session_get_steps(session);
+
+    g_object_unref(session);
+    g_object_unref(model);
+    g_object_unref(manipulator);
+}
+
+/* Public API */
+DDynamicEnsemble*
+d_dynamic_ensemble_new (DGeometry   *geometry,
+                        gsize       n,
+                        gsize       n_samples,
+                        gdouble     period)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), NULL);
+    g_return_val_if_fail(n > 0, NULL);
+    g_return_val_if_fail(period > 0.0, NULL);
+
+    DDynamicEnsemble *ensemble = g_new(DDynamicEnsemble, 1);
+    ensemble->n = n;
+    ensemble->geometry = g_object_ref(geometry);
+    ensemble->n_samples = n_samples;
+    ensemble->period = period;
+
+    for (int c = 0; c < 3; c++) {
+        ensemble->gravity[c] = 0.0;
+    }
+    ensemble->stepper = D_DYNAMIC_MODEL_STEPPER;
+    ensemble->abs_tolerance = D_DYNAMIC_MODEL_TOLERANCE;
+    ensemble->rel_tolerance = 0.0;
+
+    ensemble->specs = g_new(DDynamicSpec *, n);
+    ensemble->programs = g_new0(DDynamicTorqueProgram, n);
+    ensemble->program_data = g_new0(gpointer, n);
+    DDynamicSpec *spec = d_dynamic_spec_new();
+    for (gsize i = 0; i < n; i++) {
+        ensemble->specs[i] = g_object_ref(spec);
+    }
+    g_object_unref(spec);
+
+    for (int c = 0; c < 6; c++) {
+        ensemble->state[c] = g_new0(gdouble, n);
+        ensemble->samples[c] = g_new(gdouble, n_samples * n);
+    }
+    ensemble->status = g_new0(guint8, n);
+    ensemble->steps = g_new0(gulong, n);
+
+    return ensemble;
+}
+
+void
+d_dynamic_ensemble_free (DDynamicEnsemble   *ensemble)
+{
+    if (!ensemble) {
+        return;
+    }
+
+    for (gsize i = 0; i < ensemble->n; i++) {
+        g_object_unref(ensemble->specs[i]);
+    }
+    g_free(ensemble->specs);
+    g_free(ensemble->programs);
+    g_free(ensemble->program_data);
+    for (int c = 0; c < 6; c++) {
+        g_free(ensemble->state[c]);
+        g_free(ensemble->samples[c]);
+    }
+    g_free(ensemble->status);
+    g_free(ensemble->steps);
+    g_object_unref(ensemble->geometry);
+    g_free(ensemble);
+}
+
+void
+d_dynamic_ensemble_set_member (DDynamicEnsemble         *ensemble,
+                               gsize                    i,
+                               DDynamicSpec             *spec,
+                               const gdouble            state[6],
+                               DDynamicTorqueProgram    program,
+                               gpointer                 user_data)
+{
+    g_return_if_fail(ensemble != NULL);
+    g_return_if_fail(i < ensemble->n);
+    g_return_if_fail(D_IS_DYNAMIC_SPEC(spec));
+
+    g_object_ref(spec);
+    g_object_unref(ensemble->specs[i]);
+    ensemble->specs[i] = spec;
+    for (int c = 0; c < 6; c++) {
+        ensemble->state[c][i] = state[c];
+    }
+    ensemble->programs[i] = program;
+    ensemble->program_data[i] = user_data;
+}
+
+gboolean
+d_dynamic_ensemble_run (DDynamicEnsemble    *ensemble,
+                        gint                n_threads,
+                        GError              **err)
+{
+    g_return_val_if_fail(ensemble != NULL, FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    if (n_threads <= 0) {
+        n_threads = g_get_num_processors();
+    }
+
+    GThreadPool *pool = g_thread_pool_new(d_dynamic_ensemble_member, ensemble,
+                                          n_threads, TRUE, err);
+    if (!pool) {
+        return FALSE;
+    }
+    /* Members are pushed as i + 1, the pool doesn't take NULL */
+    for (gsize i = 0; i < ensemble->n; i++) {
+        g_thread_pool_push(pool, GSIZE_TO_POINTER(i + 1), NULL);
+    }
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    return TRUE;
+}
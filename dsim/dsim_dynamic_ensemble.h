@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_ensemble.h : Many independent simulations of the dynamic
+ *                           model, one per member, run on a thread pool
+ *                           with their states and samples stored by
+ *                           channel.
+ */
+
+#ifndef  DSIM_DYNAMIC_ENSEMBLE_INC
+#define  DSIM_DYNAMIC_ENSEMBLE_INC
+
+#include <glib.h>
+#include <dsim/dsim_geometry.h>
+#include <dsim/dsim_dynamic_spec.h>
+#include <dsim/dsim_dynamics.h>
+
+/*
+ * Torque on the axes of a member for the sample period starting at time,
+ * from its state at that time. The torque is held over the whole period.
+ * Called from the pool threads, so user_data must be safe to read there.
+ */
+typedef void (*DDynamicTorqueProgram)   (gdouble        time,
+                                         const gdouble  state[6],
+                                         gdouble        torque[3],
+                                         gpointer       user_data);
+
+/* Per member status after a run */
+typedef enum {
+    D_DYNAMIC_ENSEMBLE_STATUS_OK = 0,
+    D_DYNAMIC_ENSEMBLE_STATUS_FAILED    /* Integration failed, samples from
+                                           then on are NaN */
+} DDynamicEnsembleStatus;
+
+/*
+ * n members sharing a geometry, each with its own dynamic spec, initial
+ * state and torque program. Every array is indexed by member, and states
+ * are split by channel: q1, q2, q3 then their speeds. Sample s of member
+ * i, taken at time (s + 1) * period, is samples[c][s * n + i].
+ */
+typedef struct _DDynamicEnsemble DDynamicEnsemble;
+struct _DDynamicEnsemble {
+    gsize                   n;
+    DGeometry               *geometry;
+
+    /* Sampling, the duration of a run is n_samples * period */
+    gsize                   n_samples;
+    gdouble                 period;
+
+    /* Settings shared by every member */
+    gdouble                 gravity[3];
+    DDynamicStepper         stepper;
+    gdouble                 abs_tolerance;
+    gdouble                 rel_tolerance;
+
+    /* Members, filled with d_dynamic_ensemble_set_member */
+    DDynamicSpec            **specs;
+    DDynamicTorqueProgram   *programs;
+    gpointer                *program_data;
+
+    /* Current states, initial before a run and final after it */
+    gdouble                 *state[6];
+
+    /* Outputs of a run */
+    gdouble                 *samples[6];
+    guint8                  *status;
+    gulong                  *steps;
+};
+
+/*
+ * Ensemble of n members over n_samples periods. Members start with no
+ * torque, the default dynamic spec and the axes at 0; gravity, stepper and
+ * tolerances are the ones of a new DDynamicModel.
+ */
+DDynamicEnsemble*   d_dynamic_ensemble_new      (DGeometry      *geometry,
+                                                 gsize          n,
+                                                 gsize          n_samples,
+                                                 gdouble        period);
+
+void                d_dynamic_ensemble_free     (DDynamicEnsemble   *ensemble);
+
+/*
+ * Sets member i. The spec is referenced, and a NULL program leaves the
+ * torque at 0.
+ */
+void                d_dynamic_ensemble_set_member
+                                                (DDynamicEnsemble       *ensemble,
+                                                 gsize                  i,
+                                                 DDynamicSpec           *spec,
+                                                 const gdouble          state[6],
+                                                 DDynamicTorqueProgram  program,
+                                                 gpointer               user_data);
+
+/*
+ * Runs every member from its current state, each one a task for a pool of
+ * n_threads threads, or one per processor when n_threads is 0 or less.
+ * Members that fail are marked in status and don't stop the others.
+ * Returns FALSE and sets err when the pool can't be created.
+ */
+gboolean            d_dynamic_ensemble_run      (DDynamicEnsemble   *ensemble,
+                                                 gint               n_threads,
+                                                 GError             **err);
+
+#endif   /* ----- #ifndef DSIM_DYNAMIC_ENSEMBLE_INC  ----- */
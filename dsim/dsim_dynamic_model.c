@@ -22,8 +22,11 @@
  * dsim_dynamic_model.c :
  */
 
+#include <math.h>
+#include <string.h>
+
 #include "dsim_dynamics.h"
-#include <gsl/gsl_permutation.h>
+#include "dsim_vec3.h"
 
 /* Forward declarations */
 static void         d_dynamic_model_class_init      (DDynamicModelClass  *klass);
@@ -40,72 +43,82 @@ static void         d_dynamic_model_set_geometry    (DDynamicModel  *self,
 static void         d_dynamic_model_set_dynamic_spec(DDynamicModel  *self,
                                                      DDynamicSpec   *dynamic_spec);
 
-static gsl_matrix*  d_dynamic_model_get_direct_jacobian_dt
-                                                    (DDynamicModel  *self,
-                                                     gsl_vector     *axes,
-                                                     gsl_vector     *speed,
-                                                     GError         **err);
+/*
+ * Kinematic state of one evaluation, for a given (q, dq/dt). Every matrix
+ * of the model is built from it, so the direct kinematics and trigonometry
+ * are solved once per evaluation. Its axes and speed are also the keys of
+ * the position and velocity cache tiers.
+ */
+typedef struct {
+    DVec3       axes;
+    DVec3       speed;
 
-static gsl_matrix*  d_dynamic_model_get_direct_jacobian_inv
-                                                    (DDynamicModel  *self,
-                                                     gsl_vector     *axes,
-                                                     GError         **err);
+    /* Per arm trigonometric terms of the axes */
+    gdouble     sin_t[3];
+    gdouble     cos_t[3];
 
-static gsl_matrix*  d_dynamic_model_get_inverse_jacobian
+    /* Platform position and speed */
+    DVec3       pos;
+    DVec3       speed_pos;
+
+    /* Inverse jacobian and direct jacobian inverse */
+    DMat3       jacobian_q;
+    DMat3       jacobian_p_inv;
+
+    /* K = Jq * Jp⁻ᵀ, shared by every model matrix */
+    DMat3       k;
+} DDynamicModelKinematics;
+
+static const DMat3* d_dynamic_model_get_direct_jacobian_dt
                                                     (DDynamicModel  *self,
-                                                     gsl_vector     *axes,
-                                                     GError         **err);
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_matrix*  d_dynamic_model_get_inverse_jacobian_dt
+static const DMat3* d_dynamic_model_get_inverse_jacobian_dt
                                                     (DDynamicModel  *self,
-                                                     gsl_vector     *axes,
-                                                     gsl_vector     *speed,
-                                                     GError         **err);
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_matrix*  d_dynamic_model_get_inertia_axes(DDynamicModel  *self);
+static const DMat3* d_dynamic_model_get_inertia_axes(DDynamicModel  *self);
 
-static gsl_matrix*  d_dynamic_model_get_mass_pos    (DDynamicModel  *self);
+static const DMat3* d_dynamic_model_get_mass_pos    (DDynamicModel  *self);
 
-static gsl_matrix*  d_dynamic_model_get_mass_axes   (DDynamicModel  *self,
-                                                     gsl_vector     *axes);
+static const DMat3* d_dynamic_model_get_mass_axes   (DDynamicModel  *self,
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_matrix*  d_dynamic_model_get_model_inertia_inv
+static const DMat3* d_dynamic_model_get_model_inertia_ldlt
                                                     (DDynamicModel  *self,
-                                                     gsl_vector     *axes);
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_matrix*  d_dynamic_model_get_model_mass  (DDynamicModel  *self,
-                                                     gsl_vector     *axes);
+static const DMat3* d_dynamic_model_get_model_mass  (DDynamicModel  *self,
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_matrix*  d_dynamic_model_get_model_coriolis
+static const DMat3* d_dynamic_model_get_model_coriolis
                                                     (DDynamicModel  *self,
-                                                     gsl_vector     *axes,
-                                                     gsl_vector     *speed);
+                                                     const DDynamicModelKinematics *ks);
 
-static gsl_vector*  d_dynamic_model_get_model_torque(DDynamicModel  *self,
-                                                     gsl_vector     *axes);
+static const DVec3* d_dynamic_model_get_model_torque(DDynamicModel  *self,
+                                                     const DDynamicModelKinematics *ks);
 
 #define D_DYNAMIC_MODEL_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), D_TYPE_DYNAMIC_MODEL, DDynamicModelPrivate))
 struct _DDynamicModelPrivate {
+    /* Kinematic state of the last evaluation */
+    DDynamicModelKinematics kinematics;
+
     /* Useful matrices */
-    gsl_matrix  *jacobian_p_inv;
-    gsl_matrix  *jacobian_p_dot;
-    gsl_matrix  *jacobian_q;
-    gsl_matrix  *jacobian_q_dot;
+    DMat3       jacobian_p_dot;
+    DMat3       jacobian_q_dot;
 
-    gsl_matrix  *mass_axes;
-    gsl_matrix  *mass_pos;
-    gsl_matrix  *inertia_axes;
+    DMat3       mass_axes;
+    DMat3       mass_pos;
+    DMat3       inertia_axes;
 
     /* Model matrices */
-    gsl_matrix  *model_mass;
-    gsl_matrix  *model_coriolis;
-    gsl_matrix  *model_inertia_inv;
-    gsl_vector  *model_torque;
+    DMat3       model_mass;
+    DMat3       model_coriolis;
+    DMat3       model_inertia_ldlt;
+    DVec3       model_torque;
 
     /* Update flags for some useful matrices */
-    gboolean    jpi_update;
     gboolean    jpd_update;
-    gboolean    jq_update;
     gboolean    jqd_update;
 
     gboolean    ma_update;
@@ -117,6 +130,39 @@ struct _DDynamicModelPrivate {
     gboolean    mc_update;
     gboolean    mi_update;
     gboolean    mt_update;
+
+    /*
+     * Cache tiers. Parameters key the constant matrices, the axes of the
+     * kinematic state key the position ones and its speed the rest.
+     */
+    gboolean    params_valid;
+    DGeometry   *params_geometry;
+    DDynamicSpec *params_spec;
+    gdouble     params[8];
+
+    gboolean    position_valid;
+    gboolean    velocity_valid;
+
+    /* Integration method */
+    DDynamicStepper stepper;
+    gdouble     abs_tolerance;
+    gdouble     rel_tolerance;
+
+    /* Joint space servo */
+    gdouble     servo_kp;
+    gdouble     servo_kd;
+    DVec3       servo_target;
+};
+
+/* Names of the gsl_odeiv2 steppers by DDynamicStepper */
+static const gchar *d_dynamic_stepper_names[D_DYNAMIC_N_STEPPERS] = {
+    "rk4",
+    "rkf45",
+    "rkck",
+    "rk8pd",
+    "msadams",
+    "bsimp",
+    "msbdf"
 };
 
 /* GType Register */
@@ -133,33 +179,31 @@ d_dynamic_model_init (DDynamicModel   *self)
     self->force = gsl_vector_calloc(3);
     self->gravity = gsl_vector_calloc(3);
 
-    priv->jacobian_p_inv = gsl_matrix_alloc(3, 3);
-    priv->jacobian_p_dot = gsl_matrix_alloc(3, 3);
-    priv->jacobian_q = gsl_matrix_alloc(3, 3);
-    priv->jacobian_q_dot = gsl_matrix_alloc(3, 3);
-
     priv->jpd_update = TRUE;
-    priv->jq_update = TRUE;
-    priv->jpi_update = TRUE;
     priv->jqd_update = TRUE;
 
-    priv->mass_axes = gsl_matrix_alloc(3, 3);
-    priv->mass_pos = gsl_matrix_alloc(3, 3);
-    priv->inertia_axes = gsl_matrix_alloc(3, 3);
-
     priv->ma_update = TRUE;
     priv->mp_update = TRUE;
     priv->ia_update = TRUE;
 
-    priv->model_mass = gsl_matrix_alloc(3, 3);
-    priv->model_coriolis = gsl_matrix_alloc(3, 3);
-    priv->model_inertia_inv = gsl_matrix_alloc(3, 3);
-    priv->model_torque = gsl_vector_alloc(3);
-
     priv->mm_update = TRUE;
     priv->mc_update = TRUE;
     priv->mi_update = TRUE;
     priv->mt_update = TRUE;
+
+    priv->params_valid = FALSE;
+    priv->params_geometry = NULL;
+    priv->params_spec = NULL;
+    priv->position_valid = FALSE;
+    priv->velocity_valid = FALSE;
+
+    priv->stepper = D_DYNAMIC_MODEL_STEPPER;
+    priv->abs_tolerance = D_DYNAMIC_MODEL_TOLERANCE;
+    priv->rel_tolerance = 0.0;
+
+    priv->servo_kp = 0.0;
+    priv->servo_kd = 0.0;
+    priv->servo_target = d_vec3(0.0, 0.0, 0.0);
 }
 
 static void
@@ -176,7 +220,6 @@ static void
 d_dynamic_model_dispose (GObject *gobject)
 {
     DDynamicModel *self = D_DYNAMIC_MODEL(gobject);
-    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (self->manipulator) {
         g_object_unref(self->manipulator);
@@ -190,50 +233,6 @@ d_dynamic_model_dispose (GObject *gobject)
         gsl_vector_free(self->gravity);
         self->gravity = NULL;
     }
-    if (priv->jacobian_p_inv) {
-        gsl_matrix_free(priv->jacobian_p_inv);
-        priv->jacobian_p_inv = NULL;
-    }
-    if (priv->jacobian_p_dot) {
-        gsl_matrix_free(priv->jacobian_p_dot);
-        priv->jacobian_p_dot = NULL;
-    }
-    if (priv->jacobian_q) {
-        gsl_matrix_free(priv->jacobian_q);
-        priv->jacobian_q = NULL;
-    }
-    if (priv->jacobian_q_dot) {
-        gsl_matrix_free(priv->jacobian_q_dot);
-        priv->jacobian_q_dot = NULL;
-    }
-    if (priv->mass_axes) {
-        gsl_matrix_free(priv->mass_axes);
-        priv->mass_axes = NULL;
-    }
-    if (priv->mass_pos) {
-        gsl_matrix_free(priv->mass_pos);
-        priv->mass_pos = NULL;
-    }
-    if (priv->inertia_axes) {
-        gsl_matrix_free(priv->inertia_axes);
-        priv->inertia_axes = NULL;
-    }
-    if (priv->model_mass) {
-        gsl_matrix_free(priv->model_mass);
-        priv->model_mass = NULL;
-    }
-    if (priv->model_coriolis) {
-        gsl_matrix_free(priv->model_coriolis);
-        priv->model_coriolis = NULL;
-    }
-    if (priv->model_inertia_inv) {
-        gsl_matrix_free(priv->model_inertia_inv);
-        priv->model_inertia_inv = NULL;
-    }
-    if (priv->model_torque) {
-        gsl_vector_free(priv->model_torque);
-        priv->model_torque = NULL;
-    }
 
     /*  Chain Up */
     G_OBJECT_CLASS(d_dynamic_model_parent_class)->dispose(gobject);
@@ -256,273 +255,206 @@ d_dynamic_model_set_manipulator (DDynamicModel  *self,
 }
 
 /*
- * Update direct jacobian inverse matrix with current parameters
+ * Solve the position part of the kinematic state for the given axes, leaving
+ * the model alone. Nothing is allocated, except the GError on failure when
+ * err is not NULL. Fails if the position is out of the working space or the
+ * direct jacobian is singular.
  */
-static void
-d_dynamic_model_update_jpi (DDynamicModel   *self,
-                            gsl_vector      *axes,
-                            GError          **err)
+static gboolean
+d_dynamic_model_kinematics_position (DGeometry                  *geometry,
+                                     DVec3                      axes,
+                                     DDynamicModelKinematics    *ks,
+                                     GError                     **err)
 {
-    g_return_if_fail(err == NULL || *err == NULL);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
-    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
-
-    gsl_vector *pos;
-    gsl_matrix *jpi = priv->jacobian_p_inv;
-    DGeometry *geometry = self->manipulator->geometry;
+    const DGeometryConstants *c = &geometry->derived;
     gdouble a = geometry->a;
-    gdouble h = geometry->h;
-    gdouble r = geometry->r;
-
-    gsl_matrix_set_zero(jpi);
-
-    GError *tmp_err = NULL;
-    pos = gsl_vector_calloc(3);
-    d_solver_solve_direct(geometry, axes, pos, &tmp_err);
-    if (tmp_err != NULL) {
-        g_propagate_error(err, tmp_err);
-        gsl_vector_free(pos);
-        return;
+
+    ks->axes = axes;
+
+    gsl_vector_view axes_view = d_vec3_view(&ks->axes);
+    gsl_vector_view pos_view = d_vec3_view(&ks->pos);
+    DSolverStatus status = d_solver_solve_direct_status(geometry,
+                                                        &axes_view.vector,
+                                                        &pos_view.vector);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Could not reach point in cartesian space: %s",
+                d_solver_status_to_string(status));
+        return FALSE;
     }
-    for (int i = 0; i < jpi->size1; i++) {
-        gdouble phi = G_PI * 120.0 / 180.0 * (gdouble)i;
-        gdouble t = gsl_vector_get(axes, i);
-        gdouble gammax = 2.0 * (gsl_vector_get(pos, 0) + (h-r) * cos(phi)
-                                - a * cos(phi) * cos(t));
-        gdouble gammay = 2.0 * (gsl_vector_get(pos, 1) + (h-r) * sin(phi)
-                                - a * sin(phi) * cos(t));
-        gdouble gammaz = 2.0 * (gsl_vector_get(pos, 2) - a * sin(t));
-        gsl_matrix_set(jpi, i, 0, - gammax);
-        gsl_matrix_set(jpi, i, 1, - gammay);
-        gsl_matrix_set(jpi, i, 2, - gammaz);
+
+    const DVec3 pos = ks->pos;
+    DMat3 jp;
+    DMat3 *jq = &ks->jacobian_q;
+    *jq = d_mat3_zero();
+    for (int i = 0; i < 3; i++) {
+        gdouble st = ks->sin_t[i] = sin(axes.v[i]);
+        gdouble ct = ks->cos_t[i] = cos(axes.v[i]);
+
+        gdouble gammax = 2.0 * (pos.v[0] + c->h_r * c->cos_phi[i]
+                                - a * c->cos_phi[i] * ct);
+        gdouble gammay = 2.0 * (pos.v[1] + c->h_r * c->sin_phi[i]
+                                - a * c->sin_phi[i] * ct);
+        gdouble gammaz = 2.0 * (pos.v[2] - a * st);
+        jp.m[i][0] = - gammax;
+        jp.m[i][1] = - gammay;
+        jp.m[i][2] = - gammaz;
+
+        jq->m[i][i] = 2.0 * a * ((pos.v[0] * c->cos_phi[i]
+                                + pos.v[1] * c->sin_phi[i]
+                                + c->h_r)
+                                * st
+                                - pos.v[2] * ct);
     }
 
-    gsl_permutation *p = gsl_permutation_alloc(priv->jacobian_p_inv->size1);
-    gsl_matrix *lu_decomp = gsl_matrix_alloc(priv->jacobian_p_inv->size1,
-                                                priv->jacobian_p_inv->size2);
-    gsl_matrix_memcpy(lu_decomp, priv->jacobian_p_inv);
-    int sign;
+    if (!d_mat3_inverse(&jp, &ks->jacobian_p_inv)) {
+        g_set_error_literal(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Direct jacobian is singular");
+        return FALSE;
+    }
 
-    gsl_linalg_LU_decomp(lu_decomp, p, &sign);
-    gsl_linalg_LU_invert(lu_decomp, p, priv->jacobian_p_inv);
+    /* Jq is diagonal, K is Jp⁻ᵀ with scaled rows */
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            ks->k.m[i][j] = jq->m[i][i] * ks->jacobian_p_inv.m[j][i];
+        }
+    }
 
-    gsl_permutation_free(p);
-    gsl_matrix_free(lu_decomp);
-    gsl_vector_free(pos);
+    return TRUE;
+}
 
-    priv->jpi_update = FALSE;
-    return;
+/* Complete a solved position with the axes speed */
+static void
+d_dynamic_model_kinematics_speed (DDynamicModelKinematics   *ks,
+                                  DVec3                     speed)
+{
+    ks->speed = speed;
+    ks->speed_pos = d_mat3_mul_vec(&ks->jacobian_p_inv,
+                                   d_mat3_mul_vec(&ks->jacobian_q, speed));
 }
 
 /*
- * Update direct jacobian derivative matrix with current parameters
+ * Direct jacobian derivative of a kinematic state
  */
 static void
-d_dynamic_model_update_jpd (DDynamicModel   *self,
-                            gsl_vector      *axes,
-                            gsl_vector      *speed,
-                            GError          **err)
+d_dynamic_model_compute_jpd (DGeometry                      *geometry,
+                             const DDynamicModelKinematics  *ks,
+                             DMat3                          *jpd)
 {
-    g_return_if_fail(err == NULL || *err == NULL);
-    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
-
-    gsl_vector *speed_pos;
-    DGeometry *geometry = d_manipulator_get_geometry(self->manipulator);
-    gsl_matrix *jp_inv;
-    gsl_matrix *jq;
-    gsl_matrix *jpd = priv->jacobian_p_dot;
+    const DGeometryConstants *c = &geometry->derived;
     gdouble a = geometry->a;
 
-    GError *tm_error = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian(self, axes, &tm_error);
-    if (tm_error != NULL) {
-        g_propagate_error(err, tm_error);
-        return;
-    }
+    for (int i = 0; i < 3; i++) {
+        gdouble t_dot = ks->speed.v[i];
 
-    tm_error = NULL;
-    jp_inv = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tm_error);
-    if (tm_error != NULL) {
-        g_propagate_error(err, tm_error);
-        return;
+        gdouble gammax_dot = 2.0 * (ks->speed_pos.v[0]
+                                + a * c->cos_phi[i] * ks->sin_t[i] * t_dot);
+        gdouble gammay_dot = 2.0 * (ks->speed_pos.v[1]
+                                + a * c->sin_phi[i] * ks->sin_t[i] * t_dot);
+        gdouble gammaz_dot = 2.0 * (ks->speed_pos.v[2]
+                                - a * ks->cos_t[i] * t_dot);
+
+        jpd->m[i][0] = - gammax_dot;
+        jpd->m[i][1] = - gammay_dot;
+        jpd->m[i][2] = - gammaz_dot;
     }
+}
 
+/*
+ * Update direct jacobian derivative matrix with current parameters
+ */
+static void
+d_dynamic_model_update_jpd (DDynamicModel                   *self,
+                            const DDynamicModelKinematics   *ks)
+{
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix_set_zero(jpd);
-    speed_pos = gsl_vector_calloc(3);
-    gsl_vector *temp = gsl_vector_calloc(3);
-    gsl_blas_dgemv(CblasNoTrans, 1.0, jq,
-                    speed, 0.0, temp);
-    gsl_blas_dgemv(CblasNoTrans, 1.0, jp_inv,
-                    temp, 0.0, speed_pos);
-    gsl_vector_free(temp);
-
-    for (int i = 0; i < jpd->size1; i++) {
-        gdouble phi = G_PI * 120.0 / 180.0 * (gdouble)i;
-        gdouble t = gsl_vector_get(axes, i);
-        gdouble t_dot = gsl_vector_get(speed, i);
-
-        gdouble gammax_dot = 2.0 * (gsl_vector_get(speed_pos, 0)
-                                + a * cos(phi) * sin(t) * t_dot);
-        gdouble gammay_dot = 2.0 * (gsl_vector_get(speed_pos, 1)
-                                + a * sin(phi) * sin(t) * t_dot);
-        gdouble gammaz_dot = 2.0 * (gsl_vector_get(speed_pos, 2)
-                                - a * cos(t) * t_dot);
-
-        gsl_matrix_set(jpd, i, 0, - gammax_dot);
-        gsl_matrix_set(jpd, i, 1, - gammay_dot);
-        gsl_matrix_set(jpd, i, 2, - gammaz_dot);
-    }
-    gsl_vector_free(speed_pos);
+    d_dynamic_model_compute_jpd(d_manipulator_get_geometry(self->manipulator),
+                                ks, &priv->jacobian_p_dot);
 
     priv->jpd_update = FALSE;
 }
 
 /*
- * update inverse jacobian matrix with current parameters
+ * Inverse jacobian derivative of a kinematic state
  */
 static void
-d_dynamic_model_update_jq (DDynamicModel    *self,
-                           gsl_vector       *axes,
-                           GError           **err)
+d_dynamic_model_compute_jqd (DGeometry                      *geometry,
+                             const DDynamicModelKinematics  *ks,
+                             DMat3                          *jqd)
 {
-    g_return_if_fail(err == NULL || *err ==NULL);
-
-    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
-
-    gsl_vector *pos;
-    gsl_matrix *jq = priv->jacobian_q;
-    DGeometry* geometry = d_manipulator_get_geometry(self->manipulator);
+    const DGeometryConstants *c = &geometry->derived;
     gdouble a = geometry->a;
-    gdouble h = geometry->h;
-    gdouble r = geometry->r;
-
-    gsl_matrix_set_zero(jq);
-    pos = gsl_vector_calloc(3);
-    GError *tmp_err = NULL;
-    d_solver_solve_direct(geometry, axes, pos, &tmp_err);
-    if (err != NULL) {
-        g_propagate_error(err, tmp_err);
-        gsl_vector_free(pos);
-        return;
-    }
-    for (int i = 0; i < jq->size1; i++) {
-        gdouble phi = G_PI * 120.0 / 180.0 * (double)i;
-        gdouble t = gsl_vector_get(axes, i);
-        gsl_matrix_set(jq, i, i,
-                        2.0 * a * ((gsl_vector_get(pos, 0) * cos(phi)
-                                + gsl_vector_get(pos, 1) * sin(phi)
-                                + h - r)
-                                * sin(t)
-                                - gsl_vector_get(pos, 2) * cos(t)));
+    const DVec3 pos = ks->pos;
+    const DVec3 speed_pos = ks->speed_pos;
+
+    *jqd = d_mat3_zero();
+    for (int i = 0; i < 3 ; i++) {
+        gdouble t_dot = ks->speed.v[i];
+        jqd->m[i][i] = 2.0 * a * (
+                            (speed_pos.v[0] * c->cos_phi[i]
+                                + speed_pos.v[1] * c->sin_phi[i]
+                                + pos.v[2] * t_dot) * ks->sin_t[i]
+                            + ((pos.v[0] * c->cos_phi[i]
+                                + pos.v[1] * c->sin_phi[i]
+                                + c->h_r) * t_dot
+                                - speed_pos.v[2]) * ks->cos_t[i]);
     }
-
-    priv->jq_update = FALSE;
-
-    gsl_vector_free(pos);
 }
 
 /*
  * Update inverse jacobian derivative matrix with current parameters
  */
 static void
-d_dynamic_model_update_jqd (DDynamicModel   *self,
-                            gsl_vector      *axes,
-                            gsl_vector      *speed,
-                            GError          **err)
+d_dynamic_model_update_jqd (DDynamicModel                   *self,
+                            const DDynamicModelKinematics   *ks)
 {
-    g_return_if_fail(err == NULL || *err == NULL);
-
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_vector *pos;
-    gsl_vector *speed_pos;
-    DGeometry *geometry;
-    gsl_matrix *jp_inv;
-    gsl_matrix *jq;
-
-    gsl_matrix *jqd = priv->jacobian_q_dot;
-
-    gsl_matrix_set_zero(jqd);
-
-    GError *tmp_err = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_propagate_error(err, tmp_err);
-        return;
-    }
-
-    tmp_err = NULL;
-    jp_inv = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_propagate_error(err, tmp_err);
-        return;
-    }
-
-    geometry = d_manipulator_get_geometry(self->manipulator);
-    pos = gsl_vector_calloc(3);
-    tmp_err = NULL;
-    d_solver_solve_direct(geometry, axes, pos, &tmp_err);
-    if (tmp_err != NULL) {
-        gsl_vector_free(pos);
-        g_propagate_error(err, tmp_err);
-        return;
-    }
-
-    speed_pos = gsl_vector_calloc(3);
-    gsl_vector *temp = gsl_vector_calloc(3);
-    gsl_blas_dgemv(CblasNoTrans, 1.0, jq,
-                    speed, 0.0, temp);
-    gsl_blas_dgemv(CblasNoTrans, 1.0, jp_inv,
-                    temp, 0.0, speed_pos);
-    gdouble a = geometry->a;
-    gdouble h = geometry->h;
-    gdouble r = geometry->r;
-    for (int i = 0; i < jqd->size1 ; i++) {
-        gdouble phi = G_PI * 120.0 / 180.0 * (gdouble)i;
-        gdouble t = gsl_vector_get(axes, i);
-        gdouble t_dot = gsl_vector_get(speed, i);
-        gsl_matrix_set(jqd, i, i,
-                        2.0 * a * (
-                            (gsl_vector_get(speed_pos, 0) * cos(phi)
-                                + gsl_vector_get(speed_pos, 1) * sin(phi)
-                                + gsl_vector_get(pos,2) * t_dot) * sin(t)
-                            + ((gsl_vector_get(pos, 0) * cos(phi)
-                                + gsl_vector_get(pos, 1) * sin(phi)
-                                + h - r) * t_dot
-                                - gsl_vector_get(speed_pos, 2)) * cos(t)));
-    }
+    d_dynamic_model_compute_jqd(d_manipulator_get_geometry(self->manipulator),
+                                ks, &priv->jacobian_q_dot);
 
     priv->jqd_update = FALSE;
+}
 
-    gsl_vector_free(speed_pos);
-    gsl_vector_free(pos);
-    gsl_vector_free(temp);
+/*
+ * Axes mass matrix of a kinematic state
+ */
+static void
+d_dynamic_model_compute_mass_axes (DGeometry                        *geometry,
+                                   const DDynamicSpec               *spec,
+                                   const DDynamicModelKinematics    *ks,
+                                   DMat3                            *ma)
+{
+    const DGeometryConstants *c = &geometry->derived;
+
+    gdouble mass = (spec->low_arm_mass / 2.0 + spec->upper_arm_mass)
+                    * geometry->a;
+    for (int i = 0; i < 3; i++) {
+        ma->m[i][0] = - c->cos_phi[i] * ks->sin_t[i] * mass;
+        ma->m[i][1] = - c->sin_phi[i] * ks->sin_t[i] * mass;
+        ma->m[i][2] = ks->cos_t[i] * mass;
+    }
 }
 
 /*
  * Update axes mass matrix with current parameters
  */
 static void
-d_dynamic_model_update_mass_axes (DDynamicModel *self,
-                                  gsl_vector    *axes)
+d_dynamic_model_update_mass_axes (DDynamicModel                 *self,
+                                  const DDynamicModelKinematics *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *ma = priv->mass_axes;
-
-    gsl_matrix_set_zero(ma);
-    for (int i = 0; i < ma->size1; i++) {
-        gdouble phi = G_PI * 120.0 / 180.0 * (double)i;
-        gdouble t = gsl_vector_get(axes, i);
-        gsl_matrix_set(ma, i, 0, - cos(phi) * sin(t));
-        gsl_matrix_set(ma, i, 1, - sin(phi) * sin(t));
-        gsl_matrix_set(ma, i, 2, cos(t));
-    }
-    gdouble mass = (self->manipulator->dynamic_params->low_arm_mass / 2.0
-                    + self->manipulator->dynamic_params->upper_arm_mass)
-                    * self->manipulator->geometry->a;
-    gsl_matrix_scale(ma, mass);
+    d_dynamic_model_compute_mass_axes(self->manipulator->geometry,
+                                      self->manipulator->dynamic_params,
+                                      ks, &priv->mass_axes);
 
     priv->ma_update = FALSE;
 }
@@ -535,14 +467,9 @@ d_dynamic_model_update_mass_pos (DDynamicModel  *self)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *mp = priv->mass_pos;
-
-    gsl_matrix_set_zero(mp);
-    for (int i = 0; i < mp->size1; i++) {
-        gdouble mass = self->manipulator->dynamic_params->platform_mass
-                        + 3.0 * self->manipulator->dynamic_params->upper_arm_mass;
-        gsl_matrix_set(mp, i, i, mass);
-    }
+    gdouble mass = self->manipulator->dynamic_params->platform_mass
+                    + 3.0 * self->manipulator->dynamic_params->upper_arm_mass;
+    priv->mass_pos = d_mat3_diag(mass, mass, mass);
 
     priv->mp_update = FALSE;
 }
@@ -555,15 +482,10 @@ d_dynamic_model_update_inertia_axes (DDynamicModel  *self)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *ia = priv->inertia_axes;
-
-    gsl_matrix_set_zero(ia);
-    for (int i = 0; i < ia->size1; i++) {
-        gdouble mass = self->manipulator->dynamic_params->upper_arm_mass
-                        * pow(self->manipulator->geometry->a, 2.0)
-                        + self->manipulator->dynamic_params->low_arm_moi;
-        gsl_matrix_set(ia, i, i, mass);
-    }
+    gdouble mass = self->manipulator->dynamic_params->upper_arm_mass
+                    * self->manipulator->geometry->derived.a2
+                    + self->manipulator->dynamic_params->low_arm_moi;
+    priv->inertia_axes = d_mat3_diag(mass, mass, mass);
 
     priv->ia_update = FALSE;
 }
@@ -572,305 +494,143 @@ d_dynamic_model_update_inertia_axes (DDynamicModel  *self)
  * Update model mass matrix with current parameters
  */
 static void
-d_dynamic_model_update_model_mass (DDynamicModel    *self,
-                                   gsl_vector       *axes)
+d_dynamic_model_update_model_mass (DDynamicModel                *self,
+                                   const DDynamicModelKinematics *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *mass = priv->model_mass;
-    gsl_matrix *jp;
-    gsl_matrix *jq;
-    gsl_matrix *mp = d_dynamic_model_get_mass_pos(self);
-    gsl_matrix *mq = d_dynamic_model_get_mass_axes(self, axes);
+    const DMat3 *mp = d_dynamic_model_get_mass_pos(self);
+    const DMat3 *mq = d_dynamic_model_get_mass_axes(self, ks);
 
-    GError *tmp_err = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute mass matrix.");
-    }
-
-    tmp_err = NULL;
-    jp = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute mass matrix.");
-    }
-
-    gsl_matrix *temp = gsl_matrix_calloc(3, 3);
-    gsl_matrix_set_all(mass, 0);
-
-    gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1.0,
-                    jq, jp, 0.0, temp);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    temp, mp, 0.0, mass);
-    gsl_matrix_add(mass, mq);
+    /* M = K * Mp + Mq */
+    DMat3 mass = d_mat3_mul(&ks->k, mp);
+    priv->model_mass = d_mat3_add(&mass, mq);
 
     priv->mm_update = FALSE;
-
-    gsl_matrix_free(temp);
 }
 
 /*
- * Update model inertia matrix with current parameters
+ * Update the LDLᵀ factor of the model inertia matrix with current
+ * parameters. The accelerations are solved from it, never inverted.
  */
 static void
-d_dynamic_model_update_model_inertia_inv (DDynamicModel *self,
-                                          gsl_vector    *axes)
+d_dynamic_model_update_model_inertia_ldlt (DDynamicModel                *self,
+                                           const DDynamicModelKinematics *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *inertia = priv->model_inertia_inv;
-    gsl_matrix *jp;
-    gsl_matrix *jq;
-    gsl_matrix *mp = d_dynamic_model_get_mass_pos(self);
-    gsl_matrix *iq = d_dynamic_model_get_inertia_axes(self);
-    gsl_matrix *temp = gsl_matrix_calloc(3, 3);
-
-    GError *tmp_err = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute inertia matrix.");
-    }
-
-    tmp_err = NULL;
-    jp = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute inertia matrix.");
-    }
-
-    tmp_err = NULL;
-    jp = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute inertia matrix.");
+    const DMat3 *mp = d_dynamic_model_get_mass_pos(self);
+    const DMat3 *iq = d_dynamic_model_get_inertia_axes(self);
+
+    /* I = Jq * Jp⁻ᵀ * Mp * Jp⁻¹ * Jq + Iq = K * Mp * Kᵀ + Iq, as Jq is
+     * diagonal. Symmetric positive definite with positive masses. */
+    DMat3 temp = d_mat3_mul(&ks->k, mp);
+    DMat3 inertia = d_mat3_mul_t(&temp, &ks->k);
+    inertia = d_mat3_add(&inertia, iq);
+
+    /* An indefinite inertia fails the evaluation through its NaN
+     * accelerations instead of aborting, the equations run in real-time
+     * loops */
+    if (!d_mat3_ldlt(&inertia, &priv->model_inertia_ldlt)) {
+        for (int i = 0; i < 9; i++) {
+            priv->model_inertia_ldlt.m[i / 3][i % 3] = NAN;
+        }
     }
 
-    gsl_matrix_set_zero(inertia);
-    gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1.0,
-                    jq, jp,
-                    0.0, temp);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    temp, mp,
-                    0.0, inertia);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    inertia, jp,
-                    0.0, temp);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    temp, jq,
-                    0.0, inertia);
-    gsl_matrix_add(inertia, iq);
-
-    gsl_permutation *p = gsl_permutation_alloc(priv->jacobian_p_inv->size1);
-    gsl_matrix *lu_decomp = gsl_matrix_alloc(priv->model_inertia_inv->size1,
-                                                priv->model_inertia_inv->size2);
-    gsl_matrix_memcpy(lu_decomp, priv->model_inertia_inv);
-    int sign;
-    gsl_linalg_LU_decomp(lu_decomp, p, &sign);
-    gsl_linalg_LU_invert(lu_decomp, p, priv->model_inertia_inv);
-
-    gsl_permutation_free(p);
-    gsl_matrix_free(lu_decomp);
-
     priv->mi_update = FALSE;
-
-    gsl_matrix_free(temp);
 }
 
 /*
  * Update model coriolis matrix with current parameters
  */
 static void
-d_dynamic_model_update_model_coriolis (DDynamicModel    *self,
-                                       gsl_vector       *axes,
-                                       gsl_vector       *speed)
+d_dynamic_model_update_model_coriolis (DDynamicModel                    *self,
+                                       const DDynamicModelKinematics    *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_matrix *coriolis = priv->model_coriolis;
-    gsl_matrix *jp;
-    gsl_matrix *jq;
-    gsl_matrix *jpd;
-    gsl_matrix *jqd;
-    gsl_matrix *mp = d_dynamic_model_get_mass_pos(self);
-
-    GError *tmp_err = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian (self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model coriolis matrix.");
-    }
-
-    tmp_err = NULL;
-    jp = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model coriolis matrix.");
-    }
-
-    tmp_err = NULL;
-    jpd = d_dynamic_model_get_direct_jacobian_dt(self, axes, speed, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model coriolis matrix.");
-    }
-
-    tmp_err = NULL;
-    jqd = d_dynamic_model_get_inverse_jacobian_dt(self, axes, speed, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model coriolis matrix.");
-    }
+    const DMat3 *jp = &ks->jacobian_p_inv;
+    const DMat3 *jpd = d_dynamic_model_get_direct_jacobian_dt(self, ks);
+    const DMat3 *jqd = d_dynamic_model_get_inverse_jacobian_dt(self, ks);
+    const DMat3 *mp = d_dynamic_model_get_mass_pos(self);
 
-    gsl_matrix *term1 = gsl_matrix_calloc(3, 3);
-    gsl_matrix *term2 = gsl_matrix_calloc(3, 3);
-    gsl_matrix *temp = gsl_matrix_calloc(3, 3);
-
-    gsl_matrix_set_zero(coriolis);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    jp, jqd,
-                    0.0, term1);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    jp, jpd,
-                    0.0, term2);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    term2, jp,
-                    0.0, temp);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    temp, jq,
-                    0.0, term2);
-    gsl_matrix_add(term1, term2);
-    gsl_blas_dgemm(CblasNoTrans, CblasTrans, 1.0,
-                    jq, jp,
-                    0.0, coriolis);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    coriolis, mp,
-                    0.0, temp);
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0,
-                    temp, term1,
-                    0.0, coriolis);
-
-    gsl_matrix_free(term1);
-    gsl_matrix_free(term2);
-    gsl_matrix_free(temp);
+    /* H = Jq * Jp⁻ᵀ * Mp * (Jp⁻¹ * Jqd + Jp⁻¹ * Jpd * Jp⁻¹ * Jq)
+     *   = K * Mp * Jp⁻¹ * (Jqd + Jpd * Kᵀ) */
+    DMat3 term = d_mat3_mul_t(jpd, &ks->k);
+    term = d_mat3_add(&term, jqd);
+    DMat3 temp = d_mat3_mul(jp, &term);
+    DMat3 kmp = d_mat3_mul(&ks->k, mp);
+    priv->model_coriolis = d_mat3_mul(&kmp, &temp);
 
     priv->mc_update = FALSE;
 }
 
 /*
- * Update model torque vector with current parameters
+ * Torque on the axes at (q, dq/dt), the torque input closed by the servo
  */
-static void
-d_dynamic_model_update_model_torque (DDynamicModel  *self,
-                                     gsl_vector     *axes)
+static DVec3
+d_dynamic_model_compute_axes_torque (DDynamicModel  *self,
+                                     DVec3          q,
+                                     DVec3          q_dot)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    gsl_vector *torque = priv->model_torque;
-    gsl_vector *ff = self->force;
-    gsl_vector *tt = d_manipulator_get_torque(self->manipulator);
-    gsl_matrix *jp;
-    gsl_matrix *jq;
+    DVec3 tt = d_vec3_from_gsl(d_manipulator_get_torque(self->manipulator));
 
-    GError *tmp_err = NULL;
-    jq = d_dynamic_model_get_inverse_jacobian(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model torque.");
-    }
-
-    tmp_err = NULL;
-    jp = d_dynamic_model_get_direct_jacobian_inv(self, axes, &tmp_err);
-    if (tmp_err != NULL) {
-        g_error("Can't compute model torque.");
+    /* τ + Kp * (target - q) - Kd * dq/dt */
+    if (priv->servo_kp != 0.0 || priv->servo_kd != 0.0) {
+        for (int i = 0; i < 3; i++) {
+            tt.v[i] += priv->servo_kp * (priv->servo_target.v[i] - q.v[i])
+                       - priv->servo_kd * q_dot.v[i];
+        }
     }
-
-    gsl_vector *temp = gsl_vector_calloc(3);
-    gsl_vector_set_zero(torque);
-    gsl_blas_dgemv(CblasTrans, 1.0,
-                    jp, ff, 0.0, temp);
-    gsl_blas_dgemv(CblasNoTrans, 1.0,
-                    jq, temp, 0.0, torque);
-    gsl_vector_add(torque, tt);
-
-    priv->mt_update = FALSE;
-
-    gsl_vector_free(temp);
+    return tt;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_inverse_jacobian_dt (DDynamicModel  *self,
-                                         gsl_vector     *axes,
-                                         gsl_vector     *speed,
-                                         GError         **err)
+/*
+ * Update model torque vector with current parameters
+ */
+static void
+d_dynamic_model_update_model_torque (DDynamicModel                  *self,
+                                     const DDynamicModelKinematics  *ks)
 {
-    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
-
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    if (priv->jqd_update) {
-        GError *tmp_err = NULL;
-        d_dynamic_model_update_jqd(self, axes, speed, &tmp_err);
-        if (tmp_err != NULL) {
-            g_propagate_error(err, tmp_err);
-            return NULL;
-        }
-    }
-    return priv->jacobian_q_dot;
-}
+    DVec3 ff = d_vec3_from_gsl(self->force);
+    DVec3 tt = d_dynamic_model_compute_axes_torque(self, ks->axes, ks->speed);
 
-static gsl_matrix*
-d_dynamic_model_get_inverse_jacobian (DDynamicModel *self,
-                                      gsl_vector    *axes,
-                                      GError        **err)
-{
-    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
+    /* T = K * F + τ */
+    priv->model_torque = d_vec3_add(d_mat3_mul_vec(&ks->k, ff), tt);
 
-    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
-
-    if (priv->jq_update) {
-        GError *tmp_err = NULL;
-        d_dynamic_model_update_jq(self, axes, &tmp_err);
-        if (tmp_err != NULL) {
-            g_propagate_error(err, tmp_err);
-            return NULL;
-        }
-    }
-    return priv->jacobian_q;
+    priv->mt_update = FALSE;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_direct_jacobian_dt (DDynamicModel   *self,
-                                        gsl_vector      *axes,
-                                        gsl_vector      *speed,
-                                        GError          **err)
+/* Getters of the cached matrices, updating them when outdated */
+static const DMat3*
+d_dynamic_model_get_inverse_jacobian_dt (DDynamicModel                  *self,
+                                         const DDynamicModelKinematics  *ks)
 {
-    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    if (priv->jpd_update) {
-        GError *tmp_err = NULL;
-        d_dynamic_model_update_jpd(self, axes, speed, &tmp_err);
-        if (tmp_err != NULL) {
-            g_propagate_error(err, tmp_err);
-            return NULL;
-        }
+    if (priv->jqd_update) {
+        d_dynamic_model_update_jqd(self, ks);
     }
-    return priv->jacobian_p_dot;
+    return &priv->jacobian_q_dot;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_direct_jacobian_inv (DDynamicModel  *self,
-                                         gsl_vector     *axes,
-                                         GError         **err)
+static const DMat3*
+d_dynamic_model_get_direct_jacobian_dt (DDynamicModel                   *self,
+                                        const DDynamicModelKinematics   *ks)
 {
-    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
-    if (priv->jpi_update) {
-        GError *tmp_err = NULL;
-        d_dynamic_model_update_jpi(self, axes, &tmp_err);
-        if (tmp_err != NULL) {
-            g_propagate_error(err, tmp_err);
-            return NULL;
-        }
+    if (priv->jpd_update) {
+        d_dynamic_model_update_jpd(self, ks);
     }
-    return priv->jacobian_p_inv;
+    return &priv->jacobian_p_dot;
 }
 
-static gsl_matrix*
+static const DMat3*
 d_dynamic_model_get_inertia_axes (DDynamicModel *self)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
@@ -879,10 +639,10 @@ d_dynamic_model_get_inertia_axes (DDynamicModel *self)
         d_dynamic_model_update_inertia_axes(self);
     }
 
-    return priv->inertia_axes;
+    return &priv->inertia_axes;
 }
 
-static gsl_matrix*
+static const DMat3*
 d_dynamic_model_get_mass_pos (DDynamicModel     *self)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
@@ -891,93 +651,150 @@ d_dynamic_model_get_mass_pos (DDynamicModel     *self)
         d_dynamic_model_update_mass_pos(self);
     }
 
-    return priv->mass_pos;
+    return &priv->mass_pos;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_mass_axes (DDynamicModel    *self,
-                               gsl_vector       *axes)
+static const DMat3*
+d_dynamic_model_get_mass_axes (DDynamicModel                    *self,
+                               const DDynamicModelKinematics    *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (priv->ma_update) {
-        d_dynamic_model_update_mass_axes(self, axes);
+        d_dynamic_model_update_mass_axes(self, ks);
     }
 
-    return priv->mass_axes;
+    return &priv->mass_axes;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_model_inertia_inv (DDynamicModel    *self,
-                                       gsl_vector       *axes)
+static const DMat3*
+d_dynamic_model_get_model_inertia_ldlt (DDynamicModel                   *self,
+                                        const DDynamicModelKinematics   *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (priv->mi_update) {
-        d_dynamic_model_update_model_inertia_inv(self, axes);
+        d_dynamic_model_update_model_inertia_ldlt(self, ks);
     }
 
-    return priv->model_inertia_inv;
+    return &priv->model_inertia_ldlt;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_model_mass (DDynamicModel   *self,
-                                gsl_vector      *axes)
+static const DMat3*
+d_dynamic_model_get_model_mass (DDynamicModel                   *self,
+                                const DDynamicModelKinematics   *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (priv->mm_update) {
-        d_dynamic_model_update_model_mass(self, axes);
+        d_dynamic_model_update_model_mass(self, ks);
     }
 
-    return priv->model_mass;
+    return &priv->model_mass;
 }
 
-static gsl_matrix*
-d_dynamic_model_get_model_coriolis (DDynamicModel   *self,
-                                    gsl_vector      *axes,
-                                    gsl_vector      *speed)
+static const DMat3*
+d_dynamic_model_get_model_coriolis (DDynamicModel                   *self,
+                                    const DDynamicModelKinematics   *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (priv->mc_update) {
-        d_dynamic_model_update_model_coriolis(self, axes, speed);
+        d_dynamic_model_update_model_coriolis(self, ks);
     }
 
-    return priv->model_coriolis;
+    return &priv->model_coriolis;
 }
 
-static gsl_vector*
-d_dynamic_model_get_model_torque (DDynamicModel *self,
-                                  gsl_vector    *axes)
+static const DVec3*
+d_dynamic_model_get_model_torque (DDynamicModel                 *self,
+                                  const DDynamicModelKinematics *ks)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
 
     if (priv->mt_update) {
-        d_dynamic_model_update_model_torque(self, axes);
+        d_dynamic_model_update_model_torque(self, ks);
     }
 
-    return priv->model_torque;
+    return &priv->model_torque;
 }
 
-static void
-d_dynamic_model_matrices_outdated(DDynamicModel *self)
+/*
+ * Bring the cache up to (q, dq/dt), one tier at a time. Mass of the
+ * platform and inertia of the axes only follow the geometry and dynamic
+ * spec. The kinematic position, mass of the axes, model mass and inertia
+ * follow q. The speed terms and the coriolis matrix follow dq/dt as well.
+ * The torque depends on inputs set from outside and is always outdated.
+ * Returns TRUE when the cache matches (q, dq/dt). Returns FALSE where the
+ * kinematics fail, leaving the position tier invalid, so none of the
+ * cached matrices may be read.
+ */
+static gboolean
+d_dynamic_model_update_state (DDynamicModel    *self,
+                              DVec3            q,
+                              DVec3            q_dot)
 {
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+    DDynamicModelKinematics *ks = &priv->kinematics;
+
+    DGeometry *geometry = self->manipulator->geometry;
+    DDynamicSpec *spec = self->manipulator->dynamic_params;
+    gdouble params[8] = {
+        geometry->a, geometry->b, geometry->h, geometry->r,
+        spec->low_arm_mass, spec->low_arm_moi,
+        spec->upper_arm_mass, spec->platform_mass
+    };
+    if (!priv->params_valid
+            || geometry != priv->params_geometry
+            || spec != priv->params_spec
+            || memcmp(params, priv->params, sizeof(params)) != 0) {
+        priv->params_geometry = geometry;
+        priv->params_spec = spec;
+        memcpy(priv->params, params, sizeof(params));
+        priv->params_valid = TRUE;
+
+        priv->mp_update = TRUE;
+        priv->ia_update = TRUE;
+        priv->position_valid = FALSE;
+    }
+
+    if (!priv->position_valid
+            || q.v[0] != ks->axes.v[0]
+            || q.v[1] != ks->axes.v[1]
+            || q.v[2] != ks->axes.v[2]) {
+        if (!d_dynamic_model_kinematics_position(geometry, q, ks, NULL)) {
+            priv->position_valid = FALSE;
+            return FALSE;
+        }
+        priv->position_valid = TRUE;
+
+        priv->ma_update = TRUE;
+        priv->mm_update = TRUE;
+        priv->mi_update = TRUE;
+        priv->velocity_valid = FALSE;
+    }
+
+    if (!priv->velocity_valid
+            || q_dot.v[0] != ks->speed.v[0]
+            || q_dot.v[1] != ks->speed.v[1]
+            || q_dot.v[2] != ks->speed.v[2]) {
+        d_dynamic_model_kinematics_speed(ks, q_dot);
+        priv->velocity_valid = TRUE;
+
+        priv->jpd_update = TRUE;
+        priv->jqd_update = TRUE;
+        priv->mc_update = TRUE;
+    }
 
-    priv->jpi_update = TRUE;
-    priv->jpd_update = TRUE;
-    priv->jq_update = TRUE;
-    priv->jqd_update = TRUE;
-    priv->ma_update = TRUE;
-    priv->mp_update = TRUE;
-    priv->ia_update = TRUE;
-    priv->mm_update = TRUE;
-    priv->mc_update = TRUE;
-    priv->mi_update = TRUE;
     priv->mt_update = TRUE;
+
+    return TRUE;
 }
 
+static int          d_dynamic_model_rhs             (DDynamicModel  *model,
+                                                     const double   y[],
+                                                     double         dydt[]);
+
 /**
  * Function defining the ODE system. The first three elements of array y[]
  * are the positions in axes-space. The remaining three elements are the
@@ -995,57 +812,247 @@ d_dynamic_model_equation (double        t,
     /* Check input data for correct type */
     g_return_val_if_fail(D_IS_DYNAMIC_MODEL(params), GSL_EBADFUNC);
 
-    DDynamicModel *model = D_DYNAMIC_MODEL(params);
+    return d_dynamic_model_rhs(D_DYNAMIC_MODEL(params), y, dydt);
+}
+
+/*
+ * Right hand side through the model matrices, leaving them and the
+ * kinematic state cached for the jacobian.
+ */
+static int
+d_dynamic_model_rhs (DDynamicModel  *model,
+                     const double   y[],
+                     double         dydt[])
+{
     DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(model);
 
     /* Matrices holding the coefficients on the model differential equation */
-    gsl_matrix *mi, *mh, *mm;
-    gsl_vector *mt;
+    const DMat3 *mi, *mh, *mm;
+    const DVec3 *mt;
 
     /* Speed and positions in axes space */
-    gsl_vector_view q_dot_dot, q_dot_2;
-
-    /* Fill the axes position and speed, request an update in the model */
-    double y_ptr[6] = {y[0], y[1], y[2], y[3], y[4], y[5]};
-    gsl_vector_view q = gsl_vector_view_array(&(y_ptr[0]), 3);
-    gsl_vector_view q_dot = gsl_vector_view_array(&(y_ptr[3]), 3);
-
-    d_dynamic_model_matrices_outdated(model);
+    DVec3 q = d_vec3(y[0], y[1], y[2]);
+    DVec3 q_dot = d_vec3(y[3], y[4], y[5]);
+
+    /* Request an update in the model, the kinematic state is shared by
+     * every matrix */
+    const DDynamicModelKinematics *ks = &priv->kinematics;
+    if (!d_dynamic_model_update_state(model, q, q_dot)) {
+        return GSL_EBADFUNC;
+    }
     /* Fill model matrices */
-    mt = d_dynamic_model_get_model_torque(model, &q.vector);
-    mi = d_dynamic_model_get_model_inertia_inv(model, &q.vector);
-    mh = d_dynamic_model_get_model_coriolis(model, &q.vector, &q_dot.vector);
-    mm = d_dynamic_model_get_model_mass(model, &q.vector);
+    mt = d_dynamic_model_get_model_torque(model, ks);
+    mi = d_dynamic_model_get_model_inertia_ldlt(model, ks);
+    mh = d_dynamic_model_get_model_coriolis(model, ks);
+    mm = d_dynamic_model_get_model_mass(model, ks);
 
     /* Calculate acceleration */
-    /* d²q/dt² = I⁻¹ ( T - H * dq/dt + M * g ) */
+    /* I * d²q/dt² = T - H * dq/dt + M * g, solved with the factor of I */
+    DVec3 v_g = d_vec3_from_gsl(model->gravity);
+    DVec3 rhs = d_vec3_add(d_vec3_sub(d_mat3_mul_vec(mm, v_g),
+                                      d_mat3_mul_vec(mh, q_dot)),
+                           *mt);
+    DVec3 q_dot_dot = d_mat3_ldlt_solve(mi, rhs);
+    if (!(isfinite(q_dot_dot.v[0]) && isfinite(q_dot_dot.v[1])
+          && isfinite(q_dot_dot.v[2]))) {
+        return GSL_EBADFUNC;
+    }
+
     /* Set the dydt array */
-    q_dot_2 = gsl_vector_view_array(&(dydt[0]), 3);
-    gsl_vector_memcpy(&q_dot_2.vector, &q_dot.vector);
-    q_dot_dot = gsl_vector_view_array(&(dydt[3]), 3);
-    gsl_vector *v_g = model->gravity;
-    gsl_vector *q_dot_dot_temp = gsl_vector_calloc(3);
-
-    gsl_blas_dgemv(CblasNoTrans, 1.0, mm, v_g, 0.0, q_dot_dot_temp);
-    gsl_blas_dgemv(CblasNoTrans, -1.0, mh, &q_dot.vector, 1.0, q_dot_dot_temp);
-    gsl_vector_add(q_dot_dot_temp, mt);
-    gsl_blas_dgemv(CblasNoTrans, 1.0, mi, q_dot_dot_temp, 0.0, &q_dot_dot.vector);
-
-//    /* Set the dydt array */
-//    dydt[0] = gsl_vector_get(q_dot, 0);
-//    dydt[1] = gsl_vector_get(q_dot, 1);
-//    dydt[2] = gsl_vector_get(q_dot, 2);
-//    dydt[3] = gsl_vector_get(q_dot_dot, 0);
-//    dydt[4] = gsl_vector_get(q_dot_dot, 1);
-//    dydt[5] = gsl_vector_get(q_dot_dot, 2);
-
-    /* Free memory */
-    gsl_vector_free(q_dot_dot_temp);
+    for (int i = 0; i < 3; i++) {
+        dydt[i] = q_dot.v[i];
+        dydt[i + 3] = q_dot_dot.v[i];
+    }
 
     return GSL_SUCCESS;
 }
 
+/*
+ * Derivative of the accelerations along (dq, dq_dot), carried by the chain
+ * rule through every matrix of the equations: the platform moves by
+ * dp = Jp⁻¹ * Jq * dq and the inverse by d(Jp⁻¹) = -Jp⁻¹ * dJp * Jp⁻¹. The
+ * caches and accelerations must come from an evaluation at the same state.
+ */
+static DVec3
+d_dynamic_model_tangent (DDynamicModel                  *self,
+                         const DDynamicModelKinematics  *ks,
+                         DVec3                          q_dot_dot,
+                         DVec3                          dq,
+                         DVec3                          dqd)
+{
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+
+    DGeometry *geometry = self->manipulator->geometry;
+    const DGeometryConstants *c = &geometry->derived;
+    const DDynamicSpec *spec = self->manipulator->dynamic_params;
+    gdouble a = geometry->a;
+    gdouble mass_a = (spec->low_arm_mass / 2.0 + spec->upper_arm_mass) * a;
+
+    const DMat3 *jp = &ks->jacobian_p_inv;
+    const DMat3 *jq = &ks->jacobian_q;
+    const DMat3 *jpd = &priv->jacobian_p_dot;
+    const DMat3 *jqd = &priv->jacobian_q_dot;
+    const DMat3 *mp = &priv->mass_pos;
+    const DVec3 p = ks->pos;
+    const DVec3 pd = ks->speed_pos;
+    const DVec3 qd = ks->speed;
+
+    /* Platform position, then the jacobians */
+    DVec3 dp = d_mat3_mul_vec(jp, d_mat3_mul_vec(jq, dq));
+    DMat3 djp;
+    DMat3 djq = d_mat3_zero();
+    DMat3 dma;
+    gdouble dst[3], dct[3];
+    for (int i = 0; i < 3; i++) {
+        gdouble st = ks->sin_t[i];
+        gdouble ct = ks->cos_t[i];
+        dst[i] = ct * dq.v[i];
+        dct[i] = - st * dq.v[i];
+
+        djp.m[i][0] = - 2.0 * (dp.v[0] - a * c->cos_phi[i] * dct[i]);
+        djp.m[i][1] = - 2.0 * (dp.v[1] - a * c->sin_phi[i] * dct[i]);
+        djp.m[i][2] = - 2.0 * (dp.v[2] - a * dst[i]);
+
+        gdouble radial = p.v[0] * c->cos_phi[i] + p.v[1] * c->sin_phi[i] + c->h_r;
+        djq.m[i][i] = 2.0 * a * ((dp.v[0] * c->cos_phi[i] + dp.v[1] * c->sin_phi[i]) * st
+                                 + radial * dst[i]
+                                 - dp.v[2] * ct
+                                 - p.v[2] * dct[i]);
+
+        dma.m[i][0] = - c->cos_phi[i] * dst[i] * mass_a;
+        dma.m[i][1] = - c->sin_phi[i] * dst[i] * mass_a;
+        dma.m[i][2] = dct[i] * mass_a;
+    }
+    DMat3 temp = d_mat3_mul(jp, &djp);
+    DMat3 djp_inv = d_mat3_mul(&temp, jp);
+    for (int k = 0; k < 9; k++) {
+        djp_inv.m[k / 3][k % 3] = - djp_inv.m[k / 3][k % 3];
+    }
+
+    /* Platform speed, then the jacobian derivatives */
+    DVec3 dpd = d_vec3_add(d_mat3_mul_vec(&djp_inv, d_mat3_mul_vec(jq, qd)),
+                           d_mat3_mul_vec(jp, d_vec3_add(d_mat3_mul_vec(&djq, qd),
+                                                         d_mat3_mul_vec(jq, dqd))));
+    DMat3 djpd;
+    DMat3 djqd = d_mat3_zero();
+    for (int i = 0; i < 3; i++) {
+        gdouble st = ks->sin_t[i];
+        gdouble ct = ks->cos_t[i];
+        gdouble dsq = dst[i] * qd.v[i] + st * dqd.v[i];
+        gdouble dcq = dct[i] * qd.v[i] + ct * dqd.v[i];
+
+        djpd.m[i][0] = - 2.0 * (dpd.v[0] + a * c->cos_phi[i] * dsq);
+        djpd.m[i][1] = - 2.0 * (dpd.v[1] + a * c->sin_phi[i] * dsq);
+        djpd.m[i][2] = - 2.0 * (dpd.v[2] - a * dcq);
+
+        gdouble radial = p.v[0] * c->cos_phi[i] + p.v[1] * c->sin_phi[i] + c->h_r;
+        gdouble e = pd.v[0] * c->cos_phi[i] + pd.v[1] * c->sin_phi[i]
+                    + p.v[2] * qd.v[i];
+        gdouble de = dpd.v[0] * c->cos_phi[i] + dpd.v[1] * c->sin_phi[i]
+                     + dp.v[2] * qd.v[i] + p.v[2] * dqd.v[i];
+        gdouble f = radial * qd.v[i] - pd.v[2];
+        gdouble df = (dp.v[0] * c->cos_phi[i] + dp.v[1] * c->sin_phi[i]) * qd.v[i]
+                     + radial * dqd.v[i] - dpd.v[2];
+        djqd.m[i][i] = 2.0 * a * (de * st + e * dst[i] + df * ct + f * dct[i]);
+    }
+
+    /* K = Jq * Jp⁻ᵀ and K * Mp, shared by every model matrix */
+    const DMat3 *k = &ks->k;
+    DMat3 dk = d_mat3_mul_t(&djq, jp);
+    temp = d_mat3_mul_t(jq, &djp_inv);
+    dk = d_mat3_add(&dk, &temp);
+    DMat3 kmp = d_mat3_mul(k, mp);
+    DMat3 dkmp = d_mat3_mul(&dk, mp);
+
+    /* M = K * Mp + Mq */
+    DMat3 dm = d_mat3_add(&dkmp, &dma);
+
+    /* I = K * Mp * Jp⁻¹ * Jq + Iq */
+    DMat3 jp_jq = d_mat3_mul(jp, jq);
+    DMat3 di = d_mat3_mul(&dkmp, &jp_jq);
+    DMat3 djp_jq = d_mat3_mul(&djp_inv, jq);
+    temp = d_mat3_mul(jp, &djq);
+    djp_jq = d_mat3_add(&djp_jq, &temp);
+    temp = d_mat3_mul(&kmp, &djp_jq);
+    di = d_mat3_add(&di, &temp);
+
+    /* H = K * Mp * (Jp⁻¹ * Jqd + Jp⁻¹ * Jpd * Jp⁻¹ * Jq) */
+    DMat3 jp_jpd = d_mat3_mul(jp, jpd);
+    DMat3 term = d_mat3_mul(jp, jqd);
+    temp = d_mat3_mul(&jp_jpd, &jp_jq);
+    term = d_mat3_add(&term, &temp);
+    DMat3 dterm = d_mat3_mul(&djp_inv, jqd);
+    temp = d_mat3_mul(jp, &djqd);
+    dterm = d_mat3_add(&dterm, &temp);
+    DMat3 d_jp_jpd = d_mat3_mul(&djp_inv, jpd);
+    temp = d_mat3_mul(jp, &djpd);
+    d_jp_jpd = d_mat3_add(&d_jp_jpd, &temp);
+    temp = d_mat3_mul(&d_jp_jpd, &jp_jq);
+    dterm = d_mat3_add(&dterm, &temp);
+    temp = d_mat3_mul(&jp_jpd, &djp_jq);
+    dterm = d_mat3_add(&dterm, &temp);
+    DMat3 dh = d_mat3_mul(&dkmp, &term);
+    temp = d_mat3_mul(&kmp, &dterm);
+    dh = d_mat3_add(&dh, &temp);
+
+    /* T = K * F + τ + Kp * (target - q) - Kd * dq/dt */
+    DVec3 dt = d_mat3_mul_vec(&dk, d_vec3_from_gsl(self->force));
+    for (int i = 0; i < 3; i++) {
+        dt.v[i] -= priv->servo_kp * dq.v[i] + priv->servo_kd * dqd.v[i];
+    }
+
+    /* d(I * d²q/dt²) = d(M * g - H * dq/dt + T) */
+    DVec3 dr = d_mat3_mul_vec(&dm, d_vec3_from_gsl(self->gravity));
+    dr = d_vec3_sub(dr, d_mat3_mul_vec(&dh, qd));
+    dr = d_vec3_sub(dr, d_mat3_mul_vec(&priv->model_coriolis, dqd));
+    dr = d_vec3_add(dr, dt);
+    dr = d_vec3_sub(dr, d_mat3_mul_vec(&di, q_dot_dot));
+
+    return d_mat3_ldlt_solve(&priv->model_inertia_ldlt, dr);
+}
+
+static int
+d_dynamic_model_jacobian_equation (double       t,
+                                   const double y[],
+                                   double       *dfdy,
+                                   double       dfdt[],
+                                   void         *params)
+{
+    return d_dynamic_model_jacobian((DDynamicModel *) params, y, dfdy, dfdt);
+}
+
 /* Public API */
+const gchar*
+d_dynamic_stepper_to_string (DDynamicStepper    stepper)
+{
+    g_return_val_if_fail(stepper < D_DYNAMIC_N_STEPPERS, NULL);
+
+    return d_dynamic_stepper_names[stepper];
+}
+
+const gsl_odeiv2_step_type*
+d_dynamic_stepper_get_type (DDynamicStepper stepper)
+{
+    g_return_val_if_fail(stepper < D_DYNAMIC_N_STEPPERS, NULL);
+
+    switch (stepper) {
+        case D_DYNAMIC_STEPPER_RKF45:
+            return gsl_odeiv2_step_rkf45;
+        case D_DYNAMIC_STEPPER_RKCK:
+            return gsl_odeiv2_step_rkck;
+        case D_DYNAMIC_STEPPER_RK8PD:
+            return gsl_odeiv2_step_rk8pd;
+        case D_DYNAMIC_STEPPER_MSADAMS:
+            return gsl_odeiv2_step_msadams;
+        case D_DYNAMIC_STEPPER_BSIMP:
+            return gsl_odeiv2_step_bsimp;
+        case D_DYNAMIC_STEPPER_MSBDF:
+            return gsl_odeiv2_step_msbdf;
+        default:
+            return gsl_odeiv2_step_rk4;
+    }
+}
+
 DDynamicModel*
 d_dynamic_model_new (DManipulator   *manipulator)
 {
@@ -1125,15 +1132,19 @@ void
 d_dynamic_model_solve_inverse (DDynamicModel    *self,
                                gdouble          interval)
 {
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+
     gsl_odeiv2_system sys = {
         d_dynamic_model_equation,
-        NULL,
+        d_dynamic_model_jacobian_equation,
         6,
         self
     };
     gsl_odeiv2_driver *driver = gsl_odeiv2_driver_alloc_y_new(&sys,
-                                        gsl_odeiv2_step_rk4,
-                                        1e-6, 1e-6, 0.0);
+                                        d_dynamic_stepper_get_type(priv->stepper),
+                                        1e-6,
+                                        priv->abs_tolerance,
+                                        priv->rel_tolerance);
     gdouble t = 0.0;
     gdouble y[6] = {
         gsl_vector_get(d_dynamic_model_get_axes(self), 0),
@@ -1154,3 +1165,368 @@ d_dynamic_model_solve_inverse (DDynamicModel    *self,
     d_dynamic_model_set_speed(self, &q_dot.vector);
     gsl_odeiv2_driver_free(driver);
 }
+
+int
+d_dynamic_model_evaluate (DDynamicModel *self,
+                          const gdouble y[6],
+                          gdouble       dydt[6])
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(self), GSL_EBADFUNC);
+
+    return d_dynamic_model_equation(0.0, y, dydt, self);
+}
+
+int
+d_dynamic_model_jacobian (DDynamicModel *self,
+                          const gdouble y[6],
+                          gdouble       dfdy[36],
+                          gdouble       dfdt[6])
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(self), GSL_EBADFUNC);
+
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+
+    /* The caches of the evaluation are the starting point */
+    gdouble dydt[6];
+    int status = d_dynamic_model_rhs(self, y, dydt);
+    if (status != GSL_SUCCESS) {
+        return status;
+    }
+    d_dynamic_model_get_direct_jacobian_dt(self, &priv->kinematics);
+    d_dynamic_model_get_inverse_jacobian_dt(self, &priv->kinematics);
+
+    /* d(dq/dt)/dy is [0 I], the rest one direction at a time */
+    DVec3 q_dot_dot = d_vec3(dydt[3], dydt[4], dydt[5]);
+    for (int j = 0; j < 6; j++) {
+        DVec3 dq = d_vec3(j == 0, j == 1, j == 2);
+        DVec3 dqd = d_vec3(j == 3, j == 4, j == 5);
+        DVec3 column = d_dynamic_model_tangent(self, &priv->kinematics,
+                                               q_dot_dot, dq, dqd);
+        for (int i = 0; i < 3; i++) {
+            dfdy[6 * i + j] = (j == i + 3) ? 1.0 : 0.0;
+            dfdy[6 * (i + 3) + j] = column.v[i];
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        dfdt[i] = 0.0;
+    }
+
+    return GSL_SUCCESS;
+}
+
+int
+d_dynamic_model_step_fixed (DDynamicModel       *self,
+                            DDynamicFixedMethod method,
+                            gdouble             h,
+                            gdouble             y[6])
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(self), GSL_EBADFUNC);
+    g_return_val_if_fail(method < D_DYNAMIC_N_FIXED_METHODS, GSL_EBADFUNC);
+
+    /* Stages live on the stack, y is only written once all succeeded */
+    gdouble k[4][6], yt[6];
+    int status = d_dynamic_model_equation(0.0, y, k[0], self);
+    if (status != GSL_SUCCESS) {
+        return status;
+    }
+
+    if (method == D_DYNAMIC_FIXED_SEMI_IMPLICIT_EULER) {
+        for (int i = 0; i < 3; i++) {
+            yt[i + 3] = y[i + 3] + h * k[0][i + 3];
+            yt[i] = y[i] + h * yt[i + 3];
+        }
+    } else {
+        /* Classic RK4, stage s is evaluated at y + c[s] * h * k[s - 1] */
+        static const gdouble c[4] = { 0.0, 0.5, 0.5, 1.0 };
+        for (int s = 1; s < 4; s++) {
+            for (int i = 0; i < 6; i++) {
+                yt[i] = y[i] + c[s] * h * k[s - 1][i];
+            }
+            status = d_dynamic_model_equation(0.0, yt, k[s], self);
+            if (status != GSL_SUCCESS) {
+                return status;
+            }
+        }
+        for (int i = 0; i < 6; i++) {
+            yt[i] = y[i] + h / 6.0 * (k[0][i] + 2.0 * (k[1][i] + k[2][i])
+                                      + k[3][i]);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        y[i] = yt[i];
+    }
+
+    return GSL_SUCCESS;
+}
+
+void
+d_dynamic_model_set_stepper (DDynamicModel      *self,
+                             DDynamicStepper    stepper)
+{
+    g_return_if_fail(D_IS_DYNAMIC_MODEL(self));
+    g_return_if_fail(stepper < D_DYNAMIC_N_STEPPERS);
+
+    D_DYNAMIC_MODEL_GET_PRIVATE(self)->stepper = stepper;
+}
+
+DDynamicStepper
+d_dynamic_model_get_stepper (DDynamicModel  *self)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(self), D_DYNAMIC_MODEL_STEPPER);
+
+    return D_DYNAMIC_MODEL_GET_PRIVATE(self)->stepper;
+}
+
+void
+d_dynamic_model_set_tolerance (DDynamicModel    *self,
+                               gdouble          abs_tolerance,
+                               gdouble          rel_tolerance)
+{
+    g_return_if_fail(D_IS_DYNAMIC_MODEL(self));
+    g_return_if_fail(abs_tolerance >= 0.0 && rel_tolerance >= 0.0);
+    g_return_if_fail(abs_tolerance > 0.0 || rel_tolerance > 0.0);
+
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+    priv->abs_tolerance = abs_tolerance;
+    priv->rel_tolerance = rel_tolerance;
+}
+
+void
+d_dynamic_model_get_tolerance (DDynamicModel    *self,
+                               gdouble          *abs_tolerance,
+                               gdouble          *rel_tolerance)
+{
+    g_return_if_fail(D_IS_DYNAMIC_MODEL(self));
+
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+    if (abs_tolerance) {
+        *abs_tolerance = priv->abs_tolerance;
+    }
+    if (rel_tolerance) {
+        *rel_tolerance = priv->rel_tolerance;
+    }
+}
+
+void
+d_dynamic_model_set_servo (DDynamicModel    *self,
+                           gdouble          kp,
+                           gdouble          kd,
+                           gsl_vector       *target)
+{
+    g_return_if_fail(D_IS_DYNAMIC_MODEL(self));
+    g_return_if_fail(target != NULL || (kp == 0.0 && kd == 0.0));
+
+    DDynamicModelPrivate *priv = D_DYNAMIC_MODEL_GET_PRIVATE(self);
+    priv->servo_kp = kp;
+    priv->servo_kd = kd;
+    priv->servo_target = target ? d_vec3_from_gsl(target) : d_vec3(0.0, 0.0, 0.0);
+}
+
+void
+d_dynamic_model_get_axes_torque (DDynamicModel  *self,
+                                 const gdouble  y[6],
+                                 gdouble        torque[3])
+{
+    g_return_if_fail(D_IS_DYNAMIC_MODEL(self));
+    g_return_if_fail(y != NULL && torque != NULL);
+
+    DVec3 tt = d_dynamic_model_compute_axes_torque(self,
+                                                   d_vec3(y[0], y[1], y[2]),
+                                                   d_vec3(y[3], y[4], y[5]));
+    for (int i = 0; i < 3; i++) {
+        torque[i] = tt.v[i];
+    }
+}
+
+/* Samples per task of the threaded inverse dynamics */
+#define D_DYNAMIC_MODEL_BATCH_CHUNK 2048
+
+/* Inverse dynamics shared by the chunk tasks */
+typedef struct {
+    DGeometry           *geometry;
+    const DDynamicSpec  *spec;
+    DVec3               force;
+    DVec3               gravity;
+
+    gsize               n;
+    const gdouble       *axes;
+    const gdouble       *speed;
+    const gdouble       *accel;
+    gdouble             *torque;
+
+    /* Next chunk to solve, taken atomically by the workers */
+    gsize               n_chunks;
+    gint                next_chunk;
+
+    /* Pool workers still running and samples solved, under lock */
+    GMutex              lock;
+    GCond               done;
+    gint                pending;
+    gsize               solved;
+} DDynamicModelBatch;
+
+/*
+ * Inverse dynamics of samples [first, last), through the platform
+ * acceleration: the equations reduce to
+ * τ = Jq * Jp⁻ᵀ * (Mp * (d²p/dt² - g) - F) + Iq * d²q/dt² - Mq * g
+ * with d²p/dt² = Jp⁻¹ * (Jq * d²q/dt² + Jqd * dq/dt + Jpd * dp/dt), as Mp
+ * and Iq are scalar matrices.
+ */
+static gsize
+d_dynamic_model_inverse_dynamics_range (const DDynamicModelBatch    *batch,
+                                        gsize                       first,
+                                        gsize                       last)
+{
+    DGeometry *geometry = batch->geometry;
+    const DDynamicSpec *spec = batch->spec;
+    const DVec3 f = batch->force;
+    const DVec3 g = batch->gravity;
+
+    gdouble mass_pos = spec->platform_mass + 3.0 * spec->upper_arm_mass;
+    gdouble inertia_axes = spec->upper_arm_mass * geometry->derived.a2
+                           + spec->low_arm_moi;
+
+    gsize solved = 0;
+    for (gsize k = first; k < last; k++) {
+        const gdouble *q = batch->axes + 3 * k;
+        const gdouble *q_dot = batch->speed + 3 * k;
+        const gdouble *q_dot_dot = batch->accel + 3 * k;
+        gdouble *tau = batch->torque + 3 * k;
+
+        DDynamicModelKinematics ks;
+        if (!d_dynamic_model_kinematics_position(geometry,
+                                                 d_vec3(q[0], q[1], q[2]),
+                                                 &ks, NULL)) {
+            tau[0] = tau[1] = tau[2] = GSL_NAN;
+            continue;
+        }
+        d_dynamic_model_kinematics_speed(&ks, d_vec3(q_dot[0], q_dot[1], q_dot[2]));
+
+        DMat3 jpd, jqd, ma;
+        d_dynamic_model_compute_jpd(geometry, &ks, &jpd);
+        d_dynamic_model_compute_jqd(geometry, &ks, &jqd);
+        d_dynamic_model_compute_mass_axes(geometry, spec, &ks, &ma);
+
+        DVec3 qdd = d_vec3(q_dot_dot[0], q_dot_dot[1], q_dot_dot[2]);
+        DVec3 acc = d_vec3_add(d_mat3_mul_vec(&ks.jacobian_q, qdd),
+                               d_mat3_mul_vec(&jqd, ks.speed));
+        acc = d_vec3_add(acc, d_mat3_mul_vec(&jpd, ks.speed_pos));
+        acc = d_mat3_mul_vec(&ks.jacobian_p_inv, acc);
+
+        DVec3 w = d_vec3_sub(d_vec3_scale(d_vec3_sub(acc, g), mass_pos), f);
+        DVec3 t = d_mat3_mul_vec(&ks.k, w);
+        t = d_vec3_add(t, d_vec3_scale(qdd, inertia_axes));
+        t = d_vec3_sub(t, d_mat3_mul_vec(&ma, g));
+
+        tau[0] = t.v[0];
+        tau[1] = t.v[1];
+        tau[2] = t.v[2];
+        solved++;
+    }
+    return solved;
+}
+
+/* Solves chunks until there are none left, returns the samples solved */
+static gsize
+d_dynamic_model_inverse_dynamics_worker (DDynamicModelBatch *batch)
+{
+    gsize solved = 0;
+    for (;;) {
+        gsize c = (gsize) g_atomic_int_add(&batch->next_chunk, 1);
+        if (c >= batch->n_chunks) {
+            break;
+        }
+        gsize first = c * D_DYNAMIC_MODEL_BATCH_CHUNK;
+        gsize last = MIN(first + D_DYNAMIC_MODEL_BATCH_CHUNK, batch->n);
+        solved += d_dynamic_model_inverse_dynamics_range(batch, first, last);
+    }
+    return solved;
+}
+
+static void
+d_dynamic_model_inverse_dynamics_task (gpointer    data,
+                                       gpointer    user_data)
+{
+    DDynamicModelBatch *batch = data;
+    gsize solved = d_dynamic_model_inverse_dynamics_worker(batch);
+
+    g_mutex_lock(&batch->lock);
+    batch->solved += solved;
+    if (--batch->pending == 0) {
+        g_cond_signal(&batch->done);
+    }
+    g_mutex_unlock(&batch->lock);
+}
+
+/*
+ * Pool shared by every batch, created on first use. It is not exclusive,
+ * so its threads are kept around between calls and the batch itself bounds
+ * how many of them work on it.
+ */
+static GThreadPool*
+d_dynamic_model_batch_pool (void)
+{
+    static gsize pool = 0;
+
+    if (g_once_init_enter(&pool)) {
+        GThreadPool *shared = g_thread_pool_new(d_dynamic_model_inverse_dynamics_task,
+                                                NULL, -1, FALSE, NULL);
+        g_once_init_leave(&pool, (gsize) shared);
+    }
+    return (GThreadPool*) pool;
+}
+
+gsize
+d_dynamic_model_inverse_dynamics_batch (DDynamicModel   *self,
+                                        gsize           n,
+                                        const gdouble   *axes,
+                                        const gdouble   *speed,
+                                        const gdouble   *accel,
+                                        gdouble         *torque,
+                                        gint            n_threads)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(self), 0);
+    g_return_val_if_fail(n == 0 || (axes && speed && accel && torque), 0);
+
+    DDynamicModelBatch batch = {
+        self->manipulator->geometry,
+        self->manipulator->dynamic_params,
+        d_vec3_from_gsl(self->force),
+        d_vec3_from_gsl(self->gravity),
+        n, axes, speed, accel, torque,
+        (n + D_DYNAMIC_MODEL_BATCH_CHUNK - 1) / D_DYNAMIC_MODEL_BATCH_CHUNK, 0
+    };
+
+    if (n_threads <= 0) {
+        n_threads = g_get_num_processors();
+    }
+    n_threads = MIN((gsize) n_threads, batch.n_chunks);
+
+    /* Short trajectories run here */
+    if (n_threads <= 1) {
+        return d_dynamic_model_inverse_dynamics_range(&batch, 0, n);
+    }
+
+    /* The calling thread is one of the workers */
+    GThreadPool *pool = d_dynamic_model_batch_pool();
+    g_mutex_init(&batch.lock);
+    g_cond_init(&batch.done);
+    batch.pending = n_threads - 1;
+    for (gint i = 1; i < n_threads; i++) {
+        g_thread_pool_push(pool, &batch, NULL);
+    }
+    gsize solved = d_dynamic_model_inverse_dynamics_worker(&batch);
+
+    g_mutex_lock(&batch.lock);
+    while (batch.pending > 0) {
+        g_cond_wait(&batch.done, &batch.lock);
+    }
+    solved += batch.solved;
+    g_mutex_unlock(&batch.lock);
+
+    g_cond_clear(&batch.done);
+    g_mutex_clear(&batch.lock);
+
+    return solved;
+}
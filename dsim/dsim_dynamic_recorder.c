@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_recorder.c :
+ */
+
+#include "dsim_dynamic_recorder.h"
+#include "dsim_solver.h"
+#include <math.h>
+
+/* Private Methods */
+static void
+d_dynamic_recorder_push (DDynamicRecorder   *recorder,
+                         gdouble            time,
+                         const gdouble      y[6],
+                         DDynamicModel      *model)
+{
+    DDynamicRecord *record;
+    if (recorder->length < recorder->capacity) {
+        record = &recorder->records[(recorder->head + recorder->length)
+                                    % recorder->capacity];
+        recorder->length++;
+    } else {
+        record = &recorder->records[recorder->head];
+        recorder->head = (recorder->head + 1) % recorder->capacity;
+    }
+    recorder->n_recorded++;
+
+    record->time = time;
+    for (int i = 0; i < 3; i++) {
+        record->axes[i] = y[i];
+        record->speed[i] = y[i + 3];
+    }
+    d_dynamic_model_get_axes_torque(model, y, record->torque);
+
+    DGeometry *geometry = model->manipulator->geometry;
+    gsl_vector_view axes = gsl_vector_view_array(record->axes, 3);
+    gsl_vector_view pos = gsl_vector_view_array(record->pos, 3);
+    if (d_solver_solve_direct_status(geometry, &axes.vector, &pos.vector)
+            != D_SOLVER_STATUS_OK) {
+        for (int i = 0; i < 3; i++) {
+            record->pos[i] = NAN;
+        }
+    }
+}
+
+/*
+ * Interpolation at t0 + theta * h of a step from (y0, f0) to (y1, f1).
+ * The axes follow the quintic Hermite polynomial matching position, speed
+ * and acceleration at both ends, and the speeds its derivative.
+ */
+static void
+d_dynamic_recorder_interpolate (gdouble         theta,
+                                gdouble         h,
+                                const gdouble   y0[6],
+                                const gdouble   f0[6],
+                                const gdouble   y1[6],
+                                const gdouble   f1[6],
+                                gdouble         y[6])
+{
+    gdouble t2 = theta * theta;
+    gdouble t3 = t2 * theta;
+    gdouble t4 = t3 * theta;
+    gdouble t5 = t4 * theta;
+
+    /* Basis for q0, h q0', h² q0'', h² q1'', h q1' and q1 */
+    gdouble p0 = 1.0 - 10.0 * t3 + 15.0 * t4 - 6.0 * t5;
+    gdouble p1 = theta - 6.0 * t3 + 8.0 * t4 - 3.0 * t5;
+    gdouble p2 = 0.5 * (t2 - 3.0 * t3 + 3.0 * t4 - t5);
+    gdouble p3 = 0.5 * (t3 - 2.0 * t4 + t5);
+    gdouble p4 = - 4.0 * t3 + 7.0 * t4 - 3.0 * t5;
+    gdouble p5 = 10.0 * t3 - 15.0 * t4 + 6.0 * t5;
+
+    /* and their derivatives over theta */
+    gdouble d0 = - 30.0 * t2 + 60.0 * t3 - 30.0 * t4;
+    gdouble d1 = 1.0 - 18.0 * t2 + 32.0 * t3 - 15.0 * t4;
+    gdouble d2 = 0.5 * (2.0 * theta - 9.0 * t2 + 12.0 * t3 - 5.0 * t4);
+    gdouble d3 = 0.5 * (3.0 * t2 - 8.0 * t3 + 5.0 * t4);
+    gdouble d4 = - 12.0 * t2 + 28.0 * t3 - 15.0 * t4;
+    gdouble d5 = - d0;
+
+    for (int i = 0; i < 3; i++) {
+        y[i] = p0 * y0[i] + p5 * y1[i]
+               + h * (p1 * f0[i] + p4 * f1[i])
+               + h * h * (p2 * f0[i + 3] + p3 * f1[i + 3]);
+        y[i + 3] = (d0 * y0[i] + d5 * y1[i]) / h
+                   + d1 * f0[i] + d4 * f1[i]
+                   + h * (d2 * f0[i + 3] + d3 * f1[i + 3]);
+    }
+}
+
+static gboolean
+d_dynamic_recorder_evaluate (DDynamicSession    *session,
+                             const gdouble      y[6],
+                             gdouble            f[6],
+                             GError             **err)
+{
+    int status = d_dynamic_model_evaluate(session->model, y, f);
+    if (status != GSL_SUCCESS) {
+        g_set_error(err,
+                D_DYNAMIC_SESSION_ERROR,
+                D_DYNAMIC_SESSION_ERROR_FAILED,
+                "Can't evaluate the model at t = %g: %s",
+                session->time, gsl_strerror(status));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Public API */
+DDynamicRecorder*
+d_dynamic_recorder_new (gsize   capacity,
+                        gdouble period)
+{
+    g_return_val_if_fail(capacity > 0, NULL);
+    g_return_val_if_fail(period > 0.0, NULL);
+
+    DDynamicRecorder *recorder = g_new(DDynamicRecorder, 1);
+    recorder->period = period;
+    recorder->capacity = capacity;
+    recorder->records = g_new(DDynamicRecord, capacity);
+    d_dynamic_recorder_clear(recorder);
+
+    return recorder;
+}
+
+void
+d_dynamic_recorder_free (DDynamicRecorder   *recorder)
+{
+    if (!recorder) {
+        return;
+    }
+
+    g_free(recorder->records);
+    g_free(recorder);
+}
+
+void
+d_dynamic_recorder_clear (DDynamicRecorder  *recorder)
+{
+    g_return_if_fail(recorder != NULL);
+
+    recorder->head = 0;
+    recorder->length = 0;
+    recorder->n_recorded = 0;
+    recorder->start = NAN;
+    recorder->next_sample = 0;
+}
+
+const DDynamicRecord*
+d_dynamic_recorder_get (const DDynamicRecorder  *recorder,
+                        gsize                   i)
+{
+    g_return_val_if_fail(recorder != NULL, NULL);
+    g_return_val_if_fail(i < recorder->length, NULL);
+
+    return &recorder->records[(recorder->head + i) % recorder->capacity];
+}
+
+gboolean
+d_dynamic_recorder_run (DDynamicRecorder    *recorder,
+                        DDynamicSession     *session,
+                        gdouble             time,
+                        GError              **err)
+{
+    g_return_val_if_fail(recorder != NULL, FALSE);
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(session), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    gdouble t0 = d_dynamic_session_get_time(session);
+    if (isnan(recorder->start)) {
+        recorder->start = t0;
+    }
+    /* Samples behind the session can't be taken anymore */
+    gdouble sample = recorder->start + recorder->next_sample * recorder->period;
+    if (sample < t0) {
+        recorder->next_sample = (guint64) ceil((t0 - recorder->start)
+                                               / recorder->period);
+        sample = recorder->start + recorder->next_sample * recorder->period;
+    }
+
+    gdouble y0[6], f0[6], y1[6], f1[6], y[6];
+    d_dynamic_session_get_state(session, y0);
+    if (!d_dynamic_recorder_evaluate(session, y0, f0, err)) {
+        return FALSE;
+    }
+    if (sample == t0 && sample <= time) {
+        d_dynamic_recorder_push(recorder, sample, y0, session->model);
+        recorder->next_sample++;
+        sample = recorder->start + recorder->next_sample * recorder->period;
+    }
+
+    while (t0 < time) {
+        if (!d_dynamic_session_step_to(session, time, err)) {
+            return FALSE;
+        }
+        gdouble t1 = d_dynamic_session_get_time(session);
+        d_dynamic_session_get_state(session, y1);
+        if (!d_dynamic_recorder_evaluate(session, y1, f1, err)) {
+            return FALSE;
+        }
+
+        gdouble h = t1 - t0;
+        while (sample <= t1 && sample <= time) {
+            d_dynamic_recorder_interpolate((sample - t0) / h, h,
+                                           y0, f0, y1, f1, y);
+            d_dynamic_recorder_push(recorder, sample, y, session->model);
+            recorder->next_sample++;
+            sample = recorder->start + recorder->next_sample * recorder->period;
+        }
+
+        t0 = t1;
+        for (int i = 0; i < 6; i++) {
+            y0[i] = y1[i];
+            f0[i] = f1[i];
+        }
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_recorder.h : Fixed rate samples of a dynamic session kept in
+ *                           a preallocated ring buffer, interpolated
+ *                           between the steps the integrator chooses.
+ */
+
+#ifndef  DSIM_DYNAMIC_RECORDER_INC
+#define  DSIM_DYNAMIC_RECORDER_INC
+
+#include <glib.h>
+#include <dsim/dsim_dynamic_session.h>
+
+/* One sample of the simulation */
+typedef struct {
+    gdouble     time;
+    gdouble     axes[3];
+    gdouble     speed[3];
+    gdouble     torque[3];  /* Torque on the axes, input plus servo */
+    gdouble     pos[3];     /* Platform position, NaN out of the working
+                               space */
+} DDynamicRecord;
+
+/*
+ * Ring buffer of capacity records, sampled every period from the session
+ * time of the first run. Once full, every new record replaces the oldest.
+ */
+typedef struct _DDynamicRecorder DDynamicRecorder;
+struct _DDynamicRecorder {
+    gdouble         period;
+
+    gsize           capacity;
+    DDynamicRecord  *records;
+
+    /* Oldest record and number of records held */
+    gsize           head;
+    gsize           length;
+
+    /* Records taken, held or replaced */
+    guint64         n_recorded;
+
+    /* Sample k is taken at start + k * period */
+    gdouble         start;
+    guint64         next_sample;
+};
+
+DDynamicRecorder*   d_dynamic_recorder_new      (gsize          capacity,
+                                                 gdouble        period);
+
+void                d_dynamic_recorder_free     (DDynamicRecorder   *recorder);
+
+/* Drops every record, the next run samples from its own start */
+void                d_dynamic_recorder_clear    (DDynamicRecorder   *recorder);
+
+/* Record i, 0 being the oldest held */
+const DDynamicRecord*
+                    d_dynamic_recorder_get      (const DDynamicRecorder *recorder,
+                                                 gsize                  i);
+
+/*
+ * Integrates the session up to time at the step size its control
+ * chooses, recording every sample on the way. Samples between two steps
+ * come from Hermite interpolation of the axes, their speed and their
+ * acceleration at both ends, which costs one more evaluation of the model
+ * per step.
+ * The torque input of the model is taken as held through the run, the
+ * servo term of each record follows its interpolated state.
+ */
+gboolean            d_dynamic_recorder_run      (DDynamicRecorder   *recorder,
+                                                 DDynamicSession    *session,
+                                                 gdouble            time,
+                                                 GError             **err);
+
+#endif   /* ----- #ifndef DSIM_DYNAMIC_RECORDER_INC  ----- */
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_session.c :
+ */
+
+#include "dsim_dynamic_session.h"
+
+/* GType Register */
+G_DEFINE_TYPE(DDynamicSession, d_dynamic_session, G_TYPE_OBJECT);
+
+/* DDynamicSession implementation */
+static void
+d_dynamic_session_init (DDynamicSession *self)
+{
+    self->model = NULL;
+    self->driver = NULL;
+    self->stepper = D_DYNAMIC_MODEL_STEPPER;
+    self->abs_tolerance = D_DYNAMIC_MODEL_TOLERANCE;
+    self->rel_tolerance = 0.0;
+    self->time = 0.0;
+    self->step = D_DYNAMIC_SESSION_FIRST_STEP;
+    self->n_steps = 0;
+    for (int i = 0; i < 6; i++) {
+        self->state[i] = 0.0;
+    }
+}
+
+static void
+d_dynamic_session_dispose (GObject *gobject)
+{
+    DDynamicSession *self = D_DYNAMIC_SESSION(gobject);
+
+    if (self->model) {
+        g_object_unref(self->model);
+        self->model = NULL;
+    }
+
+    /* Chain Up */
+    G_OBJECT_CLASS(d_dynamic_session_parent_class)->dispose(gobject);
+}
+
+static void
+d_dynamic_session_finalize (GObject *gobject)
+{
+    DDynamicSession *self = D_DYNAMIC_SESSION(gobject);
+
+    if (self->driver) {
+        gsl_odeiv2_driver_free(self->driver);
+        self->driver = NULL;
+    }
+
+    /* Chain Up */
+    G_OBJECT_CLASS(d_dynamic_session_parent_class)->finalize(gobject);
+}
+
+static void
+d_dynamic_session_class_init (DDynamicSessionClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    gobject_class->dispose = d_dynamic_session_dispose;
+    gobject_class->finalize = d_dynamic_session_finalize;
+}
+
+static int
+d_dynamic_session_equation (double          t,
+                            const double    y[],
+                            double          dydt[],
+                            void            *params)
+{
+    return d_dynamic_model_evaluate((DDynamicModel *) params, y, dydt);
+}
+
+static int
+d_dynamic_session_jacobian (double          t,
+                            const double    y[],
+                            double          *dfdy,
+                            double          dfdt[],
+                            void            *params)
+{
+    return d_dynamic_model_jacobian((DDynamicModel *) params, y, dfdy, dfdt);
+}
+
+/* Makes the driver again when the model asks for another integrator */
+static void
+d_dynamic_session_update_driver (DDynamicSession    *self)
+{
+    DDynamicStepper stepper = d_dynamic_model_get_stepper(self->model);
+    gdouble abs_tolerance, rel_tolerance;
+    d_dynamic_model_get_tolerance(self->model, &abs_tolerance, &rel_tolerance);
+
+    if (self->driver
+            && stepper == self->stepper
+            && abs_tolerance == self->abs_tolerance
+            && rel_tolerance == self->rel_tolerance) {
+        gsl_odeiv2_driver_reset(self->driver);
+        return;
+    }
+
+    if (self->driver) {
+        gsl_odeiv2_driver_free(self->driver);
+    }
+    self->driver = gsl_odeiv2_driver_alloc_y_new(&self->system,
+                                                 d_dynamic_stepper_get_type(stepper),
+                                                 D_DYNAMIC_SESSION_FIRST_STEP,
+                                                 abs_tolerance,
+                                                 rel_tolerance);
+    self->stepper = stepper;
+    self->abs_tolerance = abs_tolerance;
+    self->rel_tolerance = rel_tolerance;
+}
+
+/* Leaves the model at the axes and speed of the session */
+static void
+d_dynamic_session_sync_model (DDynamicSession   *self)
+{
+    gsl_vector_view q = gsl_vector_view_array(&self->state[0], 3);
+    gsl_vector_view q_dot = gsl_vector_view_array(&self->state[3], 3);
+    d_dynamic_model_set_axes(self->model, &q.vector);
+    d_dynamic_model_set_speed(self->model, &q_dot.vector);
+}
+
+/*
+ * One step towards time, never past it. The step size carried to the next
+ * call is the one the control suggests, except when the step was only cut
+ * short to land on time.
+ */
+static gboolean
+d_dynamic_session_apply (DDynamicSession    *self,
+                         gdouble            time,
+                         GError             **err)
+{
+    gsl_odeiv2_driver *d = self->driver;
+    gdouble t0 = self->time;
+    gboolean clipped = self->step > time - t0;
+    gdouble h = self->step;
+
+    int status = gsl_odeiv2_evolve_apply(d->e, d->c, d->s, &self->system,
+                                         &self->time, time, &h, self->state);
+    if (status != GSL_SUCCESS) {
+        g_set_error(err,
+                D_DYNAMIC_SESSION_ERROR,
+                D_DYNAMIC_SESSION_ERROR_FAILED,
+                "Integration failed at t = %g: %s",
+                t0, gsl_strerror(status));
+        return FALSE;
+    }
+    self->n_steps++;
+    if (!clipped || h < time - t0) {
+        self->step = h;
+    }
+    return TRUE;
+}
+
+/* Public API */
+DDynamicSession*
+d_dynamic_session_new (DDynamicModel    *model)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_MODEL(model), NULL);
+
+    DDynamicSession *ds = g_object_new(D_TYPE_DYNAMIC_SESSION, NULL);
+    ds->model = g_object_ref(model);
+    ds->system.function = d_dynamic_session_equation;
+    ds->system.jacobian = d_dynamic_session_jacobian;
+    ds->system.dimension = 6;
+    ds->system.params = model;
+    d_dynamic_session_reset(ds);
+
+    return ds;
+}
+
+void
+d_dynamic_session_reset (DDynamicSession    *self)
+{
+    g_return_if_fail(D_IS_DYNAMIC_SESSION(self));
+
+    gsl_vector *axes = d_dynamic_model_get_axes(self->model);
+    gsl_vector *speed = d_dynamic_model_get_speed(self->model);
+    for (int i = 0; i < 3; i++) {
+        self->state[i] = gsl_vector_get(axes, i);
+        self->state[i + 3] = gsl_vector_get(speed, i);
+    }
+    self->time = 0.0;
+    self->step = D_DYNAMIC_SESSION_FIRST_STEP;
+    self->n_steps = 0;
+    d_dynamic_session_update_driver(self);
+}
+
+gboolean
+d_dynamic_session_step (DDynamicSession *self,
+                        GError          **err)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(self), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    gboolean ok = d_dynamic_session_apply(self, G_MAXDOUBLE, err);
+    d_dynamic_session_sync_model(self);
+    return ok;
+}
+
+gboolean
+d_dynamic_session_step_to (DDynamicSession  *self,
+                           gdouble          time,
+                           GError           **err)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(self), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+    g_return_val_if_fail(time > self->time, FALSE);
+
+    gboolean ok = d_dynamic_session_apply(self, time, err);
+    d_dynamic_session_sync_model(self);
+    return ok;
+}
+
+gboolean
+d_dynamic_session_advance_to (DDynamicSession   *self,
+                              gdouble           time,
+                              GError            **err)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(self), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+    g_return_val_if_fail(time >= self->time, FALSE);
+
+    gboolean ok = TRUE;
+    while (ok && self->time < time) {
+        ok = d_dynamic_session_apply(self, time, err);
+    }
+    d_dynamic_session_sync_model(self);
+    return ok;
+}
+
+gdouble
+d_dynamic_session_get_time (DDynamicSession *self)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(self), 0.0);
+
+    return self->time;
+}
+
+void
+d_dynamic_session_get_state (DDynamicSession    *self,
+                             gdouble            state[6])
+{
+    g_return_if_fail(D_IS_DYNAMIC_SESSION(self));
+
+    for (int i = 0; i < 6; i++) {
+        state[i] = self->state[i];
+    }
+}
+
+gulong
+d_dynamic_session_get_steps (DDynamicSession    *self)
+{
+    g_return_val_if_fail(D_IS_DYNAMIC_SESSION(self), 0);
+
+    return self->n_steps;
+}
+
+GQuark
+d_dynamic_session_error_quark (void)
+{
+    return g_quark_from_static_string("d_dynamic_session_error_quark");
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_dynamic_session.h : Integration of a dynamic model over time that
+ *                          keeps the integrator, its state and its step
+ *                          size from one call to the next.
+ */
+
+#ifndef  DSIM_DYNAMIC_SESSION_INC
+#define  DSIM_DYNAMIC_SESSION_INC
+
+#include <glib-object.h>
+#include <gsl/gsl_odeiv2.h>
+#include <dsim/dsim_dynamics.h>
+
+/* Type macros */
+#define D_TYPE_DYNAMIC_SESSION             (d_dynamic_session_get_type ())
+#define D_DYNAMIC_SESSION(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), D_TYPE_DYNAMIC_SESSION, DDynamicSession))
+#define D_IS_DYNAMIC_SESSION(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), D_TYPE_DYNAMIC_SESSION))
+#define D_DYNAMIC_SESSION_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), D_TYPE_DYNAMIC_SESSION, DDynamicSessionClass))
+#define D_IS_DYNAMIC_SESSION_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), D_TYPE_DYNAMIC_SESSION))
+#define D_DYNAMIC_SESSION_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), D_TYPE_DYNAMIC_SESSION, DDynamicSessionClass))
+
+/* First step, the one of d_dynamic_model_solve_inverse */
+#define D_DYNAMIC_SESSION_FIRST_STEP    1e-6
+
+/* Instance Structure of DDynamicSession */
+typedef struct _DDynamicSession DDynamicSession;
+struct _DDynamicSession {
+    GObject             parent_instance;
+
+    DDynamicModel       *model;
+
+    gsl_odeiv2_system   system;
+    gsl_odeiv2_driver   *driver;
+
+    /* Stepper and tolerances the driver was made for */
+    DDynamicStepper     stepper;
+    gdouble             abs_tolerance;
+    gdouble             rel_tolerance;
+
+    /* Time and state, axes followed by their speeds */
+    gdouble             time;
+    gdouble             state[6];
+
+    /* Step size suggested by the control for the next step */
+    gdouble             step;
+    gulong              n_steps;
+};
+
+/* Class Structure of DDynamicSession */
+typedef struct _DDynamicSessionClass DDynamicSessionClass;
+struct _DDynamicSessionClass {
+    GObjectClass    parent_class;
+};
+
+/* Methods */
+GType           d_dynamic_session_get_type  (void);
+
+/* Starts at time 0 from the axes and speed of the model */
+DDynamicSession*
+                d_dynamic_session_new       (DDynamicModel      *model);
+
+/*
+ * Takes the axes and speed of the model again, back at time 0 and with the
+ * first step size. Needed after changing them from outside the session, and
+ * to pick up a new stepper or tolerances of the model.
+ */
+void            d_dynamic_session_reset     (DDynamicSession    *self);
+
+/*
+ * Takes one step of the size chosen by the step control. The model axes
+ * and speed follow the session after every call.
+ */
+gboolean        d_dynamic_session_step      (DDynamicSession    *self,
+                                             GError             **err);
+
+/* Like d_dynamic_session_step, but the step is shortened to stop at time */
+gboolean        d_dynamic_session_step_to   (DDynamicSession    *self,
+                                             gdouble            time,
+                                             GError             **err);
+
+/*
+ * Integrates up to time, landing on it exactly. The last step is shortened
+ * to do so but the step size carried to the next call is not, so sampling
+ * at a fine rate costs no more steps than the dynamics need.
+ */
+gboolean        d_dynamic_session_advance_to(DDynamicSession    *self,
+                                             gdouble            time,
+                                             GError             **err);
+
+gdouble         d_dynamic_session_get_time  (DDynamicSession    *self);
+
+void            d_dynamic_session_get_state (DDynamicSession    *self,
+                                             gdouble            state[6]);
+
+/* Steps taken since the last reset */
+gulong          d_dynamic_session_get_steps (DDynamicSession    *self);
+
+/* Error type for failed integration */
+#define D_DYNAMIC_SESSION_ERROR d_dynamic_session_error_quark ()
+
+typedef enum {
+    D_DYNAMIC_SESSION_ERROR_FAILED
+} DDynamicSessionError;
+
+GQuark          d_dynamic_session_error_quark   (void);
+
+#endif   /* ----- #ifndef DSIM_DYNAMIC_SESSION_INC  ----- */
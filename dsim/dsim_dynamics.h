@@ -72,6 +72,32 @@ struct _DDynamicModelClass {
     GObjectClass    parent_class;
 };
 
+/*
+ * Integration methods for the equations of motion, the gsl_odeiv2 steppers
+ * of the same name. BSIMP and MSBDF are implicit and use the analytic
+ * jacobian of the equations, they take far fewer steps on stiff settings
+ * such as a high gain servo.
+ */
+typedef enum {
+    D_DYNAMIC_STEPPER_RK4 = 0,
+    D_DYNAMIC_STEPPER_RKF45,
+    D_DYNAMIC_STEPPER_RKCK,
+    D_DYNAMIC_STEPPER_RK8PD,
+    D_DYNAMIC_STEPPER_MSADAMS,
+    D_DYNAMIC_STEPPER_BSIMP,
+    D_DYNAMIC_STEPPER_MSBDF,
+    D_DYNAMIC_N_STEPPERS
+} DDynamicStepper;
+
+/* Default stepper and absolute tolerance, the relative one is 0 */
+#define D_DYNAMIC_MODEL_STEPPER         D_DYNAMIC_STEPPER_RK4
+#define D_DYNAMIC_MODEL_TOLERANCE       1e-6
+
+const gchar*    d_dynamic_stepper_to_string (DDynamicStepper    stepper);
+
+const gsl_odeiv2_step_type*
+                d_dynamic_stepper_get_type  (DDynamicStepper    stepper);
+
 /* Returns GType associated with this object type */
 GType           d_dynamic_model_get_type    (void);
 
@@ -103,8 +129,106 @@ void            d_dynamic_model_set_gravity (DDynamicModel  *self,
 
 gsl_vector*     d_dynamic_model_get_gravity (DDynamicModel  *self);
 
+void            d_dynamic_model_set_stepper (DDynamicModel  *self,
+                                             DDynamicStepper stepper);
+
+DDynamicStepper d_dynamic_model_get_stepper (DDynamicModel  *self);
+
+/* Absolute and relative error allowed on each step */
+void            d_dynamic_model_set_tolerance
+                                            (DDynamicModel  *self,
+                                             gdouble        abs_tolerance,
+                                             gdouble        rel_tolerance);
+
+void            d_dynamic_model_get_tolerance
+                                            (DDynamicModel  *self,
+                                             gdouble        *abs_tolerance,
+                                             gdouble        *rel_tolerance);
+
+/*
+ * Joint space servo closed inside the equations of motion. The torque on
+ * the axes becomes torque + kp (target - q) - kd dq/dt. Gains of 0, the
+ * default, leave it out.
+ */
+void            d_dynamic_model_set_servo   (DDynamicModel  *self,
+                                             gdouble        kp,
+                                             gdouble        kd,
+                                             gsl_vector     *target);
+
+/*
+ * Torque on the axes at state y, as laid out for d_dynamic_model_evaluate:
+ * the torque input plus the servo term.
+ */
+void            d_dynamic_model_get_axes_torque
+                                            (DDynamicModel  *self,
+                                             const gdouble  y[6],
+                                             gdouble        torque[3]);
+
 void            d_dynamic_model_solve_inverse
                                             (DDynamicModel  *self,
                                              gdouble        interval);
 
+/*
+ * Evaluates the equations of motion at state y, three axes followed by
+ * their speeds, into dydt with the current force, torque and gravity.
+ * Returns GSL_SUCCESS, or GSL_EBADFUNC where the kinematics can't be
+ * solved.
+ */
+int             d_dynamic_model_evaluate    (DDynamicModel  *self,
+                                             const gdouble  y[6],
+                                             gdouble        dydt[6]);
+
+/*
+ * Jacobian of the equations of motion at state y: dfdy receives the 6x6
+ * row-major matrix of derivatives of dydt with respect to y, dfdt its time
+ * derivative, which is zero. Derivatives are exact, carried through the
+ * kinematics by the chain rule. Same return values as
+ * d_dynamic_model_evaluate.
+ */
+int             d_dynamic_model_jacobian    (DDynamicModel  *self,
+                                             const gdouble  y[6],
+                                             gdouble        dfdy[36],
+                                             gdouble        dfdt[6]);
+
+/*
+ * Fixed step methods for hard real-time loops. RK4 takes four evaluations
+ * of the equations per step, the semi-implicit Euler one: the speed goes
+ * first and the axes move with the new speed.
+ */
+typedef enum {
+    D_DYNAMIC_FIXED_RK4 = 0,
+    D_DYNAMIC_FIXED_SEMI_IMPLICIT_EULER,
+    D_DYNAMIC_N_FIXED_METHODS
+} DDynamicFixedMethod;
+
+/*
+ * Advances state y, as in d_dynamic_model_evaluate, by one step of length
+ * h. There is no step control, allocation, logging nor GError on the way,
+ * the cost of a step is bounded by its evaluations. On failure y is left
+ * as it was and the status of the failed evaluation returned.
+ */
+int             d_dynamic_model_step_fixed  (DDynamicModel  *self,
+                                             DDynamicFixedMethod method,
+                                             gdouble        h,
+                                             gdouble        y[6]);
+
+/*
+ * Inverse dynamics over n samples of a trajectory: the torques the motors
+ * must give to follow axes, speed and accel, 3 doubles per sample each,
+ * under the force and gravity of the model. The servo is left out, torque
+ * is all the motors give. Samples out of the working space or singular
+ * get NaN. Trajectories longer than a chunk are split over n_threads
+ * threads, or one per processor when n_threads is 0 or less: the calling
+ * thread and threads of a pool shared by every call, kept between calls.
+ * Returns the number of samples solved.
+ */
+gsize           d_dynamic_model_inverse_dynamics_batch
+                                            (DDynamicModel  *self,
+                                             gsize          n,
+                                             const gdouble  *axes,
+                                             const gdouble  *speed,
+                                             const gdouble  *accel,
+                                             gdouble        *torque,
+                                             gint           n_threads);
+
 #endif   /* ----- #ifndef DSIM_DYNAMICS_INC  ----- */
@@ -23,6 +23,7 @@
  */
 
 #include "dsim_geometry.h"
+#include <math.h>
 
 /* GType Register */
 G_DEFINE_TYPE(DGeometry, d_geometry, G_TYPE_OBJECT);
@@ -53,6 +54,23 @@ d_geometry_class_init ( DGeometryClass *klass )
     gobject_class->finalize = d_geometry_finalize;
 }
 
+static void
+d_geometry_update_constants (DGeometry  *self)
+{
+    DGeometryConstants *k = &self->derived;
+
+    for (int i = 0; i < 3; i++) {
+        gdouble phi = ((gdouble) i) * G_PI * 2.0 / 3.0;
+        k->cos_phi[i] = cos(phi);
+        k->sin_phi[i] = sin(phi);
+    }
+    k->a2 = self->a * self->a;
+    k->b2 = self->b * self->b;
+    k->h_r = self->h - self->r;
+    k->four_a2 = 4.0 * k->a2;
+    k->a2_b2 = k->a2 - k->b2;
+}
+
 /* Public API */
 DGeometry*
 d_geometry_new (gdouble a,
@@ -65,6 +83,7 @@ d_geometry_new (gdouble a,
     g->b = b;
     g->h = h;
     g->r = r;
+    d_geometry_update_constants(g);
     return g;
 }
 
@@ -79,4 +98,211 @@ d_geometry_reconfigure (DGeometry   *self,
     self->b = b;
     self->h = h;
     self->r = r;
+    d_geometry_update_constants(self);
+}
+
+/* Classifies a point against the torus of arm i alone */
+static inline DGeometryReach
+d_geometry_classify_arm (const DGeometryConstants   *k,
+                         int                        i,
+                         gdouble                    x,
+                         gdouble                    y,
+                         gdouble                    z)
+{
+    /* Point Ci in the frame of arm i */
+    gdouble cx = x * k->cos_phi[i] + y * k->sin_phi[i] + k->h_r;
+    gdouble cy = y * k->cos_phi[i] - x * k->sin_phi[i];
+    gdouble rho2 = cx * cx + z * z;
+
+    /*
+     * Both torus inequalities at once, without square roots:
+     * |rho^2 + y^2 + a^2 - b^2| <= 2 a rho
+     */
+    gdouble u = rho2 + cy * cy + k->a2_b2;
+    gdouble s = k->four_a2 * rho2;
+    gdouble d = s - u * u;
+    gdouble band = D_GEOMETRY_REACH_MARGIN * (s + u * u);
+
+    if (d < -band || isnan(d)) {
+        return D_GEOMETRY_REACH_OUTSIDE;
+    }
+    if (d <= band) {
+        return D_GEOMETRY_REACH_BOUNDARY;
+    }
+    return D_GEOMETRY_REACH_INSIDE;
+}
+
+DGeometryReach
+d_geometry_classify_point (DGeometry    *self,
+                           gdouble      x,
+                           gdouble      y,
+                           gdouble      z)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(self), D_GEOMETRY_REACH_BOUNDARY);
+
+    DGeometryReach reach = D_GEOMETRY_REACH_INSIDE;
+    for (int i = 0; i < 3; i++) {
+        DGeometryReach arm = d_geometry_classify_arm(&self->derived, i, x, y, z);
+        if (arm == D_GEOMETRY_REACH_OUTSIDE) {
+            return D_GEOMETRY_REACH_OUTSIDE;
+        }
+        if (arm == D_GEOMETRY_REACH_BOUNDARY) {
+            reach = D_GEOMETRY_REACH_BOUNDARY;
+        }
+    }
+    return reach;
+}
+
+DGeometryReach
+d_geometry_classify_point_first (DGeometry      *self,
+                                 gdouble        x,
+                                 gdouble        y,
+                                 gdouble        z,
+                                 gint           *arm)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(self), D_GEOMETRY_REACH_BOUNDARY);
+    g_return_val_if_fail(arm != NULL, D_GEOMETRY_REACH_BOUNDARY);
+
+    for (int i = 0; i < 3; i++) {
+        DGeometryReach reach = d_geometry_classify_arm(&self->derived, i, x, y, z);
+        if (reach != D_GEOMETRY_REACH_INSIDE) {
+            *arm = i;
+            return reach;
+        }
+    }
+    *arm = -1;
+    return D_GEOMETRY_REACH_INSIDE;
+}
+
+/* Bounds of u * c + v * s over u in [u0, u1] and v in [v0, v1] */
+static inline void
+d_geometry_linear_bounds (gdouble   u0,
+                          gdouble   u1,
+                          gdouble   c,
+                          gdouble   v0,
+                          gdouble   v1,
+                          gdouble   s,
+                          gdouble   *lo,
+                          gdouble   *hi)
+{
+    *lo = MIN(u0 * c, u1 * c) + MIN(v0 * s, v1 * s);
+    *hi = MAX(u0 * c, u1 * c) + MAX(v0 * s, v1 * s);
+}
+
+/* Bounds of v^2 over v in [lo, hi] */
+static inline void
+d_geometry_square_bounds (gdouble   lo,
+                          gdouble   hi,
+                          gdouble   *sq_lo,
+                          gdouble   *sq_hi)
+{
+    if (lo <= 0.0 && hi >= 0.0) {
+        *sq_lo = 0.0;
+    } else {
+        *sq_lo = MIN(lo * lo, hi * hi);
+    }
+    *sq_hi = MAX(lo * lo, hi * hi);
+}
+
+DGeometryReach
+d_geometry_classify_box (DGeometry      *self,
+                         const gdouble  lo[3],
+                         const gdouble  hi[3])
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(self), D_GEOMETRY_REACH_BOUNDARY);
+
+    const DGeometryConstants *k = &self->derived;
+    const gdouble a = self->a;
+    const gdouble band = D_GEOMETRY_REACH_MARGIN * k->b2;
+    DGeometryReach reach = D_GEOMETRY_REACH_INSIDE;
+
+    gdouble z2_lo, z2_hi;
+    d_geometry_square_bounds(lo[2], hi[2], &z2_lo, &z2_hi);
+
+    for (int i = 0; i < 3; i++) {
+        /* Point Ci in the frame of arm i, coordinates bounded separately */
+        gdouble cx_lo, cx_hi, cy_lo, cy_hi;
+        d_geometry_linear_bounds(lo[0], hi[0], k->cos_phi[i],
+                                 lo[1], hi[1], k->sin_phi[i],
+                                 &cx_lo, &cx_hi);
+        cx_lo += k->h_r;
+        cx_hi += k->h_r;
+        d_geometry_linear_bounds(lo[1], hi[1], k->cos_phi[i],
+                                 lo[0], hi[0], -k->sin_phi[i],
+                                 &cy_lo, &cy_hi);
+
+        gdouble cx2_lo, cx2_hi, cy2_lo, cy2_hi;
+        d_geometry_square_bounds(cx_lo, cx_hi, &cx2_lo, &cx2_hi);
+        d_geometry_square_bounds(cy_lo, cy_hi, &cy2_lo, &cy2_hi);
+        gdouble rho_lo = sqrt(cx2_lo + z2_lo);
+        gdouble rho_hi = sqrt(cx2_hi + z2_hi);
+
+        /*
+         * Squared distance from Ci to the nearest and to the farthest point
+         * of the near arm circle, (rho -+ a)^2 + y^2. The arm reaches Ci
+         * when b^2 lies between them.
+         */
+        gdouble near_lo, near_hi;
+        d_geometry_square_bounds(rho_lo - a, rho_hi - a, &near_lo, &near_hi);
+        near_lo += cy2_lo;
+        near_hi += cy2_hi;
+        gdouble far_lo = (rho_lo + a) * (rho_lo + a) + cy2_lo;
+        gdouble far_hi = (rho_hi + a) * (rho_hi + a) + cy2_hi;
+
+        if (near_lo > k->b2 + band || far_hi < k->b2 - band
+            || isnan(near_lo) || isnan(far_hi)) {
+            return D_GEOMETRY_REACH_OUTSIDE;
+        }
+        if (!(near_hi < k->b2 - band && far_lo > k->b2 + band)) {
+            reach = D_GEOMETRY_REACH_BOUNDARY;
+        }
+    }
+    return reach;
+}
+
+static gsize
+d_geometry_refine_box_real (DGeometry           *self,
+                            const gdouble       lo[3],
+                            const gdouble       hi[3],
+                            guint               depth,
+                            DGeometryBoxFunc    func,
+                            gpointer            user_data)
+{
+    DGeometryReach reach = d_geometry_classify_box(self, lo, hi);
+    if (reach != D_GEOMETRY_REACH_BOUNDARY || depth == 0) {
+        func(lo, hi, reach, user_data);
+        return 1;
+    }
+
+    gsize n_boxes = 1;
+    gdouble mid[3];
+    for (int j = 0; j < 3; j++) {
+        mid[j] = 0.5 * (lo[j] + hi[j]);
+    }
+    for (int octant = 0; octant < 8; octant++) {
+        gdouble child_lo[3], child_hi[3];
+        for (int j = 0; j < 3; j++) {
+            gboolean upper = (octant >> j) & 1;
+            child_lo[j] = upper ? mid[j] : lo[j];
+            child_hi[j] = upper ? hi[j] : mid[j];
+        }
+        n_boxes += d_geometry_refine_box_real(self, child_lo, child_hi,
+                                              depth - 1, func, user_data);
+    }
+    return n_boxes;
+}
+
+gsize
+d_geometry_refine_box (DGeometry        *self,
+                       const gdouble    lo[3],
+                       const gdouble    hi[3],
+                       guint            max_depth,
+                       DGeometryBoxFunc func,
+                       gpointer         user_data)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(self), 0);
+    g_return_val_if_fail(func != NULL, 0);
+
+    return d_geometry_refine_box_real(self, lo, hi, max_depth,
+                                      func, user_data);
 }
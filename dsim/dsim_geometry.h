@@ -36,6 +36,39 @@
 #define D_IS_GEOMETRY_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), D_TYPE_GEOMETRY))
 #define D_GEOMETRY_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), D_TYPE_GEOMETRY, DGeometryClass))
 
+/*
+ * Constants derived from the geometry parameters. They are kept up to date
+ * by d_geometry_new and d_geometry_reconfigure so the kinematic and dynamic
+ * solvers don't recompute them on every call.
+ */
+typedef struct _DGeometryConstants DGeometryConstants;
+struct _DGeometryConstants {
+    /* Rotation of each arm around the vertical axis (0, 120 and 240 deg) */
+    gdouble         cos_phi[3];
+    gdouble         sin_phi[3];
+
+    /* Squared arm lengths */
+    gdouble         a2;
+    gdouble         b2;
+
+    /* Offset between platform joints and fixed joints */
+    gdouble         h_r;            /* h - r */
+
+    /* Reachability envelope, see d_geometry_classify_point */
+    gdouble         four_a2;        /* 4 a^2 */
+    gdouble         a2_b2;          /* a^2 - b^2 */
+};
+
+/* Result of the analytic working space test */
+typedef enum {
+    D_GEOMETRY_REACH_INSIDE,        /* Surely reachable */
+    D_GEOMETRY_REACH_OUTSIDE,       /* Surely unreachable */
+    D_GEOMETRY_REACH_BOUNDARY       /* Too close to call, solve it fully */
+} DGeometryReach;
+
+/* Relative band around the working space boundary classified as BOUNDARY */
+#define D_GEOMETRY_REACH_MARGIN     1e-9
+
 /* Instance Structure of DGeometry */
 typedef struct _DGeometry DGeometry;
 struct _DGeometry {
@@ -45,6 +78,9 @@ struct _DGeometry {
     gdouble         b;
     gdouble         h;
     gdouble         r;
+
+    /* Read only, use d_geometry_reconfigure to change the parameters */
+    DGeometryConstants  derived;
 };
 
 /* Class Structure of DGeometry */
@@ -68,4 +104,65 @@ void        d_geometry_reconfigure  (DGeometry  *self,
                                      gdouble    h,
                                      gdouble    r);
 
+/*
+ * Classifies a cartesian point against the working space without solving
+ * the inverse problem. Arm i reaches a point when its joint Ci is at
+ * distance b from the circle of radius a swept by the near arm, that is
+ * (rho - a)^2 + y^2 <= b^2 <= (rho + a)^2 + y^2 in the arm frame, with
+ * rho^2 = x^2 + z^2. The working space is the intersection of the three
+ * tori. The test costs a few products per arm and no trigonometry.
+ * BOUNDARY is returned within D_GEOMETRY_REACH_MARGIN of the envelope,
+ * where rounding could make the solvers disagree.
+ */
+DGeometryReach  d_geometry_classify_point
+                                    (DGeometry  *self,
+                                     gdouble    x,
+                                     gdouble    y,
+                                     gdouble    z);
+
+/*
+ * Same test arm by arm, stopping at the first arm whose torus doesn't
+ * surely hold the point. Returns its class, OUTSIDE or BOUNDARY, with the
+ * arm index in arm, or INSIDE with arm set to -1. For callers that need to
+ * know which arm rules a point out, like the inverse solvers.
+ */
+DGeometryReach  d_geometry_classify_point_first
+                                    (DGeometry      *self,
+                                     gdouble        x,
+                                     gdouble        y,
+                                     gdouble        z,
+                                     gint           *arm);
+
+/*
+ * Classifies the axis aligned box [lo, hi] as a whole. The torus test of
+ * d_geometry_classify_point is evaluated with interval arithmetic: the
+ * arm frame coordinates are bounded over the box and so are the nearest
+ * and farthest distances from Ci to the near arm circle. The answer is
+ * conservative, INSIDE and OUTSIDE hold for every point in the box while
+ * BOUNDARY means the box is mixed or the bounds were too loose to tell.
+ */
+DGeometryReach  d_geometry_classify_box
+                                    (DGeometry      *self,
+                                     const gdouble  lo[3],
+                                     const gdouble  hi[3]);
+
+/* Called for every leaf box found by d_geometry_refine_box */
+typedef void (*DGeometryBoxFunc)    (const gdouble  lo[3],
+                                     const gdouble  hi[3],
+                                     DGeometryReach reach,
+                                     gpointer       user_data);
+
+/*
+ * Octree refinement of the box [lo, hi]. Boxes classified INSIDE or
+ * OUTSIDE are handed to func as they are, BOUNDARY boxes are split in
+ * eight until max_depth is reached, where the remaining BOUNDARY boxes are
+ * reported. Returns the number of boxes classified.
+ */
+gsize       d_geometry_refine_box   (DGeometry          *self,
+                                     const gdouble      lo[3],
+                                     const gdouble      hi[3],
+                                     guint              max_depth,
+                                     DGeometryBoxFunc   func,
+                                     gpointer           user_data);
+
 #endif   /* ----- #ifndef DSIM_GEOMETRY_INC  ----- */
@@ -19,8 +19,8 @@
  */
 
 #include "dsim_jacobian.h"
-#include <gsl/gsl_blas.h>
-#include <gsl/gsl_linalg.h>
+#include "dsim_vec3.h"
+#include "dsim_solver_kernel.h"
 
 /* Static Methods */
 void
@@ -29,17 +29,13 @@ d_jacobian_direct (gsl_matrix   *direct,
                    gsl_matrix   *ext_axes)
 {
     for (int i = 0; i < direct->size1; i++) {
-        gdouble phi = i * G_PI * 120.0 / 180.0;
         gdouble t[] = {
             gsl_matrix_get(ext_axes, i, 0),
             gsl_matrix_get(ext_axes, i, 1),
             gsl_matrix_get(ext_axes, i, 2)
         };
-        gdouble j[] = {
-            cos(t[0] + t[1]) * sin(t[2]) * cos(phi) - cos(t[2]) * sin(phi),
-            cos(t[0] + t[1]) * sin(t[2]) * sin(phi) + cos(t[2]) * cos(phi),
-            sin(t[0] + t[1]) * sin(t[2])
-        };
+        gdouble j[3];
+        d_jacobian_direct_row(geometry, i, t, j);
         for (int k = 0; k < direct->size2; k++) {
             gsl_matrix_set(direct, i, k, j[k]);
         }
@@ -59,8 +55,7 @@ d_jacobian_inverse (gsl_matrix   *inverse,
         };
         for (int k = 0; k < inverse->size2; k++) {
             if (i == k) {
-                gdouble j = sin(t[1]) * sin (t[2]);
-                gsl_matrix_set(inverse, i, k, j);
+                gsl_matrix_set(inverse, i, k, d_jacobian_inverse_diag(t));
             } else {
                 gsl_matrix_set(inverse, i, k, 0.0);
             }
@@ -68,60 +63,330 @@ d_jacobian_inverse (gsl_matrix   *inverse,
     }
 }
 
+/*
+ * Conventional jacobian of an extended axes block. The inverse jacobian is
+ * diagonal, so multiplying by its inverse is scaling each row of the
+ * direct jacobian. Returns FALSE on singular poses, jacobian is then non
+ * finite.
+ */
+static gboolean
+d_jacobian_conventional_block (DGeometry        *geometry,
+                               const gdouble    ext[3][3],
+                               gdouble          jacobian[3][3])
+{
+    for (int i = 0; i < 3; i++) {
+        gdouble d = d_jacobian_inverse_diag(ext[i]);
+        if (d == 0.0) {
+            for (int k = 0; k < 9; k++) {
+                jacobian[k / 3][k % 3] = GSL_POSINF;
+            }
+            return FALSE;
+        }
+        d_jacobian_direct_row(geometry, i, ext[i], jacobian[i]);
+        for (int k = 0; k < 3; k++) {
+            jacobian[i][k] /= d;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Ratio of the smallest to the largest singular value of a conventional
+ * jacobian. They are the square roots of the eigenvalues of J J^T, whose
+ * closed form loses the smallest one to cancellation near singularities,
+ * so it is taken from the determinant instead:
+ * s_min / s_max = |det J| / (s_max^2 s_mid).
+ */
+static gdouble
+d_jacobian_dexterity_of (const DMat3    *jacobian,
+                         gdouble        det)
+{
+    DMat3 jjt = d_mat3_mul_t(jacobian, jacobian);
+    DVec3 eig = d_mat3_sym_eigenvalues(&jjt);
+    if (!(eig.v[0] > 0.0 && eig.v[1] > 0.0)) {
+        return 0.0;
+    }
+    gdouble ratio = fabs(det) / (eig.v[0] * sqrt(eig.v[1]));
+    return MIN(ratio, sqrt(eig.v[1] / eig.v[0]));
+}
+
+static gdouble
+d_jacobian_dexterity_block (DGeometry       *geometry,
+                            const gdouble   ext[3][3])
+{
+    DMat3 jacobian;
+    if (!d_jacobian_conventional_block(geometry, ext, jacobian.m)) {
+        /* Singular pose */
+        return 0.0;
+    }
+    return d_jacobian_dexterity_of(&jacobian, d_mat3_det(&jacobian));
+}
+
 void
 d_jacobian_conventional (gsl_matrix     *jacobian,
                          DGeometry      *geometry,
                          gsl_matrix     *ext_axes)
 {
-    gsl_matrix *inverse = gsl_matrix_calloc(3,3);
-    gsl_matrix *direct = gsl_matrix_calloc(3,3);
+    DMat3 ext = d_mat3_from_gsl(ext_axes);
+    DMat3 conventional;
+    d_jacobian_conventional_block(geometry, (const gdouble (*)[3]) ext.m,
+                                  conventional.m);
+    d_mat3_to_gsl(&conventional, jacobian);
+}
 
-    d_jacobian_inverse(inverse, geometry, ext_axes);
-    d_jacobian_direct(direct, geometry, ext_axes);
+gdouble
+d_jacobian_dexterity (DGeometry    *geometry,
+                      gsl_matrix   *ext_axes)
+{
+    DMat3 ext = d_mat3_from_gsl(ext_axes);
+    return d_jacobian_dexterity_block(geometry, (const gdouble (*)[3]) ext.m);
+}
 
-    /* invert inverse jacobian */
-    gint s = 0;
-    gsl_permutation *p = gsl_permutation_alloc(3);
-    gsl_matrix *inverse_inv = gsl_matrix_calloc (3,3);
-    gsl_linalg_LU_decomp (inverse, p, &s);
-    gsl_linalg_LU_invert (inverse, p, inverse_inv);
+void
+d_jacobian_conventional_batch (DGeometry        *geometry,
+                               gsize            n,
+                               const gdouble    *extaxes,
+                               gdouble          *jacobians)
+{
+    g_return_if_fail(D_IS_GEOMETRY(geometry));
 
-    /* compute J_q * J_x */
-    gsl_blas_dgemm(CblasNoTrans, CblasNoTrans, 1.0, inverse_inv, direct, 0.0, jacobian);
+    for (gsize k = 0; k < n; k++) {
+        d_jacobian_conventional_block(geometry,
+                                      (const gdouble (*)[3]) (extaxes + 9 * k),
+                                      (gdouble (*)[3]) (jacobians + 9 * k));
+    }
+}
 
-    gsl_matrix_free(inverse_inv);
-    gsl_matrix_free(inverse);
-    gsl_matrix_free(direct);
-    gsl_permutation_free(p);
+void
+d_jacobian_dexterity_batch (DGeometry       *geometry,
+                            gsize           n,
+                            const gdouble   *extaxes,
+                            gdouble         *dexterity)
+{
+    g_return_if_fail(D_IS_GEOMETRY(geometry));
+
+    for (gsize k = 0; k < n; k++) {
+        dexterity[k] = d_jacobian_dexterity_block(geometry,
+                                                  (const gdouble (*)[3]) (extaxes + 9 * k));
+    }
 }
 
-gdouble
-d_jacobian_dexterity (DGeometry    *geometry,
-                      gsl_matrix   *ext_axes)
+void
+d_jacobian_measures_batch (DGeometry        *geometry,
+                           gsize            n,
+                           const gdouble    *extaxes,
+                           gdouble          *dexterity,
+                           gdouble          *manipulability,
+                           gdouble          *determinant)
 {
-    gsl_matrix *jacobian = gsl_matrix_calloc(3,3);
+    g_return_if_fail(D_IS_GEOMETRY(geometry));
 
-    d_jacobian_conventional (jacobian, geometry, ext_axes);
+    for (gsize k = 0; k < n; k++) {
+        DMat3 jacobian;
+        gdouble dex = 0.0;
+        gdouble det = GSL_POSINF;
+        if (d_jacobian_conventional_block(geometry,
+                                          (const gdouble (*)[3]) (extaxes + 9 * k),
+                                          jacobian.m)) {
+            det = d_mat3_det(&jacobian);
+            dex = d_jacobian_dexterity_of(&jacobian, det);
+        }
+        if (dexterity) {
+            dexterity[k] = dex;
+        }
+        if (manipulability) {
+            manipulability[k] = fabs(det);
+        }
+        if (determinant) {
+            determinant[k] = det;
+        }
+    }
+}
 
-    /* SVD of jacobian matrix */
-    gsl_matrix *v_mat = gsl_matrix_calloc (3,3);
-    gsl_vector *w = gsl_vector_calloc (3);
-    gsl_vector *s = gsl_vector_calloc (3);
-    gsl_linalg_SV_decomp (jacobian, v_mat, s, w);
+/*
+ * Unit rows of the direct jacobian and the diagonal a sin(t2) sin(t3) that
+ * relates them to motor speeds: rows v = diag w.
+ */
+static void
+d_jacobian_transmission_block (DGeometry        *geometry,
+                               const gdouble    ext[3][3],
+                               DMat3            *rows,
+                               DVec3            *diag)
+{
+    for (int i = 0; i < 3; i++) {
+        d_jacobian_direct_row(geometry, i, ext[i], rows->m[i]);
+        diag->v[i] = geometry->a * d_jacobian_inverse_diag(ext[i]);
+    }
+}
+
+static inline void
+d_jacobian_transmission_store (gdouble  *out,
+                               DVec3    v)
+{
+    if (out) {
+        out[0] = v.v[0];
+        out[1] = v.v[1];
+        out[2] = v.v[2];
+    }
+}
+
+gsize
+d_jacobian_transmission_direct_batch (DGeometry         *geometry,
+                                      gsize             n,
+                                      const gdouble     *extaxes,
+                                      const gdouble     *axes_speed,
+                                      gdouble           *pos_speed,
+                                      const gdouble     *force,
+                                      gdouble           *torque)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail((axes_speed == NULL) == (pos_speed == NULL), 0);
+    g_return_val_if_fail((force == NULL) == (torque == NULL), 0);
+
+    const DVec3 nan = d_vec3(GSL_NAN, GSL_NAN, GSL_NAN);
+    gsize mapped = 0;
+    for (gsize k = 0; k < n; k++) {
+        DMat3 rows;
+        DMat3 inv;
+        DVec3 diag;
+        d_jacobian_transmission_block(geometry,
+                                      (const gdouble (*)[3]) (extaxes + 9 * k),
+                                      &rows, &diag);
+        if (!d_mat3_inverse(&rows, &inv)) {
+            /* Direct singularity */
+            d_jacobian_transmission_store(pos_speed ? pos_speed + 3 * k : NULL, nan);
+            d_jacobian_transmission_store(torque ? torque + 3 * k : NULL, nan);
+            continue;
+        }
+
+        /* v = rows^-1 diag w */
+        if (axes_speed) {
+            const gdouble *w = axes_speed + 3 * k;
+            DVec3 dw = d_vec3(diag.v[0] * w[0], diag.v[1] * w[1], diag.v[2] * w[2]);
+            d_jacobian_transmission_store(pos_speed + 3 * k, d_mat3_mul_vec(&inv, dw));
+        }
+        /* t = diag rows^-T f */
+        if (force) {
+            const gdouble *f = force + 3 * k;
+            DVec3 t = d_mat3_t_mul_vec(&inv, d_vec3(f[0], f[1], f[2]));
+            for (int i = 0; i < 3; i++) {
+                t.v[i] *= diag.v[i];
+            }
+            d_jacobian_transmission_store(torque + 3 * k, t);
+        }
+        mapped++;
+    }
+    return mapped;
+}
+
+gsize
+d_jacobian_transmission_inverse_batch (DGeometry        *geometry,
+                                       gsize            n,
+                                       const gdouble    *extaxes,
+                                       const gdouble    *pos_speed,
+                                       gdouble          *axes_speed,
+                                       const gdouble    *torque,
+                                       gdouble          *force)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail((pos_speed == NULL) == (axes_speed == NULL), 0);
+    g_return_val_if_fail((torque == NULL) == (force == NULL), 0);
+
+    const DVec3 nan = d_vec3(GSL_NAN, GSL_NAN, GSL_NAN);
+    gsize mapped = 0;
+    for (gsize k = 0; k < n; k++) {
+        DMat3 rows;
+        DVec3 diag;
+        d_jacobian_transmission_block(geometry,
+                                      (const gdouble (*)[3]) (extaxes + 9 * k),
+                                      &rows, &diag);
+        if (diag.v[0] == 0.0 || diag.v[1] == 0.0 || diag.v[2] == 0.0) {
+            /* Inverse singularity */
+            d_jacobian_transmission_store(axes_speed ? axes_speed + 3 * k : NULL, nan);
+            d_jacobian_transmission_store(force ? force + 3 * k : NULL, nan);
+            continue;
+        }
 
-    gdouble ret_val = 0;
-    /* Avoid dividing by zero */
-    if (gsl_fcmp (gsl_vector_get(s, 0), 0.0, FLT_EPSILON) == 0) {
-        ret_val = 0.0;
-    } else {
-        ret_val = gsl_vector_get(s, 2) / gsl_vector_get (s, 0);
+        /* w = diag^-1 rows v */
+        if (pos_speed) {
+            const gdouble *v = pos_speed + 3 * k;
+            DVec3 w = d_mat3_mul_vec(&rows, d_vec3(v[0], v[1], v[2]));
+            for (int i = 0; i < 3; i++) {
+                w.v[i] /= diag.v[i];
+            }
+            d_jacobian_transmission_store(axes_speed + 3 * k, w);
+        }
+        /* f = rows^T diag^-1 t */
+        if (torque) {
+            const gdouble *t = torque + 3 * k;
+            DVec3 dt = d_vec3(t[0] / diag.v[0], t[1] / diag.v[1], t[2] / diag.v[2]);
+            d_jacobian_transmission_store(force + 3 * k, d_mat3_t_mul_vec(&rows, dt));
+        }
+        mapped++;
     }
+    return mapped;
+}
+
+/* Single precision variants */
+void
+d_jacobian_direct_float (gsl_matrix_float   *direct,
+                         DGeometry          *geometry,
+                         gsl_matrix_float   *ext_axes)
+{
+    for (int i = 0; i < 3; i++) {
+        gfloat t[] = {
+            gsl_matrix_float_get(ext_axes, i, 0),
+            gsl_matrix_float_get(ext_axes, i, 1),
+            gsl_matrix_float_get(ext_axes, i, 2)
+        };
+        gfloat j[3];
+        d_jacobian_direct_row_float(geometry, i, t, j);
+        for (int k = 0; k < 3; k++) {
+            gsl_matrix_float_set(direct, i, k, j[k]);
+        }
+    }
+}
 
-    /* Cleanup */
-    gsl_vector_free(s);
-    gsl_vector_free(w);
-    gsl_matrix_free(jacobian);
-    gsl_matrix_free(v_mat);
+void
+d_jacobian_inverse_float (gsl_matrix_float  *inverse,
+                          DGeometry         *geometry,
+                          gsl_matrix_float  *ext_axes)
+{
+    gsl_matrix_float_set_all(inverse, 0.0f);
+    for (int i = 0; i < 3; i++) {
+        gfloat t[] = {
+            gsl_matrix_float_get(ext_axes, i, 0),
+            gsl_matrix_float_get(ext_axes, i, 1),
+            gsl_matrix_float_get(ext_axes, i, 2)
+        };
+        gsl_matrix_float_set(inverse, i, i, d_jacobian_inverse_diag_float(t));
+    }
+}
 
-    return ret_val;
+void
+d_jacobian_conventional_float (gsl_matrix_float *jacobian,
+                               DGeometry        *geometry,
+                               gsl_matrix_float *ext_axes)
+{
+    /*
+     * The inverse jacobian is diagonal, so multiplying by its inverse is
+     * scaling each row of the direct jacobian.
+     */
+    for (int i = 0; i < 3; i++) {
+        gfloat t[] = {
+            gsl_matrix_float_get(ext_axes, i, 0),
+            gsl_matrix_float_get(ext_axes, i, 1),
+            gsl_matrix_float_get(ext_axes, i, 2)
+        };
+        gfloat d = d_jacobian_inverse_diag_float(t);
+        if (d == 0.0f) {
+            gsl_matrix_float_set_all(jacobian, GSL_POSINF);
+            return;
+        }
+        gfloat j[3];
+        d_jacobian_direct_row_float(geometry, i, t, j);
+        for (int k = 0; k < 3; k++) {
+            gsl_matrix_float_set(jacobian, i, k, j[k] / d);
+        }
+    }
 }
@@ -29,7 +29,7 @@
 #include <glib.h>
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_vector.h>
-#include <dsim_geometry.h>
+#include <dsim/dsim_geometry.h>
 
 /* Static Methods */
 void    d_jacobian_direct (gsl_matrix   *direct,
@@ -44,8 +44,84 @@ void    d_jacobian_conventional (gsl_matrix     *jacobian,
                                  DGeometry      *geometry,
                                  gsl_matrix     *ext_axes);
 
+/*
+ * Ratio of the smallest to the largest singular value of the conventional
+ * jacobian, 0 on singular poses. Computed in closed form, nothing is
+ * allocated. It agrees with an SVD to about 1e-10, the worst case being
+ * poses where the two largest singular values nearly coincide.
+ */
 gdouble d_jacobian_dexterity (DGeometry     *geometry,
                               gsl_matrix    *ext_axes);
 
+/*
+ * Batch variants over n extended axes blocks of 9 doubles in the layout of
+ * d_solver_solve_inverse_batch. jacobians receives 9 doubles per pose.
+ */
+void    d_jacobian_conventional_batch (DGeometry        *geometry,
+                                       gsize            n,
+                                       const gdouble    *extaxes,
+                                       gdouble          *jacobians);
+
+void    d_jacobian_dexterity_batch (DGeometry       *geometry,
+                                    gsize           n,
+                                    const gdouble   *extaxes,
+                                    gdouble         *dexterity);
+
+/*
+ * Dexterity, manipulability sqrt(det(J J^T)) and determinant of the
+ * conventional jacobian of each pose in one pass. The jacobian is square,
+ * so manipulability is |det J|. Singular poses give a dexterity of 0 and
+ * an infinite determinant. Any output may be NULL.
+ */
+void    d_jacobian_measures_batch (DGeometry        *geometry,
+                                   gsize            n,
+                                   const gdouble    *extaxes,
+                                   gdouble          *dexterity,
+                                   gdouble          *manipulability,
+                                   gdouble          *determinant);
+
+/*
+ * Velocity and force transmission over n poses, extended axes blocks as
+ * above and 3 doubles per pose for every vector. Motor speeds w and tcp
+ * speeds v are related by a w = J v, J being the conventional jacobian,
+ * and by virtual work motor torques t and tcp forces f by f = J^T t / a.
+ *
+ * The direct variant maps axes_speed to pos_speed and force to torque.
+ * Both need the direct jacobian inverted, which is done once per pose
+ * whatever the outputs asked. The inverse variant maps pos_speed to
+ * axes_speed and torque to force, with no inversion at all.
+ *
+ * Either pair may be NULL. Outputs of singular poses are set to NaN.
+ * Returns the number of poses mapped.
+ */
+gsize   d_jacobian_transmission_direct_batch (DGeometry         *geometry,
+                                              gsize             n,
+                                              const gdouble     *extaxes,
+                                              const gdouble     *axes_speed,
+                                              gdouble           *pos_speed,
+                                              const gdouble     *force,
+                                              gdouble           *torque);
+
+gsize   d_jacobian_transmission_inverse_batch (DGeometry        *geometry,
+                                               gsize            n,
+                                               const gdouble    *extaxes,
+                                               const gdouble    *pos_speed,
+                                               gdouble          *axes_speed,
+                                               const gdouble    *torque,
+                                               gdouble          *force);
+
+/* Single precision variants, same layout as above */
+void    d_jacobian_direct_float (gsl_matrix_float   *direct,
+                                 DGeometry          *geometry,
+                                 gsl_matrix_float   *ext_axes);
+
+void    d_jacobian_inverse_float (gsl_matrix_float  *inverse,
+                                  DGeometry         *geometry,
+                                  gsl_matrix_float  *ext_axes);
+
+void    d_jacobian_conventional_float (gsl_matrix_float *jacobian,
+                                       DGeometry        *geometry,
+                                       gsl_matrix_float *ext_axes);
+
 #endif   /* ----- #ifndef DSIM_JACOBIAN_INC  ----- */
 
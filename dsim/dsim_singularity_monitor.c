@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_singularity_monitor.c :
+ */
+
+#include "dsim_singularity_monitor.h"
+#include "dsim_vec3.h"
+#include "dsim_solver_kernel.h"
+
+/* GType Register */
+G_DEFINE_TYPE(DSingularityMonitor, d_singularity_monitor, G_TYPE_OBJECT);
+
+/* DSingularityMonitor implementation */
+static void
+d_singularity_monitor_init (DSingularityMonitor *self)
+{
+    self->geometry = NULL;
+    self->margin = D_SINGULARITY_MONITOR_MARGIN;
+    self->lookahead = D_SINGULARITY_MONITOR_LOOKAHEAD;
+    self->func = NULL;
+    self->func_data = NULL;
+    d_singularity_monitor_reset(self);
+}
+
+static void
+d_singularity_monitor_dispose (GObject *gobject)
+{
+    DSingularityMonitor *self = D_SINGULARITY_MONITOR(gobject);
+
+    if (self->geometry) {
+        g_object_unref(self->geometry);
+        self->geometry = NULL;
+    }
+
+    /* Chain Up */
+    G_OBJECT_CLASS(d_singularity_monitor_parent_class)->dispose(gobject);
+}
+
+static void
+d_singularity_monitor_finalize (GObject *gobject)
+{
+    /* Chain Up */
+    G_OBJECT_CLASS(d_singularity_monitor_parent_class)->finalize(gobject);
+}
+
+static void
+d_singularity_monitor_class_init (DSingularityMonitorClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    gobject_class->dispose = d_singularity_monitor_dispose;
+    gobject_class->finalize = d_singularity_monitor_finalize;
+}
+
+/* Public API */
+DSingularityMonitor*
+d_singularity_monitor_new (DGeometry    *geometry)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), NULL);
+
+    DSingularityMonitor *self = g_object_new(D_TYPE_SINGULARITY_MONITOR, NULL);
+    self->geometry = g_object_ref(geometry);
+    return self;
+}
+
+void
+d_singularity_monitor_reset (DSingularityMonitor    *self)
+{
+    g_return_if_fail(D_IS_SINGULARITY_MONITOR(self));
+
+    self->proximity.direct = 1.0;
+    self->proximity.inverse = 1.0;
+    self->proximity.determinant = 0.0;
+    self->last_closest = 1.0;
+    self->has_last = FALSE;
+    self->state = D_SINGULARITY_STATE_CLEAR;
+}
+
+void
+d_singularity_monitor_set_margin (DSingularityMonitor   *self,
+                                  gdouble               margin)
+{
+    g_return_if_fail(D_IS_SINGULARITY_MONITOR(self));
+    g_return_if_fail(margin >= 0.0 && margin < 1.0);
+
+    self->margin = margin;
+}
+
+void
+d_singularity_monitor_set_lookahead (DSingularityMonitor    *self,
+                                     guint                  ticks)
+{
+    g_return_if_fail(D_IS_SINGULARITY_MONITOR(self));
+
+    self->lookahead = ticks;
+}
+
+void
+d_singularity_monitor_set_func (DSingularityMonitor *self,
+                                DSingularityFunc    func,
+                                gpointer            data)
+{
+    g_return_if_fail(D_IS_SINGULARITY_MONITOR(self));
+
+    self->func = func;
+    self->func_data = data;
+}
+
+DSingularityState
+d_singularity_monitor_update (DSingularityMonitor   *self,
+                              const gdouble         extaxes[3][3])
+{
+    g_return_val_if_fail(D_IS_SINGULARITY_MONITOR(self), D_SINGULARITY_STATE_CLEAR);
+    g_return_val_if_fail(extaxes != NULL, D_SINGULARITY_STATE_CLEAR);
+
+    DMat3 direct;
+    gdouble inverse = G_MAXDOUBLE;
+    gdouble inverse_det = 1.0;
+
+    for (int i = 0; i < 3; i++) {
+        d_jacobian_direct_row(self->geometry, i, extaxes[i], direct.m[i]);
+        gdouble d = d_jacobian_inverse_diag(extaxes[i]);
+        inverse = MIN(inverse, fabs(d));
+        inverse_det *= d;
+    }
+    gdouble direct_det = d_mat3_det(&direct);
+
+    DSingularityProximity *p = &self->proximity;
+    p->direct = fabs(direct_det);
+    p->inverse = inverse;
+    p->determinant = inverse_det != 0.0 ? direct_det / inverse_det : GSL_POSINF;
+
+    gboolean closest_direct = p->direct <= p->inverse;
+    gdouble closest = closest_direct ? p->direct : p->inverse;
+
+    /* Linear extrapolation of the last change */
+    DSingularityState state = D_SINGULARITY_STATE_CLEAR;
+    if (closest <= self->margin) {
+        state = D_SINGULARITY_STATE_WITHIN_MARGIN;
+    } else if (self->has_last && closest < self->last_closest
+               && closest + (closest - self->last_closest) * self->lookahead
+                  <= self->margin) {
+        state = D_SINGULARITY_STATE_APPROACHING;
+    }
+    self->last_closest = closest;
+    self->has_last = TRUE;
+
+    if (state != self->state) {
+        self->state = state;
+        if (self->func) {
+            self->func(self, state, closest_direct, p, self->func_data);
+        }
+    }
+    return state;
+}
+
+DSingularityState
+d_singularity_monitor_update_gsl (DSingularityMonitor   *self,
+                                  gsl_matrix            *extaxes)
+{
+    g_return_val_if_fail(D_IS_SINGULARITY_MONITOR(self), D_SINGULARITY_STATE_CLEAR);
+    g_return_val_if_fail(extaxes != NULL, D_SINGULARITY_STATE_CLEAR);
+
+    DMat3 ext = d_mat3_from_gsl(extaxes);
+    return d_singularity_monitor_update(self, (const gdouble (*)[3]) ext.m);
+}
+
+void
+d_singularity_monitor_get_proximity (DSingularityMonitor    *self,
+                                     DSingularityProximity  *proximity)
+{
+    g_return_if_fail(D_IS_SINGULARITY_MONITOR(self));
+
+    *proximity = self->proximity;
+}
+
+DSingularityState
+d_singularity_monitor_get_state (DSingularityMonitor    *self)
+{
+    g_return_val_if_fail(D_IS_SINGULARITY_MONITOR(self), D_SINGULARITY_STATE_CLEAR);
+
+    return self->state;
+}
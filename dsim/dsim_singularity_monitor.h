@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_singularity_monitor.h : Tick by tick watch of the distance to the
+ *                              singular poses of the manipulator, calling
+ *                              back before the margin is reached.
+ */
+
+#ifndef  DSIM_SINGULARITY_MONITOR_INC
+#define  DSIM_SINGULARITY_MONITOR_INC
+
+#include <glib-object.h>
+#include <gsl/gsl_matrix.h>
+#include <dsim/dsim_geometry.h>
+
+/* Type macros */
+#define D_TYPE_SINGULARITY_MONITOR             (d_singularity_monitor_get_type ())
+#define D_SINGULARITY_MONITOR(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), D_TYPE_SINGULARITY_MONITOR, DSingularityMonitor))
+#define D_IS_SINGULARITY_MONITOR(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), D_TYPE_SINGULARITY_MONITOR))
+#define D_SINGULARITY_MONITOR_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), D_TYPE_SINGULARITY_MONITOR, DSingularityMonitorClass))
+#define D_IS_SINGULARITY_MONITOR_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), D_TYPE_SINGULARITY_MONITOR))
+#define D_SINGULARITY_MONITOR_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), D_TYPE_SINGULARITY_MONITOR, DSingularityMonitorClass))
+
+/*
+ * Proximity to each kind of singularity, 1 far from it and 0 on it.
+ *   direct:  |det Jx|, whose rows are the unit directions of the far arms.
+ *            Zero when they are coplanar and the platform gains a free
+ *            motion.
+ *   inverse: smallest |sin t2 sin t3| of the arms, the diagonal of Jq. Zero
+ *            when an arm is stretched or folded at the working space
+ *            boundary and the platform loses a motion.
+ * determinant is det J of the conventional jacobian, det Jx / det Jq.
+ */
+typedef struct _DSingularityProximity DSingularityProximity;
+struct _DSingularityProximity {
+    gdouble         direct;
+    gdouble         inverse;
+    gdouble         determinant;
+};
+
+typedef enum {
+    D_SINGULARITY_STATE_CLEAR = 0,      /* Above the margin */
+    D_SINGULARITY_STATE_APPROACHING,    /* Predicted to cross the margin
+                                           within the lookahead */
+    D_SINGULARITY_STATE_WITHIN_MARGIN   /* At or below the margin */
+} DSingularityState;
+
+typedef struct _DSingularityMonitor DSingularityMonitor;
+
+/*
+ * Called from d_singularity_monitor_update whenever the state changes,
+ * including back to clear. direct tells whether the direct proximity is
+ * the closer one.
+ */
+typedef void (*DSingularityFunc) (DSingularityMonitor           *monitor,
+                                  DSingularityState             state,
+                                  gboolean                      direct,
+                                  const DSingularityProximity   *proximity,
+                                  gpointer                      data);
+
+/* Default proximity margin and lookahead in ticks */
+#define D_SINGULARITY_MONITOR_MARGIN        0.1
+#define D_SINGULARITY_MONITOR_LOOKAHEAD     10
+
+/* Instance Structure of DSingularityMonitor */
+struct _DSingularityMonitor {
+    GObject         parent_instance;
+
+    DGeometry       *geometry;
+    gdouble         margin;
+    guint           lookahead;
+
+    DSingularityFunc    func;
+    gpointer            func_data;
+
+    /* Last update, the trend is taken from the previous one */
+    DSingularityProximity   proximity;
+    gdouble         last_closest;
+    gboolean        has_last;
+    DSingularityState   state;
+};
+
+/* Class Structure of DSingularityMonitor */
+typedef struct _DSingularityMonitorClass DSingularityMonitorClass;
+struct _DSingularityMonitorClass {
+    GObjectClass    parent_class;
+};
+
+/* Methods */
+GType           d_singularity_monitor_get_type  (void);
+
+DSingularityMonitor*
+                d_singularity_monitor_new       (DGeometry              *geometry);
+
+/* Forgets the trend and goes back to clear without calling back */
+void            d_singularity_monitor_reset     (DSingularityMonitor    *self);
+
+void            d_singularity_monitor_set_margin
+                                                (DSingularityMonitor    *self,
+                                                 gdouble                margin);
+
+void            d_singularity_monitor_set_lookahead
+                                                (DSingularityMonitor    *self,
+                                                 guint                  ticks);
+
+void            d_singularity_monitor_set_func  (DSingularityMonitor    *self,
+                                                 DSingularityFunc       func,
+                                                 gpointer               data);
+
+/*
+ * Feeds the extended axes of the current tick, as returned by the inverse
+ * solvers. The closer proximity is compared against the margin, and its
+ * change since the last tick is extrapolated lookahead ticks ahead.
+ * Costs the three direct jacobian rows and a determinant, nothing is
+ * allocated. Returns the new state.
+ */
+DSingularityState
+                d_singularity_monitor_update    (DSingularityMonitor    *self,
+                                                 const gdouble          extaxes[3][3]);
+
+DSingularityState
+                d_singularity_monitor_update_gsl
+                                                (DSingularityMonitor    *self,
+                                                 gsl_matrix             *extaxes);
+
+/* Proximity of the last update */
+void            d_singularity_monitor_get_proximity
+                                                (DSingularityMonitor    *self,
+                                                 DSingularityProximity  *proximity);
+
+DSingularityState
+                d_singularity_monitor_get_state (DSingularityMonitor    *self);
+
+#endif   /* ----- #ifndef DSIM_SINGULARITY_MONITOR_INC  ----- */
@@ -23,82 +23,128 @@
  */
 
 #include "dsim_solver.h"
+#include "dsim_solver_kernel.h"
+#include <string.h>
+
+/* Private Methods */
+/*
+ * Envelope test run before the inverse kernels, so unreachable targets
+ * cost no trigonometry. A target surely outside gets the status the kernel
+ * would give it: the first arm that can't reach it, by its cos3 or cos2
+ * condition. Returns D_SOLVER_STATUS_OK when the target has to be solved,
+ * that is inside, or next to the torus of an arm the kernel checks first.
+ */
+static DSolverStatus
+d_solver_inverse_reach (DGeometry   *geometry,
+                        gdouble     x,
+                        gdouble     y,
+                        gdouble     z)
+{
+    gint i;
+    if (d_geometry_classify_point_first(geometry, x, y, z, &i)
+            != D_GEOMETRY_REACH_OUTSIDE) {
+        return D_SOLVER_STATUS_OK;
+    }
+
+    /* The torus test of an arm is its cos2 test when |cos3| <= 1 */
+    gdouble cy = y * geometry->derived.cos_phi[i] - x * geometry->derived.sin_phi[i];
+    if (!(fabs(cy / geometry->b) <= 1.0)) {
+        return D_SOLVER_STATUS_INVALID_COS3;
+    }
+    return D_SOLVER_STATUS_INVALID_COS2;
+}
 
 /* Static Methods */
+const gchar*
+d_solver_status_to_string (DSolverStatus    status)
+{
+    switch (status) {
+        case D_SOLVER_STATUS_OK:
+            return "ok";
+        case D_SOLVER_STATUS_OUT_OF_WORKSPACE:
+            return "out of working space";
+        case D_SOLVER_STATUS_SINGULAR:
+            return "singular configuration";
+        case D_SOLVER_STATUS_INVALID_COS3:
+            return "out of far arm reach";
+        case D_SOLVER_STATUS_INVALID_COS2:
+            return "out of near arm reach";
+    }
+    return "unknown status";
+}
+
+DSolverStatus
+d_solver_solve_direct_status (DGeometry     *geometry,
+                              gsl_vector    *axes,
+                              gsl_vector    *pos)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(axes != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(pos != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+
+    gdouble t[] = {
+        gsl_vector_get(axes, 0),
+        gsl_vector_get(axes, 1),
+        gsl_vector_get(axes, 2)
+    };
+    gdouble p[3];
+    DSolverStatus status = d_solver_direct_kernel(geometry, t, p);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+    gsl_vector_set(pos, 0, p[0]);
+    gsl_vector_set(pos, 1, p[1]);
+    gsl_vector_set(pos, 2, p[2]);
+
+    return D_SOLVER_STATUS_OK;
+}
+
 void
 d_solver_solve_direct (DGeometry    *geometry,
                        gsl_vector   *axes,
                        gsl_vector   *pos,
                        GError       **err)
 {
-    g_return_if_fail(D_IS_GEOMETRY(geometry));
-    g_return_if_fail(axes != NULL);
-    g_return_if_fail(pos != NULL);
     g_return_if_fail(err == NULL || *err == NULL);
 
-    //TODO: Checkear que los centros no sean colineales
-    //TODO: Add restrictions to axes
-
-    gdouble pb[3][3];
-    {
-        int i;
-        for(i = 0; i < 3; i++) {
-            gdouble phi = ((gdouble)i) * G_PI * 2.0 / 3.0;
-            gdouble bx = geometry->r + geometry->a * cos(gsl_vector_get(axes, i)) - geometry->h;
-            gdouble by = 0.0;
-            gdouble bz = geometry->a * sin(gsl_vector_get(axes,i));
-
-            pb[i][0] = bx * cos(phi) - by * sin(phi);
-            pb[i][1] = by * cos(phi) + bx * sin(phi);
-            pb[i][2] = bz;
-        }
-    }
-    gdouble e[4][2];
-    {
-        gint j;
-        for (j = 1; j < 3; j++) {
-            e[0][j-1] = pb[0][0] * pb[0][0] - pb[j][0] * pb[j][0] +
-                        pb[0][1] * pb[0][1] - pb[j][1] * pb[j][1] +
-                        pb[0][2] * pb[0][2] - pb[j][2] * pb[j][2];
-            e[1][j-1] = 2.0*(pb[j][0] - pb[0][0]);
-            e[2][j-1] = 2.0*(pb[j][1] - pb[0][1]);
-            e[3][j-1] = 2.0*(pb[j][2] - pb[0][2]);
-        }
-    }
-    gdouble l[] = { e[1][0]*e[2][1] - e[1][1]*e[2][0],
-                   e[0][1]*e[2][0] - e[0][0]*e[2][1],
-                   e[3][1]*e[2][0] - e[3][0]*e[2][1],
-                   e[0][0]*e[1][1] - e[0][1]*e[1][0],
-                   e[3][0]*e[1][1] - e[3][1]*e[1][0] };
-    gdouble k0 = pow(l[1]/l[0], 2.0) +
-                pow(l[3]/l[0], 2.0) +
-                pow(pb[0][0], 2.0) +
-                pow(pb[0][1], 2.0) +
-                pow(pb[0][2], 2.0) -
-                pow(geometry->b, 2.0) -
-                2.0 * pb[0][0] * l[1] / l[0] -
-                2.0 * pb[0][1] * l[3] / l[0];
-    gdouble k1 = 2.0 * l[1]*l[2]/pow(l[0],2.0)
-              + 2.0 * l[3]*l[4]/pow(l[0],2.0)
-              - 2.0 * pb[0][0] * l[2] / l[0]
-              - 2.0 * pb[0][1] * l[4] / l[0]
-              - 2.0 * pb[0][2];
-    gdouble k2 = pow(l[2]/l[0], 2.0) + pow(l[4]/l[0], 2.0) + 1.0;
-
-    gdouble disc = k1 * k1 - 4.0 * k2 * k0;
-    if ( disc < 0.0) {
-        g_set_error_literal(err,
+    DSolverStatus status = d_solver_solve_direct_status(geometry, axes, pos);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
                 D_SOLVER_ERROR,
                 D_SOLVER_ERROR_FAILED,
-                "Could not reach point in cartesian space");
-        return;
+                "Could not reach point in cartesian space: %s",
+                d_solver_status_to_string(status));
     }
-    gsl_vector_set(pos, 2, ((-k1 + sqrt(disc))) / (2.0 * k2));
-    gsl_vector_set(pos, 1, l[3]/l[0] + l[4]/l[0] * gsl_vector_get(pos, 2));
-    gsl_vector_set(pos, 0, l[1]/l[0] + l[2]/l[0] * gsl_vector_get(pos, 2));
+}
 
-    g_assert(err == NULL || *err == NULL);
-    return;
+gsize
+d_solver_solve_direct_batch (DGeometry      *geometry,
+                             gsize          n,
+                             const gdouble  *t1,
+                             const gdouble  *t2,
+                             const gdouble  *t3,
+                             gdouble        *x,
+                             gdouble        *y,
+                             gdouble        *z,
+                             guint8         *status)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail(n == 0 || (t1 && t2 && t3), 0);
+    g_return_val_if_fail(n == 0 || (x && y && z && status), 0);
+
+    gsize solved = 0;
+    for (gsize k = 0; k < n; k++) {
+        gdouble t[] = { t1[k], t2[k], t3[k] };
+        gdouble p[3];
+        status[k] = d_solver_direct_kernel(geometry, t, p);
+        if (status[k] == D_SOLVER_STATUS_OK) {
+            x[k] = p[0];
+            y[k] = p[1];
+            z[k] = p[2];
+            solved++;
+        }
+    }
+    return solved;
 }
 
 void
@@ -114,13 +160,11 @@ d_solver_solve_direct_with_ext_axes (DGeometry  *geometry,
 
     gdouble a = geometry->a;
     gdouble b = geometry->b;
-    gdouble h = geometry->h;
-    gdouble r = geometry->r;
+    const DGeometryConstants *k = &geometry->derived;
 
     /* Use three positions that should be the same */
     gdouble p[3][3];
     for (int i = 0; i < 3; i++) {
-        gdouble phi = ((gdouble) i) * G_PI * 2.0 / 3.0;
         gdouble ci[] = {
             a * cos(gsl_matrix_get(extaxes, i, 0))
                 + b*sin(gsl_matrix_get(extaxes, i, 2))
@@ -131,8 +175,8 @@ d_solver_solve_direct_with_ext_axes (DGeometry  *geometry,
                 *sin(gsl_matrix_get(extaxes, i, 0) + gsl_matrix_get(extaxes, i, 1)),
         };
         gdouble px[] = {
-            (ci[0] - h + r) * cos(phi) - ci[1] * sin(phi),
-            (ci[0] - h + r) * sin(phi) + ci[1] * cos(phi),
+            (ci[0] - k->h_r) * k->cos_phi[i] - ci[1] * k->sin_phi[i],
+            (ci[0] - k->h_r) * k->sin_phi[i] + ci[1] * k->cos_phi[i],
             ci[2]
         };
 
@@ -151,6 +195,46 @@ d_solver_solve_direct_with_ext_axes (DGeometry  *geometry,
     return;
 }
 
+DSolverStatus
+d_solver_solve_inverse_status (DGeometry    *geometry,
+                               gsl_vector   *pos,
+                               gsl_vector   *axes,
+                               gsl_matrix   *extaxes)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(pos != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(axes || extaxes, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+
+    gdouble p[] = {
+        gsl_vector_get(pos, 0),
+        gsl_vector_get(pos, 1),
+        gsl_vector_get(pos, 2)
+    };
+    gdouble ext[3][3];
+    /* Reject unreachable targets before doing any trigonometry */
+    DSolverStatus status = d_solver_inverse_reach(geometry, p[0], p[1], p[2]);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+    status = d_solver_inverse_kernel(geometry, p, ext);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (extaxes) {
+            for (int j = 0; j < 3; j++) {
+                gsl_matrix_set(extaxes, i, j, ext[i][j]);
+            }
+        }
+        if (axes) {
+            gsl_vector_set(axes, i, ext[i][0]);
+        }
+    }
+
+    return D_SOLVER_STATUS_OK;
+}
+
 void
 d_solver_solve_inverse (DGeometry   *geometry,
                         gsl_vector  *pos,
@@ -158,74 +242,275 @@ d_solver_solve_inverse (DGeometry   *geometry,
                         gsl_matrix  *extaxes,
                         GError      **err)
 {
-    gboolean extcalc = extaxes ? TRUE : FALSE;
-    gboolean axescalc = axes ? TRUE : FALSE;
-    g_return_if_fail((extcalc || axescalc));
     g_return_if_fail(err == NULL || *err == NULL);
 
-    //TODO: Add hard restrictions to axes
+    DSolverStatus status = d_solver_solve_inverse_status(geometry, pos,
+                                                         axes, extaxes);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Target [ %f, %f, %f ] is out of working space: %s",
+                gsl_vector_get(pos, 0),
+                gsl_vector_get(pos, 1),
+                gsl_vector_get(pos, 2),
+                d_solver_status_to_string(status));
+    }
+}
+
+gsize
+d_solver_solve_inverse_branches (DGeometry      *geometry,
+                                 gsize          n,
+                                 const gdouble  *x,
+                                 const gdouble  *y,
+                                 const gdouble  *z,
+                                 gdouble        *branches,
+                                 guint8         *status)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail(n == 0 || (x && y && z && branches && status), 0);
+
+    gsize solved = 0;
+    for (gsize k = 0; k < n; k++) {
+        gdouble p[] = { x[k], y[k], z[k] };
+        status[k] = d_solver_inverse_reach(geometry, p[0], p[1], p[2]);
+        if (status[k] != D_SOLVER_STATUS_OK) {
+            continue;
+        }
+        gdouble br[3][D_SOLVER_N_BRANCHES][3];
+        status[k] = d_solver_inverse_branches_kernel(geometry, p, br);
+        if (status[k] != D_SOLVER_STATUS_OK) {
+            continue;
+        }
+        memcpy(branches + 3 * D_SOLVER_N_BRANCHES * 3 * k, br, sizeof(br));
+        solved++;
+    }
+    return solved;
+}
+
+/* Distance between two angles, modulo 2 pi */
+static inline gdouble
+d_solver_angle_distance (gdouble    u,
+                         gdouble    v)
+{
+    return fabs(remainder(u - v, 2.0 * G_PI));
+}
+
+void
+d_solver_select_branches (const gdouble branches[3][D_SOLVER_N_BRANCHES][3],
+                          const gdouble previous[3][3],
+                          gdouble       extaxes[3][3],
+                          DSolverBranch *chosen)
+{
     for (int i = 0; i < 3; i++) {
-        /* Locate point Ci */
-        gdouble phi = ((gdouble) i ) * G_PI * 2.0 / 3.0;
-        gdouble ci[] = {
-        gsl_vector_get(pos, 0) * cos(phi) + gsl_vector_get(pos, 1) * sin(phi) + geometry->h - geometry->r,
-        gsl_vector_get(pos, 1) * cos(phi) - gsl_vector_get(pos, 0) * sin(phi),
-        gsl_vector_get(pos, 2) };
-
-        /* Calculate theta 3 */
-        gdouble cos3 = ci[1] / geometry->b;
-
-        /* Check valid cos3 so we don't get an invalid sen3 */
-        if ( abs(cos3) > 1.0 ) {
-            g_set_error(err,
-                    D_SOLVER_ERROR,
-                    D_SOLVER_ERROR_FAILED,
-                    "Target [ %f, %f, %f ] is out of working space",
-                    gsl_vector_get(pos, 0),
-                    gsl_vector_get(pos, 1),
-                    gsl_vector_get(pos, 2));
-            return;
+        int best = 0;
+        gdouble best_distance = G_MAXDOUBLE;
+        for (int j = 0; j < D_SOLVER_N_BRANCHES; j++) {
+            gdouble distance = 0.0;
+            for (int l = 0; l < 3; l++) {
+                gdouble d = d_solver_angle_distance(branches[i][j][l],
+                                                    previous[i][l]);
+                distance += d * d;
+            }
+            if (distance < best_distance) {
+                best = j;
+                best_distance = distance;
+            }
+        }
+        for (int l = 0; l < 3; l++) {
+            extaxes[i][l] = branches[i][best][l];
         }
-        gdouble sen3 = sqrt(1.0 - cos3 * cos3);
-        if (extcalc) {
-            gsl_matrix_set(extaxes, i, 2, atan2(sen3, cos3));
+        if (chosen) {
+            chosen[i] = best;
         }
+    }
+}
+
+gsize
+d_solver_solve_inverse_path (DGeometry      *geometry,
+                             gsize          n,
+                             const gdouble  *x,
+                             const gdouble  *y,
+                             const gdouble  *z,
+                             const gdouble  *initial,
+                             gdouble        *extaxes,
+                             guint8         *status)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail(n == 0 || (x && y && z && extaxes && status), 0);
 
-        /* Calculate theta 2 */
-        gdouble cnormsq = ci[0] * ci[0] + ci[1] * ci[1] + ci[2] * ci[2];
-        gdouble cos2 = (cnormsq - geometry->a * geometry->a - geometry->b * geometry->b) / (2.0 * geometry->a * geometry->b * sen3);
-        /* Check for valid cos2 */
-        if ( abs(cos2) > 1.0 ) {
-            g_set_error(err,
-                    D_SOLVER_ERROR,
-                    D_SOLVER_ERROR_FAILED,
-                    "Target [ %f, %f, %f ] is out of working space",
-                    gsl_vector_get(pos, 0),
-                    gsl_vector_get(pos, 1),
-                    gsl_vector_get(pos, 2));
-            return;
+    gdouble previous[3][3];
+    gboolean has_previous = initial != NULL;
+    if (has_previous) {
+        memcpy(previous, initial, sizeof(previous));
+    }
+
+    gsize solved = 0;
+    for (gsize k = 0; k < n; k++) {
+        gdouble p[] = { x[k], y[k], z[k] };
+        status[k] = d_solver_inverse_reach(geometry, p[0], p[1], p[2]);
+        if (status[k] != D_SOLVER_STATUS_OK) {
+            continue;
+        }
+        gdouble br[3][D_SOLVER_N_BRANCHES][3];
+        status[k] = d_solver_inverse_branches_kernel(geometry, p, br);
+        if (status[k] != D_SOLVER_STATUS_OK) {
+            continue;
         }
-        gdouble sen2 = sqrt(1.0 - cos2 * cos2);
-        if ( extcalc ) {
-            gsl_matrix_set(extaxes, i, 1, atan2(sen2, cos2));
+        if (has_previous) {
+            d_solver_select_branches((const gdouble (*)[D_SOLVER_N_BRANCHES][3]) br,
+                                     (const gdouble (*)[3]) previous,
+                                     previous, NULL);
+        } else {
+            for (int i = 0; i < 3; i++) {
+                for (int l = 0; l < 3; l++) {
+                    previous[i][l] = br[i][0][l];
+                }
+            }
+            has_previous = TRUE;
+        }
+        memcpy(extaxes + 9 * k, previous, sizeof(previous));
+        solved++;
+    }
+    return solved;
+}
+
+/* Single precision variants */
+DSolverStatus
+d_solver_solve_direct_status_float (DGeometry           *geometry,
+                                    gsl_vector_float    *axes,
+                                    gsl_vector_float    *pos)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(axes != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(pos != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+
+    gfloat t[] = {
+        gsl_vector_float_get(axes, 0),
+        gsl_vector_float_get(axes, 1),
+        gsl_vector_float_get(axes, 2)
+    };
+    gfloat p[3];
+    DSolverStatus status = d_solver_direct_kernel_float(geometry, t, p);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+    gsl_vector_float_set(pos, 0, p[0]);
+    gsl_vector_float_set(pos, 1, p[1]);
+    gsl_vector_float_set(pos, 2, p[2]);
+
+    return D_SOLVER_STATUS_OK;
+}
+
+void
+d_solver_solve_direct_float (DGeometry          *geometry,
+                             gsl_vector_float   *axes,
+                             gsl_vector_float   *pos,
+                             GError             **err)
+{
+    g_return_if_fail(err == NULL || *err == NULL);
+
+    DSolverStatus status = d_solver_solve_direct_status_float(geometry,
+                                                              axes, pos);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Could not reach point in cartesian space: %s",
+                d_solver_status_to_string(status));
+    }
+}
+
+gsize
+d_solver_solve_direct_batch_float (DGeometry    *geometry,
+                                   gsize        n,
+                                   const gfloat *t1,
+                                   const gfloat *t2,
+                                   const gfloat *t3,
+                                   gfloat       *x,
+                                   gfloat       *y,
+                                   gfloat       *z,
+                                   guint8       *status)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail(n == 0 || (t1 && t2 && t3), 0);
+    g_return_val_if_fail(n == 0 || (x && y && z && status), 0);
+
+    gsize solved = 0;
+    for (gsize k = 0; k < n; k++) {
+        gfloat t[] = { t1[k], t2[k], t3[k] };
+        gfloat p[3];
+        status[k] = d_solver_direct_kernel_float(geometry, t, p);
+        if (status[k] == D_SOLVER_STATUS_OK) {
+            x[k] = p[0];
+            y[k] = p[1];
+            z[k] = p[2];
+            solved++;
         }
+    }
+    return solved;
+}
 
-        /* Calculate theta 1 */
-        gdouble x1 = geometry->a + geometry->b * cos2 * sen3;
-        gdouble x2 = geometry->b * sen2 * sen3;
-        gdouble sen1 = ci[2] * x1 - ci[0] * x2;
-        gdouble cos1 = ci[2] * x2 + ci[0] * x1;
-        if ( extcalc ) {
-            gsl_matrix_set(extaxes, i, 0, atan2(sen1, cos1));
+DSolverStatus
+d_solver_solve_inverse_status_float (DGeometry          *geometry,
+                                     gsl_vector_float   *pos,
+                                     gsl_vector_float   *axes,
+                                     gsl_matrix_float   *extaxes)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(pos != NULL, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+    g_return_val_if_fail(axes || extaxes, D_SOLVER_STATUS_OUT_OF_WORKSPACE);
+
+    gfloat p[] = {
+        gsl_vector_float_get(pos, 0),
+        gsl_vector_float_get(pos, 1),
+        gsl_vector_float_get(pos, 2)
+    };
+    gfloat ext[3][3];
+    DSolverStatus status = d_solver_inverse_reach(geometry, p[0], p[1], p[2]);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+    status = d_solver_inverse_kernel_float(geometry, p, ext);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        if (extaxes) {
+            for (int j = 0; j < 3; j++) {
+                gsl_matrix_float_set(extaxes, i, j, ext[i][j]);
+            }
         }
-        if (axescalc) {
-            gsl_vector_set(axes, i, atan2(sen1, cos1));
+        if (axes) {
+            gsl_vector_float_set(axes, i, ext[i][0]);
         }
     }
 
-    /* No error occured */
-    g_assert(err == NULL || *err == NULL);
-    return;
+    return D_SOLVER_STATUS_OK;
+}
+
+void
+d_solver_solve_inverse_float (DGeometry         *geometry,
+                              gsl_vector_float  *pos,
+                              gsl_vector_float  *axes,
+                              gsl_matrix_float  *extaxes,
+                              GError            **err)
+{
+    g_return_if_fail(err == NULL || *err == NULL);
+
+    DSolverStatus status = d_solver_solve_inverse_status_float(geometry, pos,
+                                                               axes, extaxes);
+    if (status != D_SOLVER_STATUS_OK) {
+        g_set_error(err,
+                D_SOLVER_ERROR,
+                D_SOLVER_ERROR_FAILED,
+                "Target [ %f, %f, %f ] is out of working space: %s",
+                gsl_vector_float_get(pos, 0),
+                gsl_vector_float_get(pos, 1),
+                gsl_vector_float_get(pos, 2),
+                d_solver_status_to_string(status));
+    }
 }
 
 /* Error handling functions */
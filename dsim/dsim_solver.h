@@ -33,7 +33,62 @@
 #include <dsim/dsim_geometry.h>
 #include <math.h>
 
-/* Static Methods */
+/* Per point status codes of the solvers */
+typedef enum {
+    D_SOLVER_STATUS_OK = 0,
+    D_SOLVER_STATUS_OUT_OF_WORKSPACE,   /* Arms can't meet */
+    D_SOLVER_STATUS_SINGULAR,           /* Elbows aligned, direct problem
+                                           has no unique solution */
+    D_SOLVER_STATUS_INVALID_COS3,       /* Target off the far arm reach
+                                           of some arm */
+    D_SOLVER_STATUS_INVALID_COS2        /* Target off the near arm reach
+                                           of some arm */
+} DSolverStatus;
+
+/*
+ * Sign branches of the square roots of the inverse problem of each arm.
+ * d_solver_solve_inverse takes sen2, sen3 >= 0. Flipping one of them
+ * mirrors the elbow and gives the other motor angle, flipping both gives
+ * the same motor angle with the far arm angles written as (t2 - pi, -t3).
+ */
+typedef enum {
+    D_SOLVER_BRANCH_SEN2_NEGATIVE = 1 << 0,
+    D_SOLVER_BRANCH_SEN3_NEGATIVE = 1 << 1
+} DSolverBranch;
+
+#define D_SOLVER_N_BRANCHES 4
+
+/* Static description of a status, for messages */
+const gchar*    d_solver_status_to_string   (DSolverStatus  status);
+
+/*
+ * Status returning solvers. They take the same arguments as the GError
+ * variants below and never allocate, so they are the ones to call from
+ * loops where many targets may fail. Outputs are left untouched unless
+ * D_SOLVER_STATUS_OK is returned.
+ *
+ * Every inverse solver reports an unreachable target as
+ * D_SOLVER_STATUS_INVALID_COS3 or _INVALID_COS2, the first condition
+ * failing in arm order. The scalar, branch and path solvers first run
+ * d_geometry_classify_point_first and give targets surely outside that
+ * same status without any trigonometry. The batch solver tests the
+ * conditions of all its lanes before any atan2 instead.
+ */
+DSolverStatus   d_solver_solve_direct_status
+                                        (DGeometry          *geometry,
+                                         gsl_vector         *axes,
+                                         gsl_vector         *pos);
+
+DSolverStatus   d_solver_solve_inverse_status
+                                        (DGeometry          *geometry,
+                                         gsl_vector         *pos,
+                                         gsl_vector         *axes,
+                                         gsl_matrix         *extaxes);
+
+/*
+ * GError variants, thin wrappers around the status solvers that report a
+ * failure as D_SOLVER_ERROR_FAILED with a formatted message.
+ */
 void        d_solver_solve_direct       (DGeometry          *geometry,
                                          gsl_vector         *axes,
                                          gsl_vector         *pos,
@@ -50,6 +105,163 @@ void        d_solver_solve_inverse      (DGeometry          *geometry,
                                          gsl_matrix         *extaxes,
                                          GError             **err);
 
+/*
+ * Batch direct kinematics over caller-owned arrays in structure-of-arrays
+ * layout. Solves n axes triples (t1[k], t2[k], t3[k]) into (x[k], y[k], z[k])
+ * and stores a DSolverStatus byte for each point in status. Positions of
+ * failed points are left untouched. Nothing is allocated.
+ * Returns the number of points solved successfully.
+ */
+gsize       d_solver_solve_direct_batch (DGeometry          *geometry,
+                                         gsize              n,
+                                         const gdouble      *t1,
+                                         const gdouble      *t2,
+                                         const gdouble      *t3,
+                                         gdouble            *x,
+                                         gdouble            *y,
+                                         gdouble            *z,
+                                         guint8             *status);
+
+/*
+ * Batch inverse kinematics over caller-owned arrays in structure-of-arrays
+ * layout. Targets (x[k], y[k], z[k]) are solved several at a time with
+ * SSE2 or AVX vector instructions when the compiler targets them, and with
+ * a portable scalar loop otherwise.
+ *
+ * t1, t2, t3 receive the three motor angles of each target, like the axes
+ * vector of d_solver_solve_inverse. extaxes receives a 3x3 row-major block
+ * per target (9 * n doubles) with the same layout as its extaxes matrix.
+ * Either output family may be NULL, but not both. Outputs of failed targets
+ * are left untouched. Nothing is allocated.
+ *
+ * Results agree with d_solver_solve_inverse to within D_SOLVER_BATCH_TOLERANCE
+ * radians, and failed targets get the status d_solver_solve_inverse_status
+ * returns for them. They are bit-identical unless the compiler contracts products
+ * into fused multiply-adds differently in the two paths.
+ * Returns the number of targets solved successfully.
+ */
+#define D_SOLVER_BATCH_TOLERANCE 1e-12
+
+gsize       d_solver_solve_inverse_batch(DGeometry          *geometry,
+                                         gsize              n,
+                                         const gdouble      *x,
+                                         const gdouble      *y,
+                                         const gdouble      *z,
+                                         gdouble            *t1,
+                                         gdouble            *t2,
+                                         gdouble            *t3,
+                                         gdouble            *extaxes,
+                                         guint8             *status);
+
+/* Name of the instruction set used by d_solver_solve_inverse_batch */
+const gchar*    d_solver_batch_isa      (void);
+
+/*
+ * Inverse kinematics with every branch of each arm in one pass, sharing the
+ * square roots between branches. branches receives 3 * D_SOLVER_N_BRANCHES
+ * * 3 doubles per target, 36 with the four sign branches, branch j of arm i
+ * at branches[36 * k + 12 * i + 3 * j] with the layout of an extaxes row,
+ * j being a combination of DSolverBranch bits. Branch 0 is
+ * the d_solver_solve_inverse solution. Outputs of failed targets are left
+ * untouched. Returns the number of targets solved successfully.
+ */
+gsize       d_solver_solve_inverse_branches
+                                        (DGeometry          *geometry,
+                                         gsize              n,
+                                         const gdouble      *x,
+                                         const gdouble      *y,
+                                         const gdouble      *z,
+                                         gdouble            *branches,
+                                         guint8             *status);
+
+/*
+ * Picks for each arm the branch closest to the previous extended axes,
+ * comparing angles modulo 2 pi, and writes it to extaxes. Ties go to the
+ * lower branch. chosen may be NULL.
+ */
+void        d_solver_select_branches    (const gdouble      branches[3][D_SOLVER_N_BRANCHES][3],
+                                         const gdouble      previous[3][3],
+                                         gdouble            extaxes[3][3],
+                                         DSolverBranch      *chosen);
+
+/*
+ * Solves a path of n targets keeping each arm on the branch continuous
+ * with the last solved target, starting from initial (a 3x3 row-major
+ * extaxes block) or from branch 0 when it is NULL. extaxes receives 9
+ * doubles per target like d_solver_solve_inverse_batch, status one
+ * DSolverStatus per target. Failed targets are left untouched and don't
+ * move the reference. Returns the number of targets solved successfully.
+ */
+gsize       d_solver_solve_inverse_path (DGeometry          *geometry,
+                                         gsize              n,
+                                         const gdouble      *x,
+                                         const gdouble      *y,
+                                         const gdouble      *z,
+                                         const gdouble      *initial,
+                                         gdouble            *extaxes,
+                                         guint8             *status);
+
+/*
+ * Single precision variants of the solvers above. They take the same
+ * arguments with gfloat storage and share their algorithms, evaluated in
+ * float arithmetic. The float batch solver fits twice as many targets in
+ * each vector as the double one.
+ *
+ * Over the working space of a typical geometry (arm lengths of some tens of
+ * units) results stay within D_SOLVER_FLOAT_POS_TOLERANCE of the double
+ * solvers, relative to the largest arm length, and within
+ * D_SOLVER_FLOAT_AXES_TOLERANCE radians. Targets closer than that to the
+ * working space boundary may be classified differently. Run dbench-float
+ * to check a given geometry.
+ */
+#define D_SOLVER_FLOAT_POS_TOLERANCE    1e-5
+#define D_SOLVER_FLOAT_AXES_TOLERANCE   1e-4
+
+DSolverStatus   d_solver_solve_direct_status_float
+                                        (DGeometry          *geometry,
+                                         gsl_vector_float   *axes,
+                                         gsl_vector_float   *pos);
+
+DSolverStatus   d_solver_solve_inverse_status_float
+                                        (DGeometry          *geometry,
+                                         gsl_vector_float   *pos,
+                                         gsl_vector_float   *axes,
+                                         gsl_matrix_float   *extaxes);
+
+void        d_solver_solve_direct_float (DGeometry          *geometry,
+                                         gsl_vector_float   *axes,
+                                         gsl_vector_float   *pos,
+                                         GError             **err);
+
+void        d_solver_solve_inverse_float(DGeometry          *geometry,
+                                         gsl_vector_float   *pos,
+                                         gsl_vector_float   *axes,
+                                         gsl_matrix_float   *extaxes,
+                                         GError             **err);
+
+gsize       d_solver_solve_direct_batch_float
+                                        (DGeometry          *geometry,
+                                         gsize              n,
+                                         const gfloat       *t1,
+                                         const gfloat       *t2,
+                                         const gfloat       *t3,
+                                         gfloat             *x,
+                                         gfloat             *y,
+                                         gfloat             *z,
+                                         guint8             *status);
+
+gsize       d_solver_solve_inverse_batch_float
+                                        (DGeometry          *geometry,
+                                         gsize              n,
+                                         const gfloat       *x,
+                                         const gfloat       *y,
+                                         const gfloat       *z,
+                                         gfloat             *t1,
+                                         gfloat             *t2,
+                                         gfloat             *t3,
+                                         gfloat             *extaxes,
+                                         guint8             *status);
+
 /* Error type for non reachable points */
 #define D_SOLVER_ERROR d_solver_error_quark ()
 
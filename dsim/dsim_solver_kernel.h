@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_solver_kernel.h : Private point kernels shared by the scalar and
+ *                        batch kinematic solvers and the jacobians, in
+ *                        double and single precision. Not part of the
+ *                        public API.
+ */
+
+#ifndef  DSIM_SOLVER_KERNEL_INC
+#define  DSIM_SOLVER_KERNEL_INC
+
+#include "dsim_solver.h"
+
+/*
+ * Double precision kernels: d_solver_elbows, d_solver_direct_kernel,
+ * d_solver_inverse_kernel, d_solver_inverse_branches_kernel,
+ * d_jacobian_direct_row and d_jacobian_inverse_diag.
+ */
+#define D_REAL              gdouble
+#define D_KERNEL(name)      name
+#define D_COS               cos
+#define D_SIN               sin
+#define D_SQRT              sqrt
+#define D_ATAN2             atan2
+#define D_FABS              fabs
+#include "dsim_solver_kernel_real.h"
+
+/*
+ * Single precision kernels, same names with a _float suffix like gsl uses
+ * for its float containers.
+ */
+#define D_REAL              gfloat
+#define D_KERNEL(name)      name ## _float
+#define D_COS               cosf
+#define D_SIN               sinf
+#define D_SQRT              sqrtf
+#define D_ATAN2             atan2f
+#define D_FABS              fabsf
+#include "dsim_solver_kernel_real.h"
+
+#endif   /* ----- #ifndef DSIM_SOLVER_KERNEL_INC  ----- */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_solver_kernel_real.h : Body of the point kernels, written once for
+ *                             any floating point type. It is included by
+ *                             dsim_solver_kernel.h for each type, so it has
+ *                             no include guard. Not part of the public API.
+ *
+ * The including file defines:
+ *   D_REAL                 floating point type of the kernels
+ *   D_KERNEL(name)         name of each kernel for that type
+ *   D_COS, D_SIN, D_SQRT,
+ *   D_ATAN2, D_FABS        math functions taking and returning D_REAL
+ * and they are undefined again at the end of this file.
+ *
+ * Geometry parameters are loaded into D_REAL locals and constants are cast
+ * with D_C, so no expression is silently promoted to another type.
+ */
+
+#define D_C(x)  ((D_REAL) (x))
+
+/*
+ * Elbow of each arm for the given axes, shifted by the platform offset so
+ * the end effector is at distance b from all three of them.
+ */
+static inline void
+D_KERNEL(d_solver_elbows) (DGeometry    *geometry,
+                           const D_REAL axes[3],
+                           D_REAL       pb[3][3])
+{
+    const D_REAL a = geometry->a;
+    const D_REAL h_r = geometry->derived.h_r;
+
+    for (int i = 0; i < 3; i++) {
+        D_REAL bx = a * D_COS(axes[i]) - h_r;
+        D_REAL bz = a * D_SIN(axes[i]);
+
+        pb[i][0] = bx * (D_REAL) geometry->derived.cos_phi[i];
+        pb[i][1] = bx * (D_REAL) geometry->derived.sin_phi[i];
+        pb[i][2] = bz;
+    }
+}
+
+/*
+ * End effector position from the elbows, the intersection of the three
+ * spheres of radius b around them closest to +z.
+ */
+static inline DSolverStatus
+D_KERNEL(d_solver_direct_from_elbows) (DGeometry    *geometry,
+                                       D_REAL       pb[3][3],
+                                       D_REAL       pos[3])
+{
+    const D_REAL b2 = geometry->derived.b2;
+
+    D_REAL e[4][2];
+    for (int j = 1; j < 3; j++) {
+        e[0][j-1] = pb[0][0] * pb[0][0] - pb[j][0] * pb[j][0] +
+                    pb[0][1] * pb[0][1] - pb[j][1] * pb[j][1] +
+                    pb[0][2] * pb[0][2] - pb[j][2] * pb[j][2];
+        e[1][j-1] = D_C(2.0)*(pb[j][0] - pb[0][0]);
+        e[2][j-1] = D_C(2.0)*(pb[j][1] - pb[0][1]);
+        e[3][j-1] = D_C(2.0)*(pb[j][2] - pb[0][2]);
+    }
+    D_REAL l[] = { e[1][0]*e[2][1] - e[1][1]*e[2][0],
+                   e[0][1]*e[2][0] - e[0][0]*e[2][1],
+                   e[3][1]*e[2][0] - e[3][0]*e[2][1],
+                   e[0][0]*e[1][1] - e[0][1]*e[1][0],
+                   e[3][0]*e[1][1] - e[3][1]*e[1][0] };
+    /* Elbows on a vertical plane leave the system underdetermined */
+    if (l[0] == D_C(0.0)) {
+        return D_SOLVER_STATUS_SINGULAR;
+    }
+    D_REAL m[] = { l[1]/l[0], l[2]/l[0], l[3]/l[0], l[4]/l[0] };
+    D_REAL k0 = m[0] * m[0] +
+                m[2] * m[2] +
+                pb[0][0] * pb[0][0] +
+                pb[0][1] * pb[0][1] +
+                pb[0][2] * pb[0][2] -
+                b2 -
+                D_C(2.0) * pb[0][0] * m[0] -
+                D_C(2.0) * pb[0][1] * m[2];
+    D_REAL k1 = D_C(2.0) * m[0] * m[1]
+              + D_C(2.0) * m[2] * m[3]
+              - D_C(2.0) * pb[0][0] * m[1]
+              - D_C(2.0) * pb[0][1] * m[3]
+              - D_C(2.0) * pb[0][2];
+    D_REAL k2 = m[1] * m[1] + m[3] * m[3] + D_C(1.0);
+
+    D_REAL disc = k1 * k1 - D_C(4.0) * k2 * k0;
+    /* Written this way so a NaN discriminant is rejected too */
+    if (!(disc >= D_C(0.0))) {
+        return D_SOLVER_STATUS_OUT_OF_WORKSPACE;
+    }
+    pos[2] = (-k1 + D_SQRT(disc)) / (D_C(2.0) * k2);
+    pos[1] = m[2] + m[3] * pos[2];
+    pos[0] = m[0] + m[1] * pos[2];
+
+    return D_SOLVER_STATUS_OK;
+}
+
+/*
+ * Direct kinematics kernel shared by the single point and batch solvers.
+ */
+static inline DSolverStatus
+D_KERNEL(d_solver_direct_kernel) (DGeometry     *geometry,
+                                  const D_REAL  axes[3],
+                                  D_REAL        pos[3])
+{
+    //TODO: Add restrictions to axes
+
+    D_REAL pb[3][3];
+    D_KERNEL(d_solver_elbows)(geometry, axes, pb);
+    return D_KERNEL(d_solver_direct_from_elbows)(geometry, pb, pos);
+}
+
+/*
+ * Conditions of the inverse problem of every arm, checked for the three
+ * arms before any atan2 so unreachable targets cost no trigonometry. On
+ * success arm[i] holds ci[0], ci[2], x1, x2, sen2, cos2, sen3 and cos3 of
+ * arm i. Otherwise the status tells which condition failed first, in arm
+ * order, like the vectorized batch solver reports it.
+ */
+static inline DSolverStatus
+D_KERNEL(d_solver_inverse_arms) (DGeometry      *geometry,
+                                 const D_REAL   pos[3],
+                                 D_REAL         arm[3][8])
+{
+    const D_REAL a = geometry->a;
+    const D_REAL b = geometry->b;
+    const D_REAL h_r = geometry->derived.h_r;
+    const D_REAL a2 = geometry->derived.a2;
+    const D_REAL b2 = geometry->derived.b2;
+
+    //TODO: Add hard restrictions to axes
+    for (int i = 0; i < 3; i++) {
+        const D_REAL c = geometry->derived.cos_phi[i];
+        const D_REAL s = geometry->derived.sin_phi[i];
+
+        /* Locate point Ci */
+        D_REAL ci[] = {
+            pos[0] * c + pos[1] * s + h_r,
+            pos[1] * c - pos[0] * s,
+            pos[2] };
+
+        /* Calculate theta 3, check valid cos3 so we don't get an invalid sen3 */
+        D_REAL cos3 = ci[1] / b;
+        if (!(D_FABS(cos3) <= D_C(1.0))) {
+            return D_SOLVER_STATUS_INVALID_COS3;
+        }
+        D_REAL sen3 = D_SQRT(D_C(1.0) - cos3 * cos3);
+
+        /* Calculate theta 2 */
+        D_REAL cnormsq = ci[0] * ci[0] + ci[1] * ci[1] + ci[2] * ci[2];
+        D_REAL cos2 = (cnormsq - a2 - b2)
+                        / (D_C(2.0) * a * b * sen3);
+        if (!(D_FABS(cos2) <= D_C(1.0))) {
+            return D_SOLVER_STATUS_INVALID_COS2;
+        }
+        D_REAL sen2 = D_SQRT(D_C(1.0) - cos2 * cos2);
+
+        /* Terms of theta 1 */
+        arm[i][0] = ci[0];
+        arm[i][1] = ci[2];
+        arm[i][2] = a + b * cos2 * sen3;
+        arm[i][3] = b * sen2 * sen3;
+        arm[i][4] = sen2;
+        arm[i][5] = cos2;
+        arm[i][6] = sen3;
+        arm[i][7] = cos3;
+    }
+    return D_SOLVER_STATUS_OK;
+}
+
+/*
+ * Inverse kinematics kernel. Fills ext[i] with the three angles of arm i in
+ * the same layout as the extended axes matrix used by d_solver_solve_inverse.
+ * ext is only complete when D_SOLVER_STATUS_OK is returned, otherwise the
+ * status tells which condition failed first.
+ */
+static inline DSolverStatus
+D_KERNEL(d_solver_inverse_kernel) (DGeometry    *geometry,
+                                   const D_REAL pos[3],
+                                   D_REAL       ext[3][3])
+{
+    D_REAL arm[3][8];
+    DSolverStatus status = D_KERNEL(d_solver_inverse_arms)(geometry, pos, arm);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const D_REAL *t = arm[i];
+
+        /* Calculate theta 1 */
+        D_REAL sen1 = t[1] * t[2] - t[0] * t[3];
+        D_REAL cos1 = t[1] * t[3] + t[0] * t[2];
+
+        ext[i][0] = D_ATAN2(sen1, cos1);
+        ext[i][1] = D_ATAN2(t[4], t[5]);
+        ext[i][2] = D_ATAN2(t[6], t[7]);
+    }
+    return D_SOLVER_STATUS_OK;
+}
+
+/*
+ * Inverse kinematics kernel enumerating the sign branches of sen2 and sen3
+ * of each arm. Fills br[i][branch] with the extended axes of arm i for each
+ * combination of DSolverBranch bits, branch 0 being the solution of
+ * d_solver_inverse_kernel. Flipping sen3 also flips cos2, so the branches
+ * share every square root and differ only in the signs fed to atan2.
+ */
+static inline DSolverStatus
+D_KERNEL(d_solver_inverse_branches_kernel) (DGeometry       *geometry,
+                                            const D_REAL    pos[3],
+                                            D_REAL          br[3][D_SOLVER_N_BRANCHES][3])
+{
+    const D_REAL pi = D_C(G_PI);
+
+    D_REAL arms[3][8];
+    DSolverStatus status = D_KERNEL(d_solver_inverse_arms)(geometry, pos, arms);
+    if (status != D_SOLVER_STATUS_OK) {
+        return status;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const D_REAL ci0 = arms[i][0];
+        const D_REAL ci2 = arms[i][1];
+        const D_REAL x1 = arms[i][2];
+        const D_REAL x2 = arms[i][3];
+
+        /*
+         * Flipping the sign of either sen2 or sen3 mirrors x2, flipping both
+         * leaves x1 and x2 as they are, so there are two motor angles.
+         */
+        D_REAL t1 = D_ATAN2(ci2 * x1 - ci0 * x2,
+                            ci2 * x2 + ci0 * x1);
+        D_REAL t1_mirror = D_ATAN2(ci2 * x1 + ci0 * x2,
+                                   ci0 * x1 - ci2 * x2);
+        D_REAL t2 = D_ATAN2(arms[i][4], arms[i][5]);
+        D_REAL t3 = D_ATAN2(arms[i][6], arms[i][7]);
+
+        D_REAL (*arm)[3] = br[i];
+        arm[0][0] = t1;
+        arm[0][1] = t2;
+        arm[0][2] = t3;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE][0] = t1_mirror;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE][1] = -t2;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE][2] = t3;
+        arm[D_SOLVER_BRANCH_SEN3_NEGATIVE][0] = t1_mirror;
+        arm[D_SOLVER_BRANCH_SEN3_NEGATIVE][1] = pi - t2;
+        arm[D_SOLVER_BRANCH_SEN3_NEGATIVE][2] = -t3;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE | D_SOLVER_BRANCH_SEN3_NEGATIVE][0] = t1;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE | D_SOLVER_BRANCH_SEN3_NEGATIVE][1] = t2 - pi;
+        arm[D_SOLVER_BRANCH_SEN2_NEGATIVE | D_SOLVER_BRANCH_SEN3_NEGATIVE][2] = -t3;
+    }
+    return D_SOLVER_STATUS_OK;
+}
+
+/*
+ * Row i of the direct jacobian, from the extended axes t of arm i.
+ */
+static inline void
+D_KERNEL(d_jacobian_direct_row) (DGeometry      *geometry,
+                                 int            i,
+                                 const D_REAL   t[3],
+                                 D_REAL         row[3])
+{
+    const D_REAL c = geometry->derived.cos_phi[i];
+    const D_REAL s = geometry->derived.sin_phi[i];
+
+    row[0] = D_COS(t[0] + t[1]) * D_SIN(t[2]) * c - D_COS(t[2]) * s;
+    row[1] = D_COS(t[0] + t[1]) * D_SIN(t[2]) * s + D_COS(t[2]) * c;
+    row[2] = D_SIN(t[0] + t[1]) * D_SIN(t[2]);
+}
+
+/*
+ * Diagonal element i of the inverse jacobian, from the extended axes t of
+ * arm i. The inverse jacobian has no off-diagonal terms.
+ */
+static inline D_REAL
+D_KERNEL(d_jacobian_inverse_diag) (const D_REAL t[3])
+{
+    return D_SIN(t[1]) * D_SIN(t[2]);
+}
+
+#undef D_C
+#undef D_REAL
+#undef D_KERNEL
+#undef D_COS
+#undef D_SIN
+#undef D_SQRT
+#undef D_ATAN2
+#undef D_FABS
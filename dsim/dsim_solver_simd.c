@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_solver_simd.c : Vectorized batch inverse kinematics.
+ *
+ * The algebraic part of the inverse problem is evaluated for D_SIMD_WIDTH
+ * targets at once. The final atan2 calls run per lane with the C library,
+ * which keeps the results identical to the scalar kernel. The solver body
+ * lives in dsim_solver_simd_real.h and is built here in double and in
+ * single precision.
+ */
+
+#include "dsim_solver.h"
+#include "dsim_solver_kernel.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define D_SIMD_ISA              "avx"
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define D_SIMD_ISA              "sse2"
+#else
+#define D_SIMD_ISA              "scalar"
+#endif
+
+/* Double precision: d_solver_solve_inverse_batch */
+#define D_REAL                  gdouble
+#define D_KERNEL(name)          name
+#define D_ATAN2                 atan2
+
+#if defined(__AVX__)
+#define D_SIMD_WIDTH            4
+#define DSimd                   __m256d
+#define d_simd_set1(v)          _mm256_set1_pd(v)
+#define d_simd_load(p)          _mm256_loadu_pd(p)
+#define d_simd_store(p, v)      _mm256_storeu_pd((p), (v))
+#define d_simd_add(a, b)        _mm256_add_pd((a), (b))
+#define d_simd_sub(a, b)        _mm256_sub_pd((a), (b))
+#define d_simd_mul(a, b)        _mm256_mul_pd((a), (b))
+#define d_simd_div(a, b)        _mm256_div_pd((a), (b))
+#define d_simd_sqrt(a)          _mm256_sqrt_pd(a)
+#define d_simd_abs(a)           _mm256_andnot_pd(_mm256_set1_pd(-0.0), (a))
+#define d_simd_le_mask(a, b)    _mm256_movemask_pd(_mm256_cmp_pd((a), (b), _CMP_LE_OQ))
+#elif defined(__SSE2__)
+#define D_SIMD_WIDTH            2
+#define DSimd                   __m128d
+#define d_simd_set1(v)          _mm_set1_pd(v)
+#define d_simd_load(p)          _mm_loadu_pd(p)
+#define d_simd_store(p, v)      _mm_storeu_pd((p), (v))
+#define d_simd_add(a, b)        _mm_add_pd((a), (b))
+#define d_simd_sub(a, b)        _mm_sub_pd((a), (b))
+#define d_simd_mul(a, b)        _mm_mul_pd((a), (b))
+#define d_simd_div(a, b)        _mm_div_pd((a), (b))
+#define d_simd_sqrt(a)          _mm_sqrt_pd(a)
+#define d_simd_abs(a)           _mm_andnot_pd(_mm_set1_pd(-0.0), (a))
+#define d_simd_le_mask(a, b)    _mm_movemask_pd(_mm_cmple_pd((a), (b)))
+#else
+#define D_SIMD_WIDTH            1
+#endif
+
+#include "dsim_solver_simd_real.h"
+
+/* Single precision: d_solver_solve_inverse_batch_float, twice the lanes */
+#define D_REAL                  gfloat
+#define D_KERNEL(name)          name ## _float
+#define D_ATAN2                 atan2f
+
+#if defined(__AVX__)
+#define D_SIMD_WIDTH            8
+#define DSimd                   __m256
+#define d_simd_set1(v)          _mm256_set1_ps(v)
+#define d_simd_load(p)          _mm256_loadu_ps(p)
+#define d_simd_store(p, v)      _mm256_storeu_ps((p), (v))
+#define d_simd_add(a, b)        _mm256_add_ps((a), (b))
+#define d_simd_sub(a, b)        _mm256_sub_ps((a), (b))
+#define d_simd_mul(a, b)        _mm256_mul_ps((a), (b))
+#define d_simd_div(a, b)        _mm256_div_ps((a), (b))
+#define d_simd_sqrt(a)          _mm256_sqrt_ps(a)
+#define d_simd_abs(a)           _mm256_andnot_ps(_mm256_set1_ps(-0.0f), (a))
+#define d_simd_le_mask(a, b)    _mm256_movemask_ps(_mm256_cmp_ps((a), (b), _CMP_LE_OQ))
+#elif defined(__SSE2__)
+#define D_SIMD_WIDTH            4
+#define DSimd                   __m128
+#define d_simd_set1(v)          _mm_set1_ps(v)
+#define d_simd_load(p)          _mm_loadu_ps(p)
+#define d_simd_store(p, v)      _mm_storeu_ps((p), (v))
+#define d_simd_add(a, b)        _mm_add_ps((a), (b))
+#define d_simd_sub(a, b)        _mm_sub_ps((a), (b))
+#define d_simd_mul(a, b)        _mm_mul_ps((a), (b))
+#define d_simd_div(a, b)        _mm_div_ps((a), (b))
+#define d_simd_sqrt(a)          _mm_sqrt_ps(a)
+#define d_simd_abs(a)           _mm_andnot_ps(_mm_set1_ps(-0.0f), (a))
+#define d_simd_le_mask(a, b)    _mm_movemask_ps(_mm_cmple_ps((a), (b)))
+#else
+#define D_SIMD_WIDTH            1
+#endif
+
+#include "dsim_solver_simd_real.h"
+
+const gchar*
+d_solver_batch_isa (void)
+{
+    return D_SIMD_ISA;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_solver_simd_real.h : Body of the batch inverse kinematics solver,
+ *                           written once for any floating point type. It is
+ *                           included by dsim_solver_simd.c for each type, so
+ *                           it has no include guard.
+ *
+ * The including file defines:
+ *   D_REAL                 floating point type of the solver
+ *   D_KERNEL(name)         name of each function for that type
+ *   D_ATAN2                atan2 taking and returning D_REAL
+ *   D_SIMD_WIDTH           number of D_REAL lanes in a vector, 1 for none
+ * and, when D_SIMD_WIDTH > 1, the vector type DSimd and the d_simd_set1,
+ * d_simd_load, d_simd_store, d_simd_add, d_simd_sub, d_simd_mul, d_simd_div,
+ * d_simd_sqrt, d_simd_abs and d_simd_le_mask operations on it.
+ * All of them are undefined again at the end of this file.
+ */
+
+#define D_SIMD_ALL_LANES        ((1 << D_SIMD_WIDTH) - 1)
+
+/* Writes a solved target into whichever outputs were requested */
+static inline void
+D_KERNEL(d_solver_store_inverse) (gsize     k,
+                                  D_REAL    ext[3][3],
+                                  D_REAL    *t1,
+                                  D_REAL    *t2,
+                                  D_REAL    *t3,
+                                  D_REAL    *extaxes)
+{
+    if (t1) {
+        t1[k] = ext[0][0];
+        t2[k] = ext[1][0];
+        t3[k] = ext[2][0];
+    }
+    if (extaxes) {
+        D_REAL *block = extaxes + 9 * k;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                block[3 * i + j] = ext[i][j];
+            }
+        }
+    }
+}
+
+#if D_SIMD_WIDTH > 1
+/*
+ * Solves D_SIMD_WIDTH targets starting at x, y, z. Operations are kept in
+ * the same order as d_solver_inverse_kernel. Returns a bit mask of the lanes
+ * whose targets are inside the working space; sines and cosines of masked
+ * out lanes are meaningless. Lanes that failed on cos3 before failing on
+ * cos2, like the scalar kernel would report, are set in bad_cos3.
+ */
+static inline int
+D_KERNEL(d_solver_inverse_simd) (DGeometry      *geometry,
+                                 const D_REAL   *x,
+                                 const D_REAL   *y,
+                                 const D_REAL   *z,
+                                 D_REAL         sc[3][6][D_SIMD_WIDTH],
+                                 int            *bad_cos3)
+{
+    const DGeometryConstants *k = &geometry->derived;
+    const DSimd one = d_simd_set1(1.0);
+    const DSimd a = d_simd_set1(geometry->a);
+    const DSimd b = d_simd_set1(geometry->b);
+    const DSimd h_r = d_simd_set1(k->h_r);
+    const DSimd aa = d_simd_set1(k->a2);
+    const DSimd bb = d_simd_set1(k->b2);
+    const DSimd two_ab = d_simd_set1((D_REAL) 2.0 * (D_REAL) geometry->a
+                                     * (D_REAL) geometry->b);
+
+    DSimd px = d_simd_load(x);
+    DSimd py = d_simd_load(y);
+    DSimd pz = d_simd_load(z);
+
+    int valid = D_SIMD_ALL_LANES;
+    *bad_cos3 = 0;
+    for (int i = 0; i < 3; i++) {
+        DSimd c = d_simd_set1(k->cos_phi[i]);
+        DSimd s = d_simd_set1(k->sin_phi[i]);
+
+        /* Locate point Ci */
+        DSimd cx = d_simd_add(d_simd_add(d_simd_mul(px, c),
+                                         d_simd_mul(py, s)),
+                              h_r);
+        DSimd cy = d_simd_sub(d_simd_mul(py, c), d_simd_mul(px, s));
+
+        /* Theta 3 */
+        DSimd cos3 = d_simd_div(cy, b);
+        int valid3 = d_simd_le_mask(d_simd_abs(cos3), one);
+        *bad_cos3 |= valid & ~valid3;
+        valid &= valid3;
+        DSimd sen3 = d_simd_sqrt(d_simd_sub(one, d_simd_mul(cos3, cos3)));
+
+        /* Theta 2 */
+        DSimd cnormsq = d_simd_add(d_simd_add(d_simd_mul(cx, cx),
+                                              d_simd_mul(cy, cy)),
+                                   d_simd_mul(pz, pz));
+        DSimd cos2 = d_simd_div(d_simd_sub(d_simd_sub(cnormsq, aa), bb),
+                                d_simd_mul(two_ab, sen3));
+        valid &= d_simd_le_mask(d_simd_abs(cos2), one);
+        DSimd sen2 = d_simd_sqrt(d_simd_sub(one, d_simd_mul(cos2, cos2)));
+
+        /* Theta 1 */
+        DSimd x1 = d_simd_add(a, d_simd_mul(d_simd_mul(b, cos2), sen3));
+        DSimd x2 = d_simd_mul(d_simd_mul(b, sen2), sen3);
+        DSimd sen1 = d_simd_sub(d_simd_mul(pz, x1), d_simd_mul(cx, x2));
+        DSimd cos1 = d_simd_add(d_simd_mul(pz, x2), d_simd_mul(cx, x1));
+
+        if (!valid) {
+            return 0;
+        }
+        d_simd_store(sc[i][0], sen1);
+        d_simd_store(sc[i][1], cos1);
+        d_simd_store(sc[i][2], sen2);
+        d_simd_store(sc[i][3], cos2);
+        d_simd_store(sc[i][4], sen3);
+        d_simd_store(sc[i][5], cos3);
+    }
+    return valid;
+}
+#endif
+
+gsize
+D_KERNEL(d_solver_solve_inverse_batch) (DGeometry       *geometry,
+                                        gsize           n,
+                                        const D_REAL    *x,
+                                        const D_REAL    *y,
+                                        const D_REAL    *z,
+                                        D_REAL          *t1,
+                                        D_REAL          *t2,
+                                        D_REAL          *t3,
+                                        D_REAL          *extaxes,
+                                        guint8          *status)
+{
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), 0);
+    g_return_val_if_fail(t1 || extaxes, 0);
+    g_return_val_if_fail(!t1 || (t2 && t3), 0);
+    g_return_val_if_fail(n == 0 || (x && y && z && status), 0);
+
+    gsize solved = 0;
+    gsize k = 0;
+    D_REAL ext[3][3];
+
+#if D_SIMD_WIDTH > 1
+    D_REAL sc[3][6][D_SIMD_WIDTH];
+    for (; k + D_SIMD_WIDTH <= n; k += D_SIMD_WIDTH) {
+        int bad_cos3;
+        int valid = D_KERNEL(d_solver_inverse_simd)(geometry,
+                                                    x + k, y + k, z + k, sc,
+                                                    &bad_cos3);
+        for (int lane = 0; lane < D_SIMD_WIDTH; lane++) {
+            if (!(valid & (1 << lane))) {
+                status[k + lane] = (bad_cos3 & (1 << lane))
+                                   ? D_SOLVER_STATUS_INVALID_COS3
+                                   : D_SOLVER_STATUS_INVALID_COS2;
+                continue;
+            }
+            for (int i = 0; i < 3; i++) {
+                ext[i][0] = D_ATAN2(sc[i][0][lane], sc[i][1][lane]);
+                ext[i][1] = D_ATAN2(sc[i][2][lane], sc[i][3][lane]);
+                ext[i][2] = D_ATAN2(sc[i][4][lane], sc[i][5][lane]);
+            }
+            D_KERNEL(d_solver_store_inverse)(k + lane, ext,
+                                             t1, t2, t3, extaxes);
+            status[k + lane] = D_SOLVER_STATUS_OK;
+            solved++;
+        }
+    }
+#endif
+
+    /* Remaining targets, or all of them without vector support */
+    for (; k < n; k++) {
+        D_REAL p[] = { x[k], y[k], z[k] };
+        status[k] = D_KERNEL(d_solver_inverse_kernel)(geometry, p, ext);
+        if (status[k] == D_SOLVER_STATUS_OK) {
+            D_KERNEL(d_solver_store_inverse)(k, ext, t1, t2, t3, extaxes);
+            solved++;
+        }
+    }
+    return solved;
+}
+
+#undef D_SIMD_ALL_LANES
+#undef D_REAL
+#undef D_KERNEL
+#undef D_ATAN2
+#undef D_SIMD_WIDTH
+#undef DSimd
+#undef d_simd_set1
+#undef d_simd_load
+#undef d_simd_store
+#undef d_simd_add
+#undef d_simd_sub
+#undef d_simd_mul
+#undef d_simd_div
+#undef d_simd_sqrt
+#undef d_simd_abs
+#undef d_simd_le_mask
@@ -28,6 +28,7 @@
 #include <glib-object.h>
 #include <gsl/gsl_vector.h>
 #include <dsim/dsim_solver.h>
+#include <dsim/dsim_singularity_monitor.h>
 
 
 /* #######################  TRAJECTORY CONTROL ORDERS  #################### */
@@ -130,6 +131,9 @@ struct _DTrajectoryControl {
     /* Output function for linear trajectories */
     DTrajectoryOutputFunc   linear_out_fun;
     gpointer                linear_out_data;
+
+    /* Fed with every position set, may be NULL */
+    DSingularityMonitor     *singularity_monitor;
 };
 
 typedef struct _DTrajectoryControlClass DTrajectoryControlClass;
@@ -166,6 +170,15 @@ void                d_trajectory_control_set_linear_out_fun (DTrajectoryControl
                                                      DTrajectoryOutputFunc  func,
                                                      gpointer               output_data);
 
+/*
+ * Monitor updated on every tick before the output function is called, or
+ * NULL to stop monitoring. Joint moves solve the inverse problem of each
+ * tick to feed it.
+ */
+void                d_trajectory_control_set_singularity_monitor
+                                                    (DTrajectoryControl     *self,
+                                                     DSingularityMonitor    *monitor);
+
 /* #######################  COMMON TRAJECTORY SUPER CLASS  ############# */
 /**
  * DTrajectory provides a single interface for trajectories. Serves as a
@@ -23,6 +23,7 @@
  */
 
 #include "dsim_trajectory.h"
+#include "dsim_vec3.h"
 
 //#include <signal.h>
 //#include <time.h>
@@ -146,6 +147,7 @@ d_trajectory_control_init (DTrajectoryControl   *self)
     self->linear_out_data = NULL;
     self->joint_out_fun = d_trajectory_control_default_output;
     self->joint_out_data = NULL;
+    self->singularity_monitor = NULL;
 
     self->accelTime = 0.1;
     self->decelTime = 0.1;
@@ -172,6 +174,10 @@ d_trajectory_control_dispose (GObject   *obj)
         g_object_unref(self->geometry);
         self->geometry = NULL;
     }
+    if (self->singularity_monitor) {
+        g_object_unref(self->singularity_monitor);
+        self->singularity_monitor = NULL;
+    }
     if (self->joint_speed) {
         gsl_vector_free(self->joint_speed);
         self->joint_speed = NULL;
@@ -433,6 +439,21 @@ d_trajectory_control_execute_trajectory (DTrajectoryControl *self,
     timer_delete(timerid);
 }
 
+/* Builds the GError for a failed solve, only once it is known to fail */
+static void
+d_trajectory_control_set_solver_error (GError           **err,
+                                       DSolverStatus    status,
+                                       const gchar      *what,
+                                       DVec3            v)
+{
+    g_set_error(err,
+            D_SOLVER_ERROR,
+            D_SOLVER_ERROR_FAILED,
+            "%s [ %f, %f, %f ] can't be solved: %s",
+            what, v.v[0], v.v[1], v.v[2],
+            d_solver_status_to_string(status));
+}
+
 static void
 d_trajectory_control_set_current_destination (DTrajectoryControl    *self,
                                               gsl_vector            *dest,
@@ -441,26 +462,27 @@ d_trajectory_control_set_current_destination (DTrajectoryControl    *self,
     g_return_if_fail(err == NULL || *err == NULL);
     g_return_if_fail(dest != NULL);
 
-    gsl_vector *new_dest = gsl_vector_calloc(3);
-    gsl_vector *new_dest_axes = gsl_vector_calloc(3);
-    GError *local_err = NULL;
-
-    gsl_vector_memcpy(new_dest, dest);
-    d_solver_solve_inverse(self->geometry,
-                        new_dest,
-                        new_dest_axes,
-                        NULL,
-                        &local_err);
-    if (local_err != NULL) {
-        g_propagate_error(err, local_err);
+    DVec3 new_dest = d_vec3_from_gsl(dest);
+    DVec3 new_dest_axes;
+    gsl_vector_view dest_view = d_vec3_view(&new_dest);
+    gsl_vector_view dest_axes_view = d_vec3_view(&new_dest_axes);
+
+    /*
+     * Unreachable destinations are refused before planning anything. The
+     * status solver tests the reach envelope before its kernel, so they
+     * cost no trigonometry either.
+     */
+    DSolverStatus status = d_solver_solve_inverse_status(self->geometry,
+                                                         &dest_view.vector,
+                                                         &dest_axes_view.vector,
+                                                         NULL);
+    if (status != D_SOLVER_STATUS_OK) {
+        d_trajectory_control_set_solver_error(err, status, "Destination", new_dest);
         return;
     }
 
-    gsl_vector_memcpy(self->current_destination, new_dest);
-    gsl_vector_memcpy(self->current_destination_axes, new_dest_axes);
-
-    gsl_vector_free(new_dest);
-    gsl_vector_free(new_dest_axes);
+    d_vec3_to_gsl(new_dest, self->current_destination);
+    d_vec3_to_gsl(new_dest_axes, self->current_destination_axes);
 
     g_assert(err == NULL || *err == NULL);
 }
@@ -473,25 +495,21 @@ d_trajectory_control_set_current_destination_axes (DTrajectoryControl   *self,
     g_return_if_fail(err == NULL || *err == NULL);
     g_return_if_fail(dest_axes != NULL);
 
-    gsl_vector *new_dest_axes = gsl_vector_calloc(3);
-    gsl_vector *new_dest = gsl_vector_calloc(3);
-    GError *local_err = NULL;
-
-    gsl_vector_memcpy(new_dest_axes, dest_axes);
-    d_solver_solve_direct(self->geometry,
-                        new_dest_axes,
-                        new_dest,
-                        &local_err);
-    if (local_err != NULL) {
-        g_propagate_error(err, local_err);
+    DVec3 new_dest_axes = d_vec3_from_gsl(dest_axes);
+    DVec3 new_dest;
+    gsl_vector_view dest_axes_view = d_vec3_view(&new_dest_axes);
+    gsl_vector_view dest_view = d_vec3_view(&new_dest);
+
+    DSolverStatus status = d_solver_solve_direct_status(self->geometry,
+                                                        &dest_axes_view.vector,
+                                                        &dest_view.vector);
+    if (status != D_SOLVER_STATUS_OK) {
+        d_trajectory_control_set_solver_error(err, status, "Destination axes", new_dest_axes);
         return;
     }
 
-    gsl_vector_memcpy(self->current_destination, new_dest);
-    gsl_vector_memcpy(self->current_destination_axes, new_dest_axes);
-
-    gsl_vector_free(new_dest_axes);
-    gsl_vector_free(new_dest);
+    d_vec3_to_gsl(new_dest, self->current_destination);
+    d_vec3_to_gsl(new_dest_axes, self->current_destination_axes);
 
     g_assert(err == NULL || *err == NULL);
 }
@@ -530,28 +548,30 @@ d_trajectory_control_set_current_position (DTrajectoryControl   *self,
     g_return_if_fail(err == NULL || *err == NULL);
     g_return_if_fail(pos != NULL);
 
-    gsl_vector *new_pos = gsl_vector_calloc(3);
-    gsl_vector *new_axes = gsl_vector_calloc(3);
-    GError *local_err = NULL;
-
-    gsl_vector_memcpy(new_pos, pos);
-    d_solver_solve_inverse(self->geometry,
-                        new_pos,
-                        new_axes,
-                        NULL,
-                        &local_err);
-    if (local_err != NULL) {
-        g_propagate_error(err, local_err);
+    DVec3 new_pos = d_vec3_from_gsl(pos);
+    DVec3 new_axes;
+    DMat3 new_ext;
+    gsl_vector_view pos_view = d_vec3_view(&new_pos);
+    gsl_vector_view axes_view = d_vec3_view(&new_axes);
+    gsl_matrix_view ext_view = d_mat3_view(&new_ext);
+
+    DSolverStatus status = d_solver_solve_inverse_status(self->geometry,
+                                                         &pos_view.vector,
+                                                         &axes_view.vector,
+                                                         &ext_view.matrix);
+    if (status != D_SOLVER_STATUS_OK) {
+        d_trajectory_control_set_solver_error(err, status, "Position", new_pos);
         return;
     }
+    if (self->singularity_monitor) {
+        d_singularity_monitor_update(self->singularity_monitor,
+                                     (const gdouble (*)[3]) new_ext.m);
+    }
 
     /* Call the output function first so we can avoid delays */
-    self->linear_out_fun(new_pos, self->linear_out_data);
-    gsl_vector_memcpy(self->current_position, new_pos);
-    gsl_vector_memcpy(self->current_position_axes, new_axes);
-
-    gsl_vector_free(new_pos);
-    gsl_vector_free(new_axes);
+    self->linear_out_fun(&pos_view.vector, self->linear_out_data);
+    d_vec3_to_gsl(new_pos, self->current_position);
+    d_vec3_to_gsl(new_axes, self->current_position_axes);
 
     g_assert(err == NULL || *err == NULL);
 }
@@ -564,27 +584,32 @@ d_trajectory_control_set_current_position_axes (DTrajectoryControl  *self,
     g_return_if_fail(err == NULL || *err == NULL);
     g_return_if_fail(axes != NULL);
 
-    gsl_vector *new_axes = gsl_vector_calloc(3);
-    gsl_vector *new_pos = gsl_vector_calloc(3);
-    GError *local_err = NULL;
-
-    gsl_vector_memcpy(new_axes, axes);
-    d_solver_solve_direct(self->geometry,
-                        new_axes,
-                        new_pos,
-                        &local_err);
-    if (local_err != NULL) {
-        g_propagate_error(err, local_err);
+    DVec3 new_axes = d_vec3_from_gsl(axes);
+    DVec3 new_pos;
+    gsl_vector_view axes_view = d_vec3_view(&new_axes);
+    gsl_vector_view pos_view = d_vec3_view(&new_pos);
+
+    DSolverStatus status = d_solver_solve_direct_status(self->geometry,
+                                                        &axes_view.vector,
+                                                        &pos_view.vector);
+    if (status != D_SOLVER_STATUS_OK) {
+        d_trajectory_control_set_solver_error(err, status, "Axes", new_axes);
         return;
     }
+    if (self->singularity_monitor) {
+        DMat3 new_ext;
+        gsl_matrix_view ext_view = d_mat3_view(&new_ext);
+        if (d_solver_solve_inverse_status(self->geometry, &pos_view.vector,
+                                          NULL, &ext_view.matrix) == D_SOLVER_STATUS_OK) {
+            d_singularity_monitor_update(self->singularity_monitor,
+                                         (const gdouble (*)[3]) new_ext.m);
+        }
+    }
 
     /* Call the output function first so we can avoid delays */
-    self->joint_out_fun(new_axes, self->linear_out_data);
-    gsl_vector_memcpy(self->current_position, new_pos);
-    gsl_vector_memcpy(self->current_position_axes, new_axes);
-
-    gsl_vector_free(new_axes);
-    gsl_vector_free(new_pos);
+    self->joint_out_fun(&axes_view.vector, self->linear_out_data);
+    d_vec3_to_gsl(new_pos, self->current_position);
+    d_vec3_to_gsl(new_axes, self->current_position_axes);
 
     g_assert(err == NULL || *err == NULL);
 }
@@ -637,3 +662,19 @@ d_trajectory_control_set_joint_out_fun (DTrajectoryControl      *self,
     self->joint_out_data = out_data;
     self->joint_out_fun = out_fun;
 }
+
+void
+d_trajectory_control_set_singularity_monitor (DTrajectoryControl    *self,
+                                              DSingularityMonitor   *monitor)
+{
+    g_return_if_fail(D_IS_TRAJECTORY_CONTROL(self));
+    g_return_if_fail(monitor == NULL || D_IS_SINGULARITY_MONITOR(monitor));
+
+    if (monitor) {
+        g_object_ref(monitor);
+    }
+    if (self->singularity_monitor) {
+        g_object_unref(self->singularity_monitor);
+    }
+    self->singularity_monitor = monitor;
+}
@@ -23,6 +23,7 @@
  */
 
 #include "dsim_trajectory.h"
+#include "dsim_vec3.h"
 
 /* Forward declarations */
 static void
@@ -105,23 +106,21 @@ d_joint_trajectory_new_full (gsl_vector    *current_axes,
     gsl_vector_sub(parent->start_speed, current_axes);
     gsl_vector_scale(parent->start_speed, 1.0 / acceleration_time);
 
-    gsl_vector *displacement = gsl_vector_alloc(3);
-    gsl_vector_memcpy(displacement, move_destination);
-    gsl_vector_sub(displacement, control_point);
+    DVec3 displacement = d_vec3_sub(d_vec3_from_gsl(move_destination),
+                                    d_vec3_from_gsl(control_point));
+    gsl_vector_view displacement_view = d_vec3_view(&displacement);
 
-    parent->move_time = d_trajectory_calculate_move_time(displacement,
+    parent->move_time = d_trajectory_calculate_move_time(&displacement_view.vector,
                                                          max_speed,
                                                          acceleration_time);
 
-    gsl_vector_scale(displacement, parent->move_time);
-    gsl_vector_memcpy(parent->end_speed, displacement);
+    d_vec3_to_gsl(d_vec3_scale(displacement, parent->move_time),
+                  parent->end_speed);
 
     gsl_vector_memcpy(parent->control_point, control_point);
 
     parent->step_time = step_time;
 
-    gsl_vector_free(displacement);
-
     return self;
 }
 
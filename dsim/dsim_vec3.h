@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_vec3.h : Fixed size 3-vectors and 3x3 matrices held by value.
+ *               Everything is inline so products unroll to straight-line
+ *               code. Use the gsl conversions only at API boundaries.
+ */
+
+#ifndef  DSIM_VEC3_INC
+#define  DSIM_VEC3_INC
+
+#include <glib.h>
+#include <math.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+
+typedef struct _DVec3 DVec3;
+struct _DVec3 {
+    gdouble v[3];
+};
+
+/* Row major, m[row][column] */
+typedef struct _DMat3 DMat3;
+struct _DMat3 {
+    gdouble m[3][3];
+};
+
+/* Construction and gsl conversions */
+static inline DVec3
+d_vec3 (gdouble x,
+        gdouble y,
+        gdouble z)
+{
+    DVec3 r = {{ x, y, z }};
+    return r;
+}
+
+static inline DVec3
+d_vec3_from_gsl (const gsl_vector   *src)
+{
+    return d_vec3(gsl_vector_get(src, 0),
+                  gsl_vector_get(src, 1),
+                  gsl_vector_get(src, 2));
+}
+
+static inline void
+d_vec3_to_gsl (DVec3        v,
+               gsl_vector   *dest)
+{
+    for (int i = 0; i < 3; i++) {
+        gsl_vector_set(dest, i, v.v[i]);
+    }
+}
+
+/* A gsl_vector aliasing v, for calling gsl based API without allocating */
+static inline gsl_vector_view
+d_vec3_view (DVec3  *v)
+{
+    return gsl_vector_view_array(v->v, 3);
+}
+
+static inline DMat3
+d_mat3_zero (void)
+{
+    DMat3 r = {{{ 0.0 }}};
+    return r;
+}
+
+static inline DMat3
+d_mat3_diag (gdouble    d0,
+             gdouble    d1,
+             gdouble    d2)
+{
+    DMat3 r = d_mat3_zero();
+    r.m[0][0] = d0;
+    r.m[1][1] = d1;
+    r.m[2][2] = d2;
+    return r;
+}
+
+static inline DMat3
+d_mat3_from_gsl (const gsl_matrix   *src)
+{
+    DMat3 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = gsl_matrix_get(src, i, j);
+        }
+    }
+    return r;
+}
+
+static inline void
+d_mat3_to_gsl (const DMat3  *a,
+               gsl_matrix   *dest)
+{
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            gsl_matrix_set(dest, i, j, a->m[i][j]);
+        }
+    }
+}
+
+/* A gsl_matrix aliasing a, for calling gsl based API without allocating */
+static inline gsl_matrix_view
+d_mat3_view (DMat3  *a)
+{
+    return gsl_matrix_view_array(&a->m[0][0], 3, 3);
+}
+
+/* Vector arithmetic */
+static inline DVec3
+d_vec3_add (DVec3   a,
+            DVec3   b)
+{
+    return d_vec3(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2]);
+}
+
+static inline DVec3
+d_vec3_sub (DVec3   a,
+            DVec3   b)
+{
+    return d_vec3(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2]);
+}
+
+static inline DVec3
+d_vec3_scale (DVec3     a,
+              gdouble   s)
+{
+    return d_vec3(a.v[0] * s, a.v[1] * s, a.v[2] * s);
+}
+
+static inline gdouble
+d_vec3_dot (DVec3   a,
+            DVec3   b)
+{
+    return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+}
+
+/* Matrix arithmetic */
+static inline DMat3
+d_mat3_add (const DMat3 *a,
+            const DMat3 *b)
+{
+    DMat3 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = a->m[i][j] + b->m[i][j];
+        }
+    }
+    return r;
+}
+
+static inline DMat3
+d_mat3_transpose (const DMat3   *a)
+{
+    DMat3 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = a->m[j][i];
+        }
+    }
+    return r;
+}
+
+/* a * b */
+static inline DMat3
+d_mat3_mul (const DMat3 *a,
+            const DMat3 *b)
+{
+    DMat3 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = a->m[i][0] * b->m[0][j]
+                      + a->m[i][1] * b->m[1][j]
+                      + a->m[i][2] * b->m[2][j];
+        }
+    }
+    return r;
+}
+
+/* a * transpose(b) */
+static inline DMat3
+d_mat3_mul_t (const DMat3   *a,
+              const DMat3   *b)
+{
+    DMat3 r;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            r.m[i][j] = a->m[i][0] * b->m[j][0]
+                      + a->m[i][1] * b->m[j][1]
+                      + a->m[i][2] * b->m[j][2];
+        }
+    }
+    return r;
+}
+
+/* a * v */
+static inline DVec3
+d_mat3_mul_vec (const DMat3 *a,
+                DVec3       v)
+{
+    DVec3 r;
+    for (int i = 0; i < 3; i++) {
+        r.v[i] = a->m[i][0] * v.v[0] + a->m[i][1] * v.v[1] + a->m[i][2] * v.v[2];
+    }
+    return r;
+}
+
+/* transpose(a) * v */
+static inline DVec3
+d_mat3_t_mul_vec (const DMat3   *a,
+                  DVec3         v)
+{
+    DVec3 r;
+    for (int i = 0; i < 3; i++) {
+        r.v[i] = a->m[0][i] * v.v[0] + a->m[1][i] * v.v[1] + a->m[2][i] * v.v[2];
+    }
+    return r;
+}
+
+static inline gdouble
+d_mat3_det (const DMat3 *a)
+{
+    return a->m[0][0] * (a->m[1][1] * a->m[2][2] - a->m[1][2] * a->m[2][1])
+         - a->m[0][1] * (a->m[1][0] * a->m[2][2] - a->m[1][2] * a->m[2][0])
+         + a->m[0][2] * (a->m[1][0] * a->m[2][1] - a->m[1][1] * a->m[2][0]);
+}
+
+/*
+ * Inverse by the adjugate. Returns FALSE and leaves inv untouched when a is
+ * singular (zero or non finite determinant).
+ */
+static inline gboolean
+d_mat3_inverse (const DMat3 *a,
+                DMat3       *inv)
+{
+    DMat3 adj;
+    adj.m[0][0] = a->m[1][1] * a->m[2][2] - a->m[1][2] * a->m[2][1];
+    adj.m[0][1] = a->m[0][2] * a->m[2][1] - a->m[0][1] * a->m[2][2];
+    adj.m[0][2] = a->m[0][1] * a->m[1][2] - a->m[0][2] * a->m[1][1];
+    adj.m[1][0] = a->m[1][2] * a->m[2][0] - a->m[1][0] * a->m[2][2];
+    adj.m[1][1] = a->m[0][0] * a->m[2][2] - a->m[0][2] * a->m[2][0];
+    adj.m[1][2] = a->m[0][2] * a->m[1][0] - a->m[0][0] * a->m[1][2];
+    adj.m[2][0] = a->m[1][0] * a->m[2][1] - a->m[1][1] * a->m[2][0];
+    adj.m[2][1] = a->m[0][1] * a->m[2][0] - a->m[0][0] * a->m[2][1];
+    adj.m[2][2] = a->m[0][0] * a->m[1][1] - a->m[0][1] * a->m[1][0];
+
+    gdouble det = a->m[0][0] * adj.m[0][0]
+                + a->m[0][1] * adj.m[1][0]
+                + a->m[0][2] * adj.m[2][0];
+    if (det == 0.0 || !isfinite(det)) {
+        return FALSE;
+    }
+    gdouble idet = 1.0 / det;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            inv->m[i][j] = adj.m[i][j] * idet;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Solves a * x = b by Cramer's rule. Returns FALSE and leaves x untouched
+ * when a is singular.
+ */
+static inline gboolean
+d_mat3_solve (const DMat3   *a,
+              DVec3         b,
+              DVec3         *x)
+{
+    gdouble det = d_mat3_det(a);
+    if (det == 0.0 || !isfinite(det)) {
+        return FALSE;
+    }
+    gdouble idet = 1.0 / det;
+    for (int k = 0; k < 3; k++) {
+        DMat3 ak = *a;
+        for (int i = 0; i < 3; i++) {
+            ak.m[i][k] = b.v[i];
+        }
+        x->v[k] = d_mat3_det(&ak) * idet;
+    }
+    return TRUE;
+}
+
+/*
+ * LDLᵀ factor of a symmetric positive definite matrix, a = l * d * lᵀ with
+ * l unit lower triangular, the square root free Cholesky. The strictly
+ * lower triangle of f receives l and its diagonal the inverse of d, so
+ * solving takes no division. Only the lower triangle of a is read.
+ * Returns FALSE and leaves f untouched when a is not positive definite or
+ * not finite.
+ */
+static inline gboolean
+d_mat3_ldlt (const DMat3 *a,
+             DMat3       *f)
+{
+    gdouble d0 = a->m[0][0];
+    if (!(d0 > 0.0)) {
+        return FALSE;
+    }
+    gdouble r0 = 1.0 / d0;
+    gdouble l10 = a->m[1][0] * r0;
+    gdouble l20 = a->m[2][0] * r0;
+
+    gdouble d1 = a->m[1][1] - l10 * a->m[1][0];
+    if (!(d1 > 0.0)) {
+        return FALSE;
+    }
+    gdouble r1 = 1.0 / d1;
+    gdouble e21 = a->m[2][1] - l20 * a->m[1][0];
+    gdouble l21 = e21 * r1;
+
+    gdouble d2 = a->m[2][2] - l20 * a->m[2][0] - l21 * e21;
+    if (!(d2 > 0.0) || !isfinite(d2)) {
+        return FALSE;
+    }
+
+    *f = d_mat3_zero();
+    f->m[0][0] = r0;
+    f->m[1][0] = l10;
+    f->m[1][1] = r1;
+    f->m[2][0] = l20;
+    f->m[2][1] = l21;
+    f->m[2][2] = 1.0 / d2;
+    return TRUE;
+}
+
+/* Solves a * x = b, f being the factor of a from d_mat3_ldlt */
+static inline DVec3
+d_mat3_ldlt_solve (const DMat3  *f,
+                   DVec3        b)
+{
+    gdouble y1 = b.v[1] - f->m[1][0] * b.v[0];
+    gdouble y2 = b.v[2] - f->m[2][0] * b.v[0] - f->m[2][1] * y1;
+
+    DVec3 x;
+    x.v[2] = y2 * f->m[2][2];
+    x.v[1] = y1 * f->m[1][1] - f->m[2][1] * x.v[2];
+    x.v[0] = b.v[0] * f->m[0][0] - f->m[1][0] * x.v[1] - f->m[2][0] * x.v[2];
+    return x;
+}
+
+/*
+ * Eigenvalues of a symmetric matrix in decreasing order, by the
+ * trigonometric solution of its characteristic cubic. Only the upper
+ * triangle is read. The smallest one has an absolute error of a few ulps
+ * of the largest, derive it from the determinant when that matters.
+ * Eigenvalues that nearly coincide lose about half their digits to acos.
+ */
+static inline DVec3
+d_mat3_sym_eigenvalues (const DMat3 *a)
+{
+    gdouble p1 = a->m[0][1] * a->m[0][1]
+               + a->m[0][2] * a->m[0][2]
+               + a->m[1][2] * a->m[1][2];
+    gdouble q = (a->m[0][0] + a->m[1][1] + a->m[2][2]) / 3.0;
+    gdouble d0 = a->m[0][0] - q;
+    gdouble d1 = a->m[1][1] - q;
+    gdouble d2 = a->m[2][2] - q;
+    gdouble p = sqrt((d0 * d0 + d1 * d1 + d2 * d2 + 2.0 * p1) / 6.0);
+    if (p == 0.0) {
+        return d_vec3(q, q, q);
+    }
+
+    /* det((A - q I) / p) / 2 is the cosine of three times the angle */
+    gdouble ip = 1.0 / p;
+    DMat3 b = {{
+        { d0 * ip, a->m[0][1] * ip, a->m[0][2] * ip },
+        { a->m[0][1] * ip, d1 * ip, a->m[1][2] * ip },
+        { a->m[0][2] * ip, a->m[1][2] * ip, d2 * ip }
+    }};
+    gdouble r = CLAMP(d_mat3_det(&b) / 2.0, -1.0, 1.0);
+    gdouble phi = acos(r) / 3.0;
+
+    gdouble e0 = q + 2.0 * p * cos(phi);
+    gdouble e2 = q + 2.0 * p * cos(phi + 2.0 * G_PI / 3.0);
+    return d_vec3(e0, 3.0 * q - e0 - e2, e2);
+}
+
+#endif   /* ----- #ifndef DSIM_VEC3_INC  ----- */
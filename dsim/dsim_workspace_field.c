@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dsim_workspace_field.h"
+#include "dsim_solver.h"
+#include "dsim_jacobian.h"
+#include <string.h>
+
+/* Work shared by the slice tasks */
+typedef struct {
+    DWorkspaceField     *field;
+    DGeometry           *geometry;
+} DWorkspaceFieldJob;
+
+/* Private Methods */
+static inline gsize
+d_workspace_field_index (const DWorkspaceField  *field,
+                         guint                  i,
+                         guint                  j,
+                         guint                  k)
+{
+    return ((gsize) k * field->dims[1] + j) * field->dims[0] + i;
+}
+
+static void
+d_workspace_field_slice (gpointer   data,
+                         gpointer   user_data)
+{
+    guint k = GPOINTER_TO_UINT(data) - 1;
+    DWorkspaceFieldJob *job = user_data;
+    DWorkspaceField *field = job->field;
+    guint nx = field->dims[0];
+
+    gdouble *x = g_new(gdouble, nx);
+    gdouble *y = g_new(gdouble, nx);
+    gdouble *z = g_new(gdouble, nx);
+    gdouble *extaxes = g_new(gdouble, 9 * nx);
+    gdouble *measures[D_WORKSPACE_FIELD_N_CHANNELS];
+    for (int c = 0; c < D_WORKSPACE_FIELD_N_CHANNELS; c++) {
+        measures[c] = g_new(gdouble, nx);
+    }
+    guint8 *status = g_new(guint8, nx);
+
+    for (guint j = 0; j < field->dims[1]; j++) {
+        for (guint i = 0; i < nx; i++) {
+            gdouble pos[3];
+            d_workspace_field_center(field, i, j, k, pos);
+            x[i] = pos[0];
+            y[i] = pos[1];
+            z[i] = pos[2];
+        }
+        d_solver_solve_inverse_batch(job->geometry, nx, x, y, z,
+                                     NULL, NULL, NULL, extaxes, status);
+
+        /* Pack the reachable voxels so the measures only see solved poses */
+        gsize m = 0;
+        for (guint i = 0; i < nx; i++) {
+            if (status[i] == D_SOLVER_STATUS_OK) {
+                if (m != i) {
+                    memcpy(extaxes + 9 * m, extaxes + 9 * i, 9 * sizeof(gdouble));
+                }
+                m++;
+            }
+        }
+        d_jacobian_measures_batch(job->geometry, m, extaxes,
+                                  measures[D_WORKSPACE_FIELD_DEXTERITY],
+                                  measures[D_WORKSPACE_FIELD_MANIPULABILITY],
+                                  measures[D_WORKSPACE_FIELD_DETERMINANT]);
+
+        gfloat *voxel = field->data
+                        + D_WORKSPACE_FIELD_N_CHANNELS * d_workspace_field_index(field, 0, j, k);
+        m = 0;
+        for (guint i = 0; i < nx; i++, voxel += D_WORKSPACE_FIELD_N_CHANNELS) {
+            for (int c = 0; c < D_WORKSPACE_FIELD_N_CHANNELS; c++) {
+                voxel[c] = status[i] == D_SOLVER_STATUS_OK ? measures[c][m] : NAN;
+            }
+            if (status[i] == D_SOLVER_STATUS_OK) {
+                m++;
+            }
+        }
+    }
+
+    g_free(x);
+    g_free(y);
+    g_free(z);
+    g_free(extaxes);
+    for (int c = 0; c < D_WORKSPACE_FIELD_N_CHANNELS; c++) {
+        g_free(measures[c]);
+    }
+    g_free(status);
+}
+
+static void
+d_workspace_field_append_u32 (GByteArray   *buffer,
+                              guint32      value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(buffer, (const guint8 *) &value, sizeof(value));
+}
+
+static void
+d_workspace_field_append_f64 (GByteArray   *buffer,
+                              gdouble      value)
+{
+    guint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = GUINT64_TO_LE(bits);
+    g_byte_array_append(buffer, (const guint8 *) &bits, sizeof(bits));
+}
+
+static guint32
+d_workspace_field_read_u32 (const guint8    **p)
+{
+    guint32 value;
+    memcpy(&value, *p, sizeof(value));
+    *p += sizeof(value);
+    return GUINT32_FROM_LE(value);
+}
+
+static gdouble
+d_workspace_field_read_f64 (const guint8    **p)
+{
+    guint64 bits;
+    gdouble value;
+    memcpy(&bits, *p, sizeof(bits));
+    *p += sizeof(bits);
+    bits = GUINT64_FROM_LE(bits);
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/* Public API */
+DWorkspaceField*
+d_workspace_field_new (const guint      dims[3],
+                       const gdouble    lo[3],
+                       const gdouble    hi[3])
+{
+    g_return_val_if_fail(dims[0] > 0 && dims[1] > 0 && dims[2] > 0, NULL);
+
+    DWorkspaceField *field = g_new0(DWorkspaceField, 1);
+    for (int i = 0; i < 3; i++) {
+        field->dims[i] = dims[i];
+        field->lo[i] = lo[i];
+        field->hi[i] = hi[i];
+    }
+    gsize n = D_WORKSPACE_FIELD_N_CHANNELS * (gsize) dims[0] * dims[1] * dims[2];
+    field->data = g_new(gfloat, n);
+    for (gsize l = 0; l < n; l++) {
+        field->data[l] = NAN;
+    }
+    return field;
+}
+
+void
+d_workspace_field_free (DWorkspaceField *field)
+{
+    if (field) {
+        g_free(field->data);
+        g_free(field);
+    }
+}
+
+void
+d_workspace_field_center (const DWorkspaceField *field,
+                          guint                 i,
+                          guint                 j,
+                          guint                 k,
+                          gdouble               pos[3])
+{
+    guint index[] = { i, j, k };
+    for (int l = 0; l < 3; l++) {
+        pos[l] = field->lo[l] + (index[l] + 0.5)
+                 * (field->hi[l] - field->lo[l]) / field->dims[l];
+    }
+}
+
+gfloat
+d_workspace_field_get (const DWorkspaceField    *field,
+                       guint                    i,
+                       guint                    j,
+                       guint                    k,
+                       DWorkspaceFieldChannel   channel)
+{
+    g_return_val_if_fail(i < field->dims[0] && j < field->dims[1]
+                         && k < field->dims[2], NAN);
+    g_return_val_if_fail(channel < D_WORKSPACE_FIELD_N_CHANNELS, NAN);
+
+    return field->data[D_WORKSPACE_FIELD_N_CHANNELS
+                       * d_workspace_field_index(field, i, j, k) + channel];
+}
+
+gboolean
+d_workspace_field_compute (DWorkspaceField  *field,
+                           DGeometry        *geometry,
+                           gint             n_threads,
+                           GError           **err)
+{
+    g_return_val_if_fail(field != NULL, FALSE);
+    g_return_val_if_fail(D_IS_GEOMETRY(geometry), FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    if (n_threads <= 0) {
+        n_threads = g_get_num_processors();
+    }
+
+    field->geometry[0] = geometry->a;
+    field->geometry[1] = geometry->b;
+    field->geometry[2] = geometry->h;
+    field->geometry[3] = geometry->r;
+
+    DWorkspaceFieldJob job = { field, geometry };
+    GThreadPool *pool = g_thread_pool_new(d_workspace_field_slice, &job,
+                                          n_threads, TRUE, err);
+    if (!pool) {
+        return FALSE;
+    }
+    /* Slices are pushed as k + 1, the pool doesn't take NULL */
+    for (guint k = 0; k < field->dims[2]; k++) {
+        g_thread_pool_push(pool, GUINT_TO_POINTER(k + 1), NULL);
+    }
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    return TRUE;
+}
+
+gboolean
+d_workspace_field_save (const DWorkspaceField   *field,
+                        const gchar             *filename,
+                        GError                  **err)
+{
+    g_return_val_if_fail(field != NULL, FALSE);
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    gsize n = D_WORKSPACE_FIELD_N_CHANNELS
+              * (gsize) field->dims[0] * field->dims[1] * field->dims[2];
+    GByteArray *buffer = g_byte_array_sized_new(D_WORKSPACE_FIELD_HEADER_SIZE
+                                                + n * sizeof(gfloat));
+
+    g_byte_array_append(buffer, (const guint8 *) D_WORKSPACE_FIELD_MAGIC, 8);
+    d_workspace_field_append_u32(buffer, D_WORKSPACE_FIELD_N_CHANNELS);
+    for (int i = 0; i < 3; i++) {
+        d_workspace_field_append_u32(buffer, field->dims[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        d_workspace_field_append_f64(buffer, field->lo[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        d_workspace_field_append_f64(buffer, field->hi[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        d_workspace_field_append_f64(buffer, field->geometry[i]);
+    }
+    for (gsize l = 0; l < n; l++) {
+        guint32 bits;
+        memcpy(&bits, &field->data[l], sizeof(bits));
+        d_workspace_field_append_u32(buffer, bits);
+    }
+
+    gboolean ok = g_file_set_contents(filename, (const gchar *) buffer->data,
+                                      buffer->len, err);
+    g_byte_array_free(buffer, TRUE);
+    return ok;
+}
+
+DWorkspaceField*
+d_workspace_field_load (const gchar *filename,
+                        GError      **err)
+{
+    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
+
+    gchar *contents = NULL;
+    gsize length = 0;
+    if (!g_file_get_contents(filename, &contents, &length, err)) {
+        return NULL;
+    }
+
+    const guint8 *p = (const guint8 *) contents;
+    guint dims[3];
+    gdouble lo[3], hi[3];
+    if (length < D_WORKSPACE_FIELD_HEADER_SIZE
+        || memcmp(p, D_WORKSPACE_FIELD_MAGIC, 8) != 0) {
+        g_set_error(err,
+                D_WORKSPACE_FIELD_ERROR,
+                D_WORKSPACE_FIELD_ERROR_INVALID,
+                "%s is not a workspace field file", filename);
+        g_free(contents);
+        return NULL;
+    }
+    p += 8;
+    guint32 n_channels = d_workspace_field_read_u32(&p);
+    for (int i = 0; i < 3; i++) {
+        dims[i] = d_workspace_field_read_u32(&p);
+    }
+    for (int i = 0; i < 3; i++) {
+        lo[i] = d_workspace_field_read_f64(&p);
+    }
+    for (int i = 0; i < 3; i++) {
+        hi[i] = d_workspace_field_read_f64(&p);
+    }
+
+    guint64 n = (guint64) n_channels * dims[0] * dims[1] * dims[2];
+    if (n_channels != D_WORKSPACE_FIELD_N_CHANNELS || n == 0
+        || length != D_WORKSPACE_FIELD_HEADER_SIZE + n * sizeof(gfloat)) {
+        g_set_error(err,
+                D_WORKSPACE_FIELD_ERROR,
+                D_WORKSPACE_FIELD_ERROR_INVALID,
+                "%s has an invalid workspace field size", filename);
+        g_free(contents);
+        return NULL;
+    }
+
+    DWorkspaceField *field = d_workspace_field_new(dims, lo, hi);
+    for (int i = 0; i < 4; i++) {
+        field->geometry[i] = d_workspace_field_read_f64(&p);
+    }
+    for (guint64 l = 0; l < n; l++) {
+        guint32 bits = d_workspace_field_read_u32(&p);
+        memcpy(&field->data[l], &bits, sizeof(bits));
+    }
+
+    g_free(contents);
+    return field;
+}
+
+GQuark
+d_workspace_field_error_quark (void)
+{
+    return g_quark_from_static_string("d_workspace_field_error_quark");
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018, Joaquín Ignacio Aramendía
+ * Author: Joaquín Ignacio Aramendía <samsagax [at] gmail [dot] com>
+ *
+ * This file is part of PROJECTNAME.
+ *
+ * PROJECTNAME is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * PROJECTNAME is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with PROJECTNAME. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * dsim_workspace_field.h : Voxel grid of jacobian measures over a box of
+ *                          the working space, computed on a thread pool
+ *                          and stored in a compact binary file.
+ */
+
+#ifndef  DSIM_WORKSPACE_FIELD_INC
+#define  DSIM_WORKSPACE_FIELD_INC
+
+#include <glib.h>
+#include <dsim/dsim_geometry.h>
+
+/* Values stored for each voxel, in this order */
+typedef enum {
+    D_WORKSPACE_FIELD_DEXTERITY = 0,    /* See d_jacobian_dexterity */
+    D_WORKSPACE_FIELD_MANIPULABILITY,   /* sqrt(det(J J^T)) */
+    D_WORKSPACE_FIELD_DETERMINANT,      /* det J */
+    D_WORKSPACE_FIELD_N_CHANNELS
+} DWorkspaceFieldChannel;
+
+/*
+ * Grid of dims[0] x dims[1] x dims[2] voxels splitting the box [lo, hi].
+ * Each voxel holds the measures of its center as D_WORKSPACE_FIELD_N_CHANNELS
+ * floats, x varying fastest, then y, then z. Unreachable voxels hold NaN,
+ * singular ones a dexterity of 0 and infinite determinant.
+ */
+typedef struct _DWorkspaceField DWorkspaceField;
+struct _DWorkspaceField {
+    guint           dims[3];
+    gdouble         lo[3];
+    gdouble         hi[3];
+
+    /* Geometry parameters the field was computed for, a, b, h and r */
+    gdouble         geometry[4];
+
+    gfloat          *data;
+};
+
+/*
+ * File layout, every field little endian:
+ *   "DSIMFLD1"                 8 byte magic
+ *   guint32 n_channels         D_WORKSPACE_FIELD_N_CHANNELS
+ *   guint32 dims[3]
+ *   gdouble lo[3], hi[3]
+ *   gdouble geometry[4]
+ *   gfloat  data[]             as in memory
+ */
+#define D_WORKSPACE_FIELD_MAGIC         "DSIMFLD1"
+#define D_WORKSPACE_FIELD_HEADER_SIZE   (8 + 4 * 4 + 10 * 8)
+
+/* Create a field with every voxel set to NaN */
+DWorkspaceField*    d_workspace_field_new       (const guint    dims[3],
+                                                 const gdouble  lo[3],
+                                                 const gdouble  hi[3]);
+
+void                d_workspace_field_free      (DWorkspaceField    *field);
+
+/* Center of voxel (i, j, k) */
+void                d_workspace_field_center    (const DWorkspaceField  *field,
+                                                 guint                  i,
+                                                 guint                  j,
+                                                 guint                  k,
+                                                 gdouble                pos[3]);
+
+gfloat              d_workspace_field_get       (const DWorkspaceField  *field,
+                                                 guint                  i,
+                                                 guint                  j,
+                                                 guint                  k,
+                                                 DWorkspaceFieldChannel channel);
+
+/*
+ * Fills the field for the given geometry. Each z slice is a task for a pool
+ * of n_threads threads, or one per processor when n_threads is 0 or less,
+ * solved row by row with the batch inverse solver and
+ * d_jacobian_measures_batch. Returns FALSE and sets err when the pool
+ * can't be created.
+ */
+gboolean            d_workspace_field_compute   (DWorkspaceField    *field,
+                                                 DGeometry          *geometry,
+                                                 gint               n_threads,
+                                                 GError             **err);
+
+gboolean            d_workspace_field_save      (const DWorkspaceField  *field,
+                                                 const gchar            *filename,
+                                                 GError                 **err);
+
+DWorkspaceField*    d_workspace_field_load      (const gchar        *filename,
+                                                 GError             **err);
+
+/* Error type for malformed field files */
+#define D_WORKSPACE_FIELD_ERROR d_workspace_field_error_quark ()
+
+typedef enum {
+    D_WORKSPACE_FIELD_ERROR_INVALID
+} DWorkspaceFieldError;
+
+GQuark              d_workspace_field_error_quark   (void);
+
+#endif   /* ----- #ifndef DSIM_WORKSPACE_FIELD_INC  ----- */
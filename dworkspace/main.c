@@ -31,6 +31,11 @@
 static gboolean axes = TRUE;
 static gboolean cartesian = FALSE;
 static gboolean verbose = FALSE;
+static gboolean volume = FALSE;
+static gint depth = 6;
+static gchar *field_file = NULL;
+static gint resolution = 64;
+static gint n_threads = 0;
 static gdouble a = 29.3;
 static gdouble b = 64.5;
 static gdouble h = 3.8;
@@ -39,10 +44,18 @@ static gdouble t_min = 0.0;
 static gdouble t_max = 90.0;
 static gdouble t_increment = 5.0;
 
+/* Number of points handed to the batch solver at once */
+#define CHUNK_SIZE 4096
+
 
 static GOptionEntry entries[] =
 {
       { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose, "be verbose", NULL  },
+      { "volume", 0, 0, G_OPTION_ARG_NONE, &volume, "bound the cartesian workspace volume by octree refinement instead", NULL },
+      { "depth", 'd', 0, G_OPTION_ARG_INT, &depth, "maximum octree depth for --volume", "D" },
+      { "field", 0, 0, G_OPTION_ARG_FILENAME, &field_file, "write a voxel field of jacobian measures to FILE instead", "FILE" },
+      { "resolution", 0, 0, G_OPTION_ARG_INT, &resolution, "voxels along the longest side of the field", "N" },
+      { "threads", 0, 0, G_OPTION_ARG_INT, &n_threads, "threads computing the field, 0 for one per processor", "T" },
       { "t-min", NULL, 0, G_OPTION_ARG_DOUBLE, &t_min, "minimum value of arm angle to test", NULL },
       { "t-max", NULL, 0, G_OPTION_ARG_DOUBLE, &t_max, "maximum value of arm angle to test", NULL },
       { "t-increment", NULL, 0, G_OPTION_ARG_DOUBLE, &t_increment, "increment value to test", NULL },
@@ -53,6 +66,126 @@ static GOptionEntry entries[] =
       { NULL  }
 };
 
+/* Volume of the leaves found by the octree refinement */
+typedef struct {
+    gdouble inside;
+    gdouble boundary;
+    gsize   leaves;
+} VolumeSum;
+
+static void
+add_box (const gdouble  lo[3],
+         const gdouble  hi[3],
+         DGeometryReach reach,
+         gpointer       user_data)
+{
+    VolumeSum *sum = user_data;
+    gdouble v = (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+
+    sum->leaves++;
+    if (reach == D_GEOMETRY_REACH_INSIDE) {
+        sum->inside += v;
+    } else if (reach == D_GEOMETRY_REACH_BOUNDARY) {
+        sum->boundary += v;
+    }
+    if (verbose && reach != D_GEOMETRY_REACH_OUTSIDE) {
+        g_print ( "Box [ %f, %f, %f ] - [ %f, %f, %f ] %s \n",
+                lo[0], lo[1], lo[2], hi[0], hi[1], hi[2],
+                reach == D_GEOMETRY_REACH_INSIDE ? "inside" : "boundary");
+    }
+}
+
+/*
+ * Bounds the working space volume. Every reachable point is within
+ * a + b + |h - r| of the origin, so the refinement starts from that cube.
+ */
+static void
+workspace_volume (DGeometry *geometry)
+{
+    gdouble radius = a + b + fabs(h - r);
+    gdouble lo[] = { -radius, -radius, -radius };
+    gdouble hi[] = { radius, radius, radius };
+    VolumeSum sum = { 0.0, 0.0, 0 };
+
+    GTimer *timer = g_timer_new();
+    gsize n_boxes = d_geometry_refine_box(geometry, lo, hi, depth,
+                                          add_box, &sum);
+    gdouble elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    g_print("Classified %" G_GSIZE_FORMAT " boxes into %" G_GSIZE_FORMAT
+            " leaves in %f s\n", n_boxes, sum.leaves, elapsed);
+    g_print("Workspace volume between %f and %f\n",
+            sum.inside, sum.inside + sum.boundary);
+}
+
+/* Bounds of the leaves that may hold reachable points */
+static void
+grow_bounds (const gdouble  lo[3],
+             const gdouble  hi[3],
+             DGeometryReach reach,
+             gpointer       user_data)
+{
+    gdouble *bounds = user_data;
+
+    if (reach == D_GEOMETRY_REACH_OUTSIDE) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        bounds[i] = MIN(bounds[i], lo[i]);
+        bounds[i + 3] = MAX(bounds[i + 3], hi[i]);
+    }
+}
+
+/*
+ * Computes the jacobian measures over a grid bounding the working space,
+ * found with a coarse octree refinement.
+ */
+static gboolean
+workspace_field (DGeometry  *geometry,
+                 GError     **err)
+{
+    gdouble radius = a + b + fabs(h - r);
+    gdouble lo[] = { -radius, -radius, -radius };
+    gdouble hi[] = { radius, radius, radius };
+    gdouble bounds[] = { radius, radius, radius, -radius, -radius, -radius };
+    d_geometry_refine_box(geometry, lo, hi, 5, grow_bounds, bounds);
+    if (bounds[0] > bounds[3]) {
+        g_print("Empty working space\n");
+        return TRUE;
+    }
+
+    gdouble side = MAX(bounds[3] - bounds[0],
+                       MAX(bounds[4] - bounds[1], bounds[5] - bounds[2]));
+    /* Cubic voxels, the box grows to a whole number of them */
+    gdouble step = side / resolution;
+    guint dims[3];
+    for (int i = 0; i < 3; i++) {
+        dims[i] = MAX(1, (guint) ceil((bounds[i + 3] - bounds[i]) / step));
+        bounds[i + 3] = bounds[i] + dims[i] * step;
+    }
+    DWorkspaceField *field = d_workspace_field_new(dims, bounds, bounds + 3);
+
+    GTimer *timer = g_timer_new();
+    gboolean ok = d_workspace_field_compute(field, geometry, n_threads, err);
+    gdouble elapsed = g_timer_elapsed(timer, NULL);
+    g_timer_destroy(timer);
+
+    if (ok) {
+        gsize n_voxels = (gsize) dims[0] * dims[1] * dims[2];
+        g_print("Computed %u x %u x %u voxels over [ %f, %f, %f ] - [ %f, %f, %f ] in %f s\n",
+                dims[0], dims[1], dims[2],
+                bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5],
+                elapsed);
+        if (elapsed > 0.0) {
+            g_print("  %.0f voxels/s\n", n_voxels / elapsed);
+        }
+        ok = d_workspace_field_save(field, field_file, err);
+    }
+    d_workspace_field_free(field);
+    return ok;
+}
+
 /*
  * Main function
  */
@@ -72,15 +205,41 @@ main(int argc, char* argv[])
     }
     g_option_context_free(context);
 
+    if (volume) {
+        if (depth < 0) {
+            g_print("Invalid octree depth\n");
+            exit(1);
+        }
+        DGeometry *geometry = d_geometry_new (a, b, h, r);
+        g_print ( "Current geometry [ %f, %f, %f, %f ] \n", a, b, h, r );
+        workspace_volume(geometry);
+        g_object_unref(geometry);
+        return 0;
+    }
+
+    if (field_file) {
+        if (resolution < 1) {
+            g_print("Invalid field resolution\n");
+            exit(1);
+        }
+        GError *error = NULL;
+        DGeometry *geometry = d_geometry_new (a, b, h, r);
+        g_print ( "Current geometry [ %f, %f, %f, %f ] \n", a, b, h, r );
+        if (!workspace_field(geometry, &error)) {
+            g_print("Field failed: %s\n", error->message);
+            g_error_free(error);
+            g_object_unref(geometry);
+            exit(1);
+        }
+        g_object_unref(geometry);
+        return 0;
+    }
+
     g_print("Using values interval [ %f , %f ], increment: %f \n", t_min, t_max, t_increment);
 
     DGeometry *geometry = d_geometry_new (a, b, h, r);
     g_print ( "Current geometry [ %f, %f, %f, %f ] \n", a, b, h, r );
 
-    gsl_vector *pos = gsl_vector_alloc(3);
-    gsl_vector *axes = gsl_vector_alloc(3);
-    GError *err = NULL;
-
     GFile *out_file = g_file_new_for_path ("workspace.asc");
     GFileOutputStream *out_stream = g_file_replace(out_file,
             NULL,
@@ -90,58 +249,109 @@ main(int argc, char* argv[])
             NULL);
     GString *buffer = g_string_new(NULL);
 
-    gdouble t1 = t_min;
-    gdouble t2 = t_min;
-    gdouble t3 = t_min;
-
-    while(t3 <= t_max)
+    /* Tested values for a single axis, accumulated as in the grid sweep */
+    gsize n_values = 0;
+    for (gdouble t = t_min; t <= t_max; t += t_increment) {
+        n_values++;
+    }
+    gdouble *values = g_new(gdouble, n_values);
     {
-        while (t2 <= t_max)
-        {
-            while (t1 <= t_max)
+        gdouble t = t_min;
+        for (gsize i = 0; i < n_values; i++) {
+            values[i] = t / 180.0 * G_PI;
+            t += t_increment;
+        }
+    }
+
+    /* Structure of arrays buffers, solved one chunk at a time */
+    gdouble *t1 = g_new(gdouble, CHUNK_SIZE);
+    gdouble *t2 = g_new(gdouble, CHUNK_SIZE);
+    gdouble *t3 = g_new(gdouble, CHUNK_SIZE);
+    gdouble *x = g_new(gdouble, CHUNK_SIZE);
+    gdouble *y = g_new(gdouble, CHUNK_SIZE);
+    gdouble *z = g_new(gdouble, CHUNK_SIZE);
+    guint8 *status = g_new(guint8, CHUNK_SIZE);
+
+    gsize n_points = n_values * n_values * n_values;
+    gsize n_solved = 0;
+    gsize n_status[D_SOLVER_STATUS_INVALID_COS2 + 1] = { 0 };
+    gdouble solve_time = 0.0;
+    GTimer *timer = g_timer_new();
+
+    for (gsize first = 0; first < n_points; first += CHUNK_SIZE) {
+        gsize n = MIN(CHUNK_SIZE, n_points - first);
+
+        /* Axis 1 varies fastest, then axis 2, then axis 3 */
+        for (gsize k = 0; k < n; k++) {
+            gsize index = first + k;
+            t1[k] = values[index % n_values];
+            t2[k] = values[(index / n_values) % n_values];
+            t3[k] = values[index / (n_values * n_values)];
+        }
+
+        g_timer_start(timer);
+        n_solved += d_solver_solve_direct_batch(geometry, n,
+                                                t1, t2, t3,
+                                                x, y, z,
+                                                status);
+        g_timer_stop(timer);
+        solve_time += g_timer_elapsed(timer, NULL);
+
+        g_string_truncate(buffer, 0);
+        for (gsize k = 0; k < n; k++) {
+            if (verbose)
             {
+                g_print ( "Current axes [ %f, %f, %f ] \n",
+                        t1[k] / G_PI * 180.0,
+                        t2[k] / G_PI * 180.0,
+                        t3[k] / G_PI * 180.0 );
+            }
+            n_status[status[k]]++;
+            if (status[k] != D_SOLVER_STATUS_OK) {
                 if (verbose)
                 {
-                    g_print ( "Current axes [ %f, %f, %f ] \n", t1, t2, t3 );
+                    g_print ( "Failed: %s \n", d_solver_status_to_string(status[k]));
                 }
-                gsl_vector_set(axes, 0, t1 / 180.0 * G_PI);
-                gsl_vector_set(axes, 1, t2 / 180.0 * G_PI);
-                gsl_vector_set(axes, 2, t3 / 180.0 * G_PI);
-                d_solver_solve_direct (geometry, axes, pos, &err);
-                if (err)
-                {
-                    g_clear_error(&err);
-                } else {
-                    if (verbose)
-                    {
-                        g_print ( "Point [ %f, %f, %f ] \n",
-                                gsl_vector_get(pos, 0),
-                                gsl_vector_get(pos, 1),
-                                gsl_vector_get(pos, 2));
-                    }
-                    g_string_printf(buffer,
-                            "%f %f %f\n",
-                            gsl_vector_get(pos, 0),
-                            gsl_vector_get(pos, 1),
-                            gsl_vector_get(pos, 2));
-                    g_output_stream_write (G_OUTPUT_STREAM (out_stream),
-                            buffer->str,
-                            buffer->len,
-                            NULL,
-                            NULL);
-                }
-                t1 += t_increment;
+                continue;
+            }
+            if (verbose)
+            {
+                g_print ( "Point [ %f, %f, %f ] \n", x[k], y[k], z[k]);
             }
-            t1 = t_min;
-            t2 += t_increment;
+            g_string_append_printf(buffer, "%f %f %f\n", x[k], y[k], z[k]);
+        }
+        g_output_stream_write (G_OUTPUT_STREAM (out_stream),
+                buffer->str,
+                buffer->len,
+                NULL,
+                NULL);
+    }
+
+    g_print("Solved %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " points in %f s",
+            n_solved, n_points, solve_time);
+    if (solve_time > 0.0) {
+        g_print(" (%.0f points/s)", n_points / solve_time);
+    }
+    g_print("\n");
+    for (guint st = D_SOLVER_STATUS_OK + 1; st < G_N_ELEMENTS(n_status); st++) {
+        if (n_status[st] > 0) {
+            g_print("  %" G_GSIZE_FORMAT " points failed: %s\n",
+                    n_status[st], d_solver_status_to_string(st));
         }
-        t1 = t_min;
-        t2 = t_min;
-        t3 += t_increment;
     }
 
-    g_output_stream_close(out_stream, NULL, NULL);
-    gsl_vector_free(axes);
+    g_output_stream_close(G_OUTPUT_STREAM (out_stream), NULL, NULL);
+    g_object_unref(out_stream);
+    g_object_unref(out_file);
+    g_timer_destroy(timer);
+    g_free(values);
+    g_free(t1);
+    g_free(t2);
+    g_free(t3);
+    g_free(x);
+    g_free(y);
+    g_free(z);
+    g_free(status);
     g_clear_object(&geometry);
     g_string_free(buffer, TRUE);
 
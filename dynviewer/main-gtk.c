@@ -22,6 +22,7 @@
  * main-gtk.c :
  */
 
+#include <math.h>
 #include <gtk/gtk.h>
 #include <dsim/dsim.h>
 #include <gtkdatabox.h>
@@ -29,6 +30,7 @@
 
 /* Forward declarations */
 static DDynamicModel *dynamic_model;
+static DDynamicSession *session;
 static GtkWidget *interval_spin[2];
 static GtkWidget *databox;
 static GtkDataboxGraph *graph[3] = { NULL };
@@ -81,11 +83,10 @@ calculate_button_callback (GtkButton    *button,
                            GdkEvent     *event,
                            gpointer     user_data)
 {
-    gsl_vector *axes = NULL;
-    gsl_vector *speed = NULL;
-    gdouble time = 0.0;
     gdouble interval = 0.0;
     gdouble step = 0.0;
+    gdouble start = 0.0;
+    GError *err = NULL;
     gint len;
 
     interval = gtk_spin_button_get_value(GTK_SPIN_BUTTON(interval_spin[0]));
@@ -120,25 +121,38 @@ calculate_button_callback (GtkButton    *button,
 //    time_data = g_new0(gfloat, len);
 //    gint j = 0;
 
-    while (time <= interval) {
-        axes = d_dynamic_model_get_axes(dynamic_model);
-        speed = d_dynamic_model_get_speed(dynamic_model);
+    /*
+     * Continue from where the last calculation left the session, sampling
+     * every step while the integrator takes its own
+     */
+    start = d_dynamic_session_get_time(session);
+    gulong steps = d_dynamic_session_get_steps(session);
+    len = ceil(interval / step) + 1;
+    DDynamicRecorder *recorder = d_dynamic_recorder_new(len, step);
+    if (!d_dynamic_recorder_run(recorder, session, start + interval, &err)) {
+        g_warning("%s", err->message);
+        g_error_free(err);
+    }
+//    for (gint j = 0; j < recorder->length; j++) {
+//        const DDynamicRecord *record = d_dynamic_recorder_get(recorder, j);
 //        for (int i = 0; i < 3; i++) {
-//            theta_data[i][j] = d_vector_get(axes, i);
-//            theta_dot_data[i][j] = d_vector_get(speed, i);
+//            theta_data[i][j] = record->axes[i];
+//            theta_dot_data[i][j] = record->speed[i];
 //        }
-//        time_data[j] = time;
-
-        g_print("t = %f, [%f, %f, %f]\n",
-                time,
-                gsl_vector_get(axes, 0),
-                gsl_vector_get(axes, 1),
-                gsl_vector_get(axes, 2));
-
-        d_dynamic_model_solve_inverse(dynamic_model, step);
-        time += step;
-//        j++;
+//        time_data[j] = record->time - start;
+//    }
+    if (recorder->length > 0) {
+        const DDynamicRecord *last = d_dynamic_recorder_get(recorder,
+                                                            recorder->length - 1);
+        g_print("%" G_GSIZE_FORMAT " samples, %lu steps, t = %f, [%f, %f, %f]\n",
+                recorder->length,
+                d_dynamic_session_get_steps(session) - steps,
+                last->time - start,
+                last->axes[0],
+                last->axes[1],
+                last->axes[2]);
     }
+    d_dynamic_recorder_free(recorder);
 
     g_print("Plotting data...\n");
 
@@ -313,6 +327,7 @@ setup_robot (void)
     d_dynamic_model_set_gravity(dynamic_model, gravity);
     d_dynamic_model_set_speed(dynamic_model, stop);
     d_dynamic_model_set_torque(dynamic_model, torque);
+    session = d_dynamic_session_new(dynamic_model);
 
     g_object_unref(geometry);
     g_object_unref(dynamic_spec);
@@ -348,6 +363,7 @@ main (gint argc, gchar* argv[])
      */
     gtk_main();
 
+    g_object_unref(session);
     g_object_unref(dynamic_model);
     for(int i = 0; i < 3; i++) {
         g_free(theta_data[i]);